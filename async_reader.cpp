@@ -0,0 +1,350 @@
+#include "async_reader.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <atomic>
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace {
+    class ThreadReader : public yzw2v::io::detail::AsyncReader {
+    public:
+        ThreadReader(const std::string& path, const uint32_t slots_count)
+            : input_{path, std::ios::binary}
+            , slots_(slots_count)
+            , stop_{false}
+        {
+            if (!input_) {
+                throw std::runtime_error{"failed to open file"};
+            }
+
+            thread_ = std::thread{[this]{ Run(); }};
+        }
+
+        ~ThreadReader() override {
+            {
+                std::lock_guard<std::mutex> lock{mutex_};
+                stop_ = true;
+            }
+
+            submitted_.notify_one();
+            thread_.join();
+        }
+
+        void Submit(const uint32_t slot, char* const buf, const uint32_t size,
+                    const uint64_t offset) override {
+            {
+                std::lock_guard<std::mutex> lock{mutex_};
+                slots_[slot] = {buf, size, offset, false, false};
+                queue_.push_back(slot);
+            }
+
+            submitted_.notify_one();
+        }
+
+        void Wait(const uint32_t slot) override {
+            std::unique_lock<std::mutex> lock{mutex_};
+            completed_.wait(lock, [this, slot]{ return slots_[slot].done; });
+            if (slots_[slot].failed) {
+                throw std::runtime_error{"read failed"};
+            }
+        }
+
+    private:
+        struct Request {
+            char* buf;
+            uint32_t size;
+            uint64_t offset;
+            bool done;
+            bool failed;
+        };
+
+        void Run() {
+            std::unique_lock<std::mutex> lock{mutex_};
+            while (true) {
+                submitted_.wait(lock, [this]{ return stop_ || !queue_.empty(); });
+                if (stop_) {
+                    return;
+                }
+
+                const auto slot = queue_.front();
+                queue_.pop_front();
+                const auto request = slots_[slot];
+
+                // only this thread touches `input_`
+                lock.unlock();
+                const auto ok = input_.seekg(static_cast<std::streamoff>(request.offset))
+                                && input_.read(request.buf,
+                                               static_cast<std::streamsize>(request.size));
+                if (!ok) {
+                    input_.clear();
+                }
+
+                lock.lock();
+                slots_[slot].done = true;
+                slots_[slot].failed = !ok;
+                completed_.notify_all();
+            }
+        }
+
+    private:
+        std::ifstream input_;
+        std::vector<Request> slots_;
+        std::deque<uint32_t> queue_;
+        bool stop_;
+
+        std::mutex mutex_;
+        std::condition_variable submitted_;
+        std::condition_variable completed_;
+        std::thread thread_;
+    };
+
+#if defined(__linux__)
+    /* Talks to io_uring directly via syscalls, so there is no dependency on liburing. Only one
+     * thread submits and reaps, so the rings need just acquire/release ordering on head and tail.
+     */
+    class UringReader : public yzw2v::io::detail::AsyncReader {
+    public:
+        UringReader(const int fd, const uint32_t slots_count)
+            : fd_{fd}
+            , ring_fd_{-1}
+            , slots_(slots_count)
+        {
+        }
+
+        // false if io_uring is not available
+        bool Init() {
+            auto params = io_uring_params{};
+            std::memset(&params, 0, sizeof(params));
+            ring_fd_ = static_cast<int>(syscall(__NR_io_uring_setup,
+                                                static_cast<unsigned>(slots_.size()), &params));
+            if (ring_fd_ < 0) {
+                return false;
+            }
+
+            sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(uint32_t);
+            cq_ring_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+            if (params.features & IORING_FEAT_SINGLE_MMAP) {
+                sq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+                cq_ring_size_ = sq_ring_size_;
+            }
+
+            sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+            if (MAP_FAILED == sq_ring_) {
+                sq_ring_ = nullptr;
+                return false;
+            }
+
+            if (params.features & IORING_FEAT_SINGLE_MMAP) {
+                cq_ring_ = sq_ring_;
+            } else {
+                cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                                MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+                if (MAP_FAILED == cq_ring_) {
+                    cq_ring_ = nullptr;
+                    return false;
+                }
+            }
+
+            sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+            sqes_ = static_cast<io_uring_sqe*>(mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                                                    MAP_SHARED | MAP_POPULATE, ring_fd_,
+                                                    IORING_OFF_SQES));
+            if (MAP_FAILED == static_cast<void*>(sqes_)) {
+                sqes_ = nullptr;
+                return false;
+            }
+
+            auto* const sq = static_cast<char*>(sq_ring_);
+            sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+            sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+            sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+
+            auto* const cq = static_cast<char*>(cq_ring_);
+            cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+            cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+            cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+            cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+            return true;
+        }
+
+        ~UringReader() override {
+            // kernel may still write into buffers of the caller
+            for (auto slot = uint32_t{}; slot < slots_.size(); ++slot) {
+                while (slots_[slot].in_flight && Reap(true)) {
+                }
+            }
+
+            if (sqes_) {
+                munmap(sqes_, sqes_size_);
+            }
+
+            if (cq_ring_ && cq_ring_ != sq_ring_) {
+                munmap(cq_ring_, cq_ring_size_);
+            }
+
+            if (sq_ring_) {
+                munmap(sq_ring_, sq_ring_size_);
+            }
+
+            if (ring_fd_ >= 0) {
+                close(ring_fd_);
+            }
+
+            close(fd_);
+        }
+
+        void Submit(const uint32_t slot, char* const buf, const uint32_t size,
+                    const uint64_t offset) override {
+            auto& request = slots_[slot];
+            request.iov.iov_base = buf;
+            request.iov.iov_len = size;
+            request.offset = offset;
+            request.result = 0;
+            request.in_flight = true;
+
+            const auto tail = *sq_tail_;
+            const auto index = tail & sq_mask_;
+            auto* const sqe = sqes_ + index;
+            std::memset(sqe, 0, sizeof(*sqe));
+            // READV instead of READ to support kernels from 5.1
+            sqe->opcode = IORING_OP_READV;
+            sqe->fd = fd_;
+            sqe->addr = reinterpret_cast<uint64_t>(&request.iov);
+            sqe->len = 1;
+            sqe->off = offset;
+            sqe->user_data = slot;
+            sq_array_[index] = index;
+            __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+
+            if (syscall(__NR_io_uring_enter, ring_fd_, 1, 0, 0, nullptr, 0) < 0) {
+                request.in_flight = false;
+                throw std::runtime_error{"io_uring_enter failed"};
+            }
+        }
+
+        void Wait(const uint32_t slot) override {
+            auto& request = slots_[slot];
+            while (request.in_flight) {
+                if (!Reap(true)) {
+                    throw std::runtime_error{"io_uring_enter failed"};
+                }
+            }
+
+            if (request.result < 0) {
+                throw std::runtime_error{"read failed"};
+            }
+
+            // short reads are allowed, read the rest synchronously
+            auto done = static_cast<size_t>(request.result);
+            while (done < request.iov.iov_len) {
+                const auto ret = pread(fd_, static_cast<char*>(request.iov.iov_base) + done,
+                                       request.iov.iov_len - done,
+                                       static_cast<off_t>(request.offset + done));
+                if (ret <= 0) {
+                    throw std::runtime_error{"read failed"};
+                }
+
+                done += static_cast<size_t>(ret);
+            }
+        }
+
+    private:
+        // Marks all completed requests, waits for at least one if `wait` is set.
+        bool Reap(const bool wait) {
+            auto head = *cq_head_;
+            const auto tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+            if (head == tail) {
+                if (!wait) {
+                    return true;
+                }
+
+                const auto ret = syscall(__NR_io_uring_enter, ring_fd_, 0, 1,
+                                         IORING_ENTER_GETEVENTS, nullptr, 0);
+                return ret >= 0 || EINTR == errno;
+            }
+
+            for (; head != tail; ++head) {
+                const auto& cqe = cqes_[head & cq_mask_];
+                auto& request = slots_[static_cast<uint32_t>(cqe.user_data)];
+                request.result = cqe.res;
+                request.in_flight = false;
+            }
+
+            __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+            return true;
+        }
+
+    private:
+        struct Request {
+            iovec iov;
+            uint64_t offset;
+            int32_t result;
+            bool in_flight;
+        };
+
+        const int fd_;
+        int ring_fd_;
+        std::vector<Request> slots_;
+
+        void* sq_ring_ = nullptr;
+        void* cq_ring_ = nullptr;
+        io_uring_sqe* sqes_ = nullptr;
+        size_t sq_ring_size_ = 0;
+        size_t cq_ring_size_ = 0;
+        size_t sqes_size_ = 0;
+
+        unsigned* sq_tail_ = nullptr;
+        unsigned sq_mask_ = 0;
+        unsigned* sq_array_ = nullptr;
+        unsigned* cq_head_ = nullptr;
+        unsigned* cq_tail_ = nullptr;
+        unsigned cq_mask_ = 0;
+        io_uring_cqe* cqes_ = nullptr;
+    };
+#endif
+}  // namespace
+
+std::unique_ptr<yzw2v::io::detail::AsyncReader>
+yzw2v::io::detail::MakeUringReader(const std::string& path, const uint32_t slots_count) {
+#if defined(__linux__)
+    const auto fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error{"failed to open file"};
+    }
+
+    std::unique_ptr<UringReader> res{new UringReader{fd, slots_count}};
+    if (!res->Init()) {
+        return nullptr;
+    }
+
+    return std::unique_ptr<AsyncReader>{res.release()};
+#else
+    (void)path;
+    (void)slots_count;
+    return nullptr;
+#endif
+}
+
+std::unique_ptr<yzw2v::io::detail::AsyncReader>
+yzw2v::io::detail::MakeThreadReader(const std::string& path, const uint32_t slots_count) {
+    return std::unique_ptr<AsyncReader>{new ThreadReader{path, slots_count}};
+}
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <cstdint>
+
+namespace yzw2v {
+    namespace io {
+        namespace detail {
+            /* Reads parts of a file in background into caller-owned buffers. Every request is
+             * identified by a slot, there is at most one request per slot in flight, requests may
+             * complete in any order.
+             */
+            class AsyncReader {
+            public:
+                virtual ~AsyncReader() = default;
+
+                virtual void Submit(const uint32_t slot, char* const buf, const uint32_t size,
+                                    const uint64_t offset) = 0;
+
+                // Blocks until request in `slot` is complete, throws if it failed.
+                virtual void Wait(const uint32_t slot) = 0;
+            };
+
+            // nullptr if io_uring is not supported by OS (or forbidden, e.g. by seccomp)
+            std::unique_ptr<AsyncReader> MakeUringReader(const std::string& path,
+                                                         const uint32_t slots_count);
+
+            // Portable fallback, requests are served one by one by a background thread.
+            std::unique_ptr<AsyncReader> MakeThreadReader(const std::string& path,
+                                                          const uint32_t slots_count);
+        }
+    }
+}
@@ -0,0 +1,301 @@
+#include "byte_source.h"
+
+#include "async_reader.h"
+#include "mapped_file.h"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+    class StreamSource : public yzw2v::io::ByteSource {
+    public:
+        StreamSource(const std::string& path, const uint64_t bytes_to_read, const uint64_t offset,
+                     const uint32_t buffer_size)
+            : input_{path, std::ios::binary}
+            , bytes_to_read_{bytes_to_read}
+            , offset_{offset}
+            , bytes_left_{bytes_to_read}
+            , buf_size_{buffer_size}
+            , buf_{new char[buffer_size]}
+        {
+            if (!input_) {
+                throw std::runtime_error{"failed to open file"};
+            }
+
+            Restart();
+        }
+
+        yzw2v::io::Block Next() override {
+            const auto bytes_to_read = static_cast<uint32_t>(
+                std::min(bytes_left_, static_cast<uint64_t>(buf_size_)));
+            if (!input_.read(buf_.get(), static_cast<std::streamsize>(bytes_to_read))) {
+                throw std::runtime_error{"read failed"};
+            }
+
+            bytes_left_ -= bytes_to_read;
+            return {buf_.get(), buf_.get() + bytes_to_read};
+        }
+
+        void Restart() override {
+            bytes_left_ = bytes_to_read_;
+            if (!input_.seekg(static_cast<std::streamoff>(offset_))) {
+                throw std::runtime_error{"seekg failed"};
+            }
+        }
+
+        void Reset(const uint64_t bytes_to_read, const uint64_t offset) override {
+            bytes_to_read_ = bytes_to_read;
+            offset_ = offset;
+            Restart();
+        }
+
+    private:
+        std::ifstream input_;
+        uint64_t bytes_to_read_;
+        uint64_t offset_;
+        uint64_t bytes_left_;
+        const uint32_t buf_size_;
+        const std::unique_ptr<char[]> buf_;
+    };
+
+    // The whole region is a single block, so there is no copying at all.
+    class MappedSource : public yzw2v::io::ByteSource {
+    public:
+        MappedSource(const std::string& path, const uint64_t bytes_to_read, const uint64_t offset)
+            : path_{path}
+            , file_{new yzw2v::io::MappedFile{path, bytes_to_read, offset}}
+            , given_away_{false}
+        {
+        }
+
+        yzw2v::io::Block Next() override {
+            if (given_away_) {
+                return {nullptr, nullptr};
+            }
+
+            given_away_ = true;
+            return {file_->data(), file_->data() + file_->size()};
+        }
+
+        bool KeepsBlocks() const noexcept override {
+            return true;
+        }
+
+        void Restart() override {
+            given_away_ = false;
+        }
+
+        void Reset(const uint64_t bytes_to_read, const uint64_t offset) override {
+            file_.reset();
+            file_.reset(new yzw2v::io::MappedFile{path_, bytes_to_read, offset});
+            given_away_ = false;
+        }
+
+    private:
+        const std::string path_;
+        std::unique_ptr<const yzw2v::io::MappedFile> file_;
+        bool given_away_;
+    };
+
+    /* Keeps `in_flight_count` buffers: one is given away to the caller while the others are being
+     * filled in background, so caller only ever parses data that is already in memory. Blocks are
+     * numbered through all regions read so far, block `i` is read into buffer
+     * `i % in_flight_count`. Once the next region is known (see `Prefetch`) its first blocks are
+     * read as soon as buffers are released by the current one, so reading goes on across regions.
+     * Buffers are `buffer_size` but not larger than the first region, regions are expected to be
+     * of about the same size (e.g. training chunks); larger ones just consist of more blocks.
+     */
+    class ReadAheadSource : public yzw2v::io::ByteSource {
+    public:
+        ReadAheadSource(const std::string& path, const uint64_t bytes_to_read,
+                        const uint64_t offset, const uint32_t buffer_size,
+                        const uint32_t in_flight_count)
+            : buf_size_{static_cast<uint32_t>(std::max<uint64_t>(
+                std::min<uint64_t>(bytes_to_read, buffer_size), 1))}
+            , region_{}
+            , next_region_{}
+            , has_next_region_{false}
+            , next_block_{0}
+            , released_end_{0}
+            , submitted_end_{0}
+            , has_given_block_{false}
+        {
+            const auto slots_count = in_flight_count;
+            for (auto i = uint32_t{}; i < slots_count; ++i) {
+                bufs_.emplace_back(new char[buf_size_]);
+            }
+
+            in_flight_.assign(slots_count, false);
+            reader_ = yzw2v::io::detail::MakeUringReader(path, slots_count);
+            if (!reader_) {
+                reader_ = yzw2v::io::detail::MakeThreadReader(path, slots_count);
+            }
+
+            StartOver(bytes_to_read, offset);
+        }
+
+        ~ReadAheadSource() override {
+            // requests must not outlive buffers
+            reader_.reset();
+        }
+
+        yzw2v::io::Block Next() override {
+            ReleaseGivenBlock();
+            SubmitBlocks();
+
+            if (next_block_ == region_.first_block + region_.blocks_count) {
+                return {nullptr, nullptr};
+            }
+
+            const auto slot = static_cast<uint32_t>(next_block_ % bufs_.size());
+            reader_->Wait(slot);
+            in_flight_[slot] = false;
+            has_given_block_ = true;
+
+            const auto* const buf = bufs_[slot].get();
+            const auto size = BlockSize(region_, next_block_++);
+            return {buf, buf + size};
+        }
+
+        void Restart() override {
+            StartOver(region_.bytes_to_read, region_.offset);
+        }
+
+        void Reset(const uint64_t bytes_to_read, const uint64_t offset) override {
+            const auto current_is_over =
+                next_block_ == region_.first_block + region_.blocks_count;
+            if (has_next_region_ && current_is_over && next_region_.bytes_to_read == bytes_to_read
+                && next_region_.offset == offset) {
+                // blocks of this region are read already or being read
+                ReleaseGivenBlock();
+                region_ = next_region_;
+                has_next_region_ = false;
+                SubmitBlocks();
+                return;
+            }
+
+            StartOver(bytes_to_read, offset);
+        }
+
+        void Prefetch(const uint64_t bytes_to_read, const uint64_t offset) override {
+            if (has_next_region_) {
+                // some of its blocks may be submitted already
+                return;
+            }
+
+            next_region_ = MakeRegion(bytes_to_read, offset,
+                                      region_.first_block + region_.blocks_count);
+            has_next_region_ = true;
+            SubmitBlocks();
+        }
+
+    private:
+        struct Region {
+            uint64_t offset;
+            uint64_t bytes_to_read;
+            uint64_t first_block;
+            uint64_t blocks_count;
+        };
+
+        Region MakeRegion(const uint64_t bytes_to_read, const uint64_t offset,
+                          const uint64_t first_block) const noexcept {
+            return {offset, bytes_to_read, first_block, (bytes_to_read + buf_size_ - 1) / buf_size_};
+        }
+
+        // Drops whatever is read ahead and starts reading region from scratch.
+        void StartOver(const uint64_t bytes_to_read, const uint64_t offset) {
+            WaitInFlight();
+            has_given_block_ = false;
+            has_next_region_ = false;
+
+            // numbering goes on, so every slot is free for the first blocks
+            region_ = MakeRegion(bytes_to_read, offset, submitted_end_);
+            next_block_ = submitted_end_;
+            released_end_ = submitted_end_;
+            SubmitBlocks();
+        }
+
+        void WaitInFlight() {
+            for (auto slot = uint32_t{}; slot < in_flight_.size(); ++slot) {
+                if (in_flight_[slot]) {
+                    reader_->Wait(slot);
+                    in_flight_[slot] = false;
+                }
+            }
+        }
+
+        void ReleaseGivenBlock() noexcept {
+            if (has_given_block_) {
+                // block given away last is not used anymore, its buffer can be refilled
+                released_end_ = next_block_;
+                has_given_block_ = false;
+            }
+        }
+
+        uint32_t BlockSize(const Region& region, const uint64_t block) const noexcept {
+            return static_cast<uint32_t>(std::min<uint64_t>(
+                buf_size_, region.bytes_to_read - (block - region.first_block) * buf_size_));
+        }
+
+        // Submits next blocks of current and next regions while there are free buffers.
+        void SubmitBlocks() {
+            while (submitted_end_ < released_end_ + bufs_.size()) {
+                const auto block = submitted_end_;
+                const auto& region = block < region_.first_block + region_.blocks_count
+                                     ? region_ : next_region_;
+                if (&region == &next_region_
+                    && (!has_next_region_ || block >= region.first_block + region.blocks_count)) {
+                    return;
+                }
+
+                const auto slot = static_cast<uint32_t>(block % bufs_.size());
+                reader_->Submit(slot, bufs_[slot].get(), BlockSize(region, block),
+                                region.offset + (block - region.first_block) * buf_size_);
+                in_flight_[slot] = true;
+                ++submitted_end_;
+            }
+        }
+
+    private:
+        const uint32_t buf_size_;
+        Region region_;
+        Region next_region_;
+        bool has_next_region_;
+
+        uint64_t next_block_;     // to be given away by `Next`
+        uint64_t released_end_;   // buffers of blocks before it can be refilled
+        uint64_t submitted_end_;  // blocks before it are read or being read
+        bool has_given_block_;    // block `next_block_ - 1` is still used by the caller
+
+        std::vector<std::unique_ptr<char[]>> bufs_;
+        std::vector<bool> in_flight_;
+        std::unique_ptr<yzw2v::io::detail::AsyncReader> reader_;
+    };
+}  // namespace
+
+std::unique_ptr<yzw2v::io::ByteSource> yzw2v::io::MakeByteSource(const std::string& path,
+                                                                 const uint64_t bytes_to_read,
+                                                                 const uint64_t offset,
+                                                                 const ReadOptions& options) {
+    switch (options.mode) {
+        case ReadMode::BUFFERED:
+            return std::unique_ptr<ByteSource>{
+                new StreamSource{path, bytes_to_read, offset, options.buffer_size}
+            };
+        case ReadMode::MMAP:
+            return std::unique_ptr<ByteSource>{new MappedSource{path, bytes_to_read, offset}};
+        case ReadMode::ASYNC:
+            if (options.in_flight_count < 2) {
+                throw std::runtime_error{"at least two buffers must be in flight"};
+            }
+
+            return std::unique_ptr<ByteSource>{
+                new ReadAheadSource{path, bytes_to_read, offset, options.buffer_size,
+                                    options.in_flight_count}
+            };
+    }
+
+    throw std::runtime_error{"unknown read mode"};
+}
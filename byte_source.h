@@ -0,0 +1,61 @@
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include <cstdint>
+
+namespace yzw2v {
+    namespace io {
+        static constexpr uint32_t DEFAULT_READ_BUFFER_SIZE = 1024 * 1024 * 32; // 32 Mb
+        static constexpr uint32_t DEFAULT_IN_FLIGHT_BUFFERS_COUNT = 2;
+
+        enum class ReadMode {
+            BUFFERED,  // `std::ifstream::read` into a buffer
+            MMAP,      // tokens point directly into memory mapped file
+            ASYNC      // next buffers are read by io_uring (or I/O thread) while current is parsed
+        };
+
+        struct ReadOptions {
+            ReadMode mode = ReadMode::BUFFERED;
+            uint32_t buffer_size = DEFAULT_READ_BUFFER_SIZE;  // for BUFFERED and ASYNC
+            uint32_t in_flight_count = DEFAULT_IN_FLIGHT_BUFFERS_COUNT;  // for ASYNC, at least 2
+        };
+
+        // Contiguous part of input, [begin, end)
+        struct Block {
+            const char* begin;
+            const char* end;
+        };
+
+        // Gives away input as a sequence of blocks; tokens may span several blocks.
+        class ByteSource {
+        public:
+            virtual ~ByteSource() = default;
+
+            // Returns empty block when input is over, previous block is invalidated.
+            virtual Block Next() = 0;
+
+            // Blocks stay valid after `Next` until `Restart` or `Reset`.
+            virtual bool KeepsBlocks() const noexcept {
+                return false;
+            }
+
+            // Start over from the first block.
+            virtual void Restart() = 0;
+
+            // Start over from the first block of another region of the same file.
+            virtual void Reset(const uint64_t bytes_to_read, const uint64_t offset) = 0;
+
+            // Region the next `Reset` is going to be called with, source may start reading it
+            // while current one is still being parsed. Only the first call after `Reset` counts.
+            virtual void Prefetch(const uint64_t /*bytes_to_read*/, const uint64_t /*offset*/) {
+            }
+        };
+
+        std::unique_ptr<ByteSource> MakeByteSource(const std::string& path,
+                                                   const uint64_t bytes_to_read,
+                                                   const uint64_t offset,
+                                                   const ReadOptions& options);
+    }
+}
@@ -2,62 +2,128 @@
 #include "token_reader.h"
 #include "io.h"
 
-#include <fstream>
+#include <algorithm>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <vector>
 
-#include <cstdio>
-
-/* You'll ask me: "Dude! Why do you write vocabulary to the disk?". The idea is following: To make
- * simple in-memory implementation of filtration we will need to allocate about the same amount of
- * memory we have already allocated (because we store tokens in memory pool) and because we deal
- * with "big data" (it's a homework on Large Scale Machine Learning, right?) we can't do it, but we
- * have disk! After all, we should be able to store vocabulary on disk, so we have some space on
- * disk and our vocabulary at this point must not be greater in size than vocabulary at the end of
- * input file processing.
- *
- * About performance. If we will create temprorary file in /tmp it will be located in tmpfs, which
- * means in-memory (see https://en.wikipedia.org/wiki/Tmpfs), so it should be fast.
- */
-static void RemoveInfrequentTokens(yzw2v::vocab::Vocabulary& vocab, const uint32_t min_token_freq) {
-    const std::unique_ptr<char[]> buf{new char[static_cast<uint32_t>(TMP_MAX) + 1]};
-    // btw, at least on Mac this function is deprecated
-    const auto tmp_file_path = std::string{std::tmpnam(buf.get())};
-
-    try {
-        WriteBinaryWithFilter(vocab, tmp_file_path, min_token_freq);
-        ReadBinary(tmp_file_path, vocab);
-    } catch (std::exception&) {
-        // not sure if we should check the return code
-        std::remove(tmp_file_path.c_str());
-        throw;
+// Smaller text is not worth splitting between threads.
+static constexpr uint64_t MIN_SLICE_SIZE = 1024 * 1024;  // 1 Mb
+
+// Tokens are added to vocabulary by batches of that many, see `Vocabulary::AddAll`.
+static constexpr uint32_t TOKENS_BATCH_SIZE = 64;
+
+// Tokens of `reader` are counted in `vocab`, `when_full` is called whenever it has more than
+// `max_size()` tokens.
+template <typename WhenFull>
+static void Collect(yzw2v::io::TokenReader& reader, yzw2v::vocab::Vocabulary& vocab,
+                    WhenFull&& when_full) {
+    yzw2v::vocab::Token tokens[TOKENS_BATCH_SIZE];
+    const std::unique_ptr<char[]> buffer{
+        new char[TOKENS_BATCH_SIZE * yzw2v::vocab::MAX_TOKEN_LENGTH]
+    };
+    while (!reader.Done()) {
+        for (auto index = uint32_t{}; !reader.Done() && index < 10000; index += TOKENS_BATCH_SIZE) {
+            vocab.AddAll(tokens, reader.Read(tokens, TOKENS_BATCH_SIZE, buffer.get()));
+        }
+
+        if (vocab.size() > vocab.max_size()) {
+            when_full();
+        }
+    }
+}
+
+static void RemoveInfrequent(yzw2v::vocab::Vocabulary& vocab,
+                             uint32_t& min_token_freq_during_collection) {
+    vocab.RemoveInfrequent(min_token_freq_during_collection);
+    ++min_token_freq_during_collection;
+}
+
+// Adds counts of `shard` to `vocab`, infrequent tokens are removed when it gets full.
+static void Merge(const yzw2v::vocab::Vocabulary& shard, yzw2v::vocab::Vocabulary& vocab,
+                  uint32_t& min_token_freq_during_collection) {
+    for (auto id = uint32_t{}; id < shard.size(); ++id) {
+        const auto info = shard.Token(id);
+        vocab.Add(info.token, info.count);
+        if ((id + 1) % 10000 == 0 && vocab.size() > vocab.max_size()) {
+            RemoveInfrequent(vocab, min_token_freq_during_collection);
+        }
+    }
+
+    if (vocab.size() > vocab.max_size()) {
+        RemoveInfrequent(vocab, min_token_freq_during_collection);
+    }
+}
+
+static void CollectInParallel(const std::string& path, const uint64_t file_size,
+                              const yzw2v::io::ReadOptions& read_options,
+                              const uint32_t threads_count, yzw2v::vocab::Vocabulary& vocab,
+                              uint32_t& min_token_freq_during_collection) {
+    const auto slice_size = std::max((file_size + threads_count - 1) / threads_count,
+                                     MIN_SLICE_SIZE);
+    const auto boundaries = yzw2v::io::SplitTextIntoChunks(path, file_size, slice_size);
+    const auto shard_size = std::max(vocab.max_size() / threads_count, uint32_t{1});
+
+    // shards are merged in whatever order they get full, `Sort` doesn't depend on the order
+    // tokens were added in, except for the paragraph token that must stay first
+    vocab.Add(yzw2v::vocab::PARAGRAPH_TOKEN, 0);
+
+    std::mutex vocab_mutex;
+    const auto merge = [&vocab, &vocab_mutex, &min_token_freq_during_collection](
+            const yzw2v::vocab::Vocabulary& shard) {
+        std::lock_guard<std::mutex> lock{vocab_mutex};
+        Merge(shard, vocab, min_token_freq_during_collection);
+    };
+
+    auto jobs = std::vector<std::future<void>>{};
+    for (auto i = size_t{}; i + 1 < boundaries.size(); ++i) {
+        jobs.emplace_back(std::async(std::launch::async,
+            [&path, &read_options, &boundaries, &merge, shard_size, i]{
+                // slice after the first one starts right after '\n', paragraph token of which is
+                // read by previous slice
+                yzw2v::io::TokenReader reader{path, boundaries[i + 1] - boundaries[i],
+                                              boundaries[i], read_options};
+                yzw2v::vocab::Vocabulary shard{shard_size};
+                Collect(reader, shard, [&shard, &merge, shard_size]{
+                    merge(shard);
+                    shard = yzw2v::vocab::Vocabulary{shard_size};
+                });
+                merge(shard);
+        }));
+    }
+
+    for (auto&& job : jobs) {
+        job.get();
     }
 }
 
 void yzw2v::vocab::CollectIntoVocabulary(const std::string& path, const uint32_t min_token_freq,
-                                         Vocabulary& vocab) {
+                                         const io::ReadOptions& read_options, Vocabulary& vocab,
+                                         const uint32_t threads_count) {
     const auto file_size = io::FileSize(path);
     auto min_token_freq_during_collection = uint32_t{2};
-    io::TokenReader reader{path, file_size};
-    while (!reader.Done()) {
-        for (auto index = 0; !reader.Done() && index < 10000; ++index) {
-            vocab.Add(reader.Read());
-        }
-
-        if (vocab.LoadFactor() > 0.7f) {
-            RemoveInfrequentTokens(vocab, min_token_freq_during_collection);
-            ++min_token_freq_during_collection;
-        }
+    if (threads_count > 1 && file_size > MIN_SLICE_SIZE) {
+        CollectInParallel(path, file_size, read_options, threads_count, vocab,
+                          min_token_freq_during_collection);
+    } else {
+        io::TokenReader reader{path, file_size, 0, read_options};
+        Collect(reader, vocab, [&vocab, &min_token_freq_during_collection]{
+            RemoveInfrequent(vocab, min_token_freq_during_collection);
+        });
     }
 
-    RemoveInfrequentTokens(vocab, min_token_freq);
+    vocab.RemoveInfrequent(min_token_freq);
 
     vocab.Sort();
 }
 
 yzw2v::vocab::Vocabulary yzw2v::vocab::CollectVocabulary(const std::string& path,
                                                          const uint32_t min_token_freq,
-                                                         const uint32_t max_number_of_tokens) {
+                                                         const uint32_t max_number_of_tokens,
+                                                         const io::ReadOptions& read_options,
+                                                         const uint32_t threads_count) {
     Vocabulary vocab{max_number_of_tokens};
-    CollectIntoVocabulary(path, min_token_freq, vocab);
+    CollectIntoVocabulary(path, min_token_freq, read_options, vocab, threads_count);
     return vocab;
 }
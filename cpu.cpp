@@ -0,0 +1,89 @@
+#include "cpu.h"
+
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+static void CPUID(const uint32_t leaf, const uint32_t subleaf, uint32_t (&regs)[4]) noexcept {
+#if defined(_MSC_VER)
+    int info[4] = {};
+    __cpuidex(info, static_cast<int>(leaf), static_cast<int>(subleaf));
+    for (auto i = 0; i < 4; ++i) {
+        regs[i] = static_cast<uint32_t>(info[i]);
+    }
+#else
+    __cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+static uint64_t XGETBV() noexcept {
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    // `_xgetbv` intrinsic requires `-mxsave`, which we don't want to enable for the whole TU
+    uint32_t eax = 0;
+    uint32_t edx = 0;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return (static_cast<uint64_t>(edx) << 32) | eax;
+#endif
+}
+
+static yzw2v::cpu::Features Detect() noexcept {
+    auto res = yzw2v::cpu::Features{};
+
+    uint32_t regs[4] = {};
+    CPUID(0, 0, regs);
+    const auto max_leaf = regs[0];
+    if (max_leaf < 1) {
+        return res;
+    }
+
+    CPUID(1, 0, regs);
+    const auto ecx1 = regs[2];
+    const auto edx1 = regs[3];
+    res.sse2 = edx1 & (uint32_t{1} << 26);
+    res.sse42 = ecx1 & (uint32_t{1} << 20);
+
+    const auto os_uses_xsave = ecx1 & (uint32_t{1} << 27);
+    const auto cpu_has_avx = ecx1 & (uint32_t{1} << 28);
+    if (!os_uses_xsave || !cpu_has_avx) {
+        return res;
+    }
+
+    // XMM and YMM state must be enabled by OS
+    const auto xcr0 = XGETBV();
+    res.avx = (xcr0 & 0x6) == 0x6;
+    if (!res.avx) {
+        return res;
+    }
+
+    res.fma = ecx1 & (uint32_t{1} << 12);
+    res.f16c = ecx1 & (uint32_t{1} << 29);
+    if (max_leaf < 7) {
+        return res;
+    }
+
+    CPUID(7, 0, regs);
+    const auto ebx7 = regs[1];
+    res.avx2 = ebx7 & (uint32_t{1} << 5);
+
+    // additionally opmask and both halves of ZMM state must be enabled by OS
+    res.avx512f = (ebx7 & (uint32_t{1} << 16)) && (xcr0 & 0xE6) == 0xE6;
+
+    return res;
+}
+#else
+static yzw2v::cpu::Features Detect() noexcept {
+    return {};
+}
+#endif
+
+const yzw2v::cpu::Features& yzw2v::cpu::GetFeatures() noexcept {
+    static const auto features = Detect();
+    return features;
+}
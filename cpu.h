@@ -0,0 +1,20 @@
+#pragma once
+
+namespace yzw2v {
+    namespace cpu {
+        // Instruction set extensions that are supported both by CPU and by OS (e.g. OS saves
+        // AVX registers on context switch).
+        struct Features {
+            bool sse2 = false;
+            bool sse42 = false;
+            bool avx = false;
+            bool avx2 = false;
+            bool fma = false;
+            bool f16c = false;
+            bool avx512f = false;
+        };
+
+        // Detected via CPUID once on the first call.
+        const Features& GetFeatures() noexcept;
+    }
+}
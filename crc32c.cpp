@@ -0,0 +1,54 @@
+#include "crc32c.h"
+
+#include "cpu.h"
+
+#include <array>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define YZ_CRC_SSE42
+#endif
+
+static constexpr uint32_t POLYNOMIAL = 0x82F63B78;  // reversed 0x1EDC6F41
+
+static std::array<uint32_t, 256> MakeTable() noexcept {
+    auto res = std::array<uint32_t, 256>{};
+    for (auto i = uint32_t{}; i < res.size(); ++i) {
+        auto value = i;
+        for (auto bit = 0; bit < 8; ++bit) {
+            value = (value >> 1) ^ (value & 1 ? POLYNOMIAL : 0);
+        }
+
+        res[i] = value;
+    }
+
+    return res;
+}
+
+static const std::array<uint32_t, 256> TABLE = MakeTable();
+
+static uint32_t CRC32CSimple(const char* const data, const size_t size) noexcept {
+    auto crc = ~uint32_t{};
+    for (auto i = size_t{}; i < size; ++i) {
+        crc = (crc >> 8) ^ TABLE[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF];
+    }
+
+    return ~crc;
+}
+
+using CRC32CFunction = uint32_t (*)(const char* const data, const size_t size) noexcept;
+
+static CRC32CFunction Best() noexcept {
+#if defined(YZ_CRC_SSE42)
+    if (yzw2v::cpu::GetFeatures().sse42) {
+        return yzw2v::crc::detail::CRC32CSSE42;
+    }
+#endif
+
+    return CRC32CSimple;
+}
+
+static const CRC32CFunction CRC32C_IMPL = Best();
+
+uint32_t yzw2v::crc::CRC32C(const char* const data, const size_t size) noexcept {
+    return CRC32C_IMPL(data, size);
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace yzw2v {
+    namespace crc {
+        /* CRC-32C (Castagnoli), the one of iSCSI and SSE4.2 `crc32` instruction. Computed with
+         * that instruction if CPU has it (selected at runtime, see crc32c.cpp), byte by byte
+         * with a table otherwise; both give the same value.
+         */
+        uint32_t CRC32C(const char* const data, const size_t size) noexcept;
+
+        namespace detail {
+            // Compiled with SSE4.2 enabled (crc32c_sse42.cpp), only x86 has it.
+            uint32_t CRC32CSSE42(const char* const data, const size_t size) noexcept;
+        }
+    }
+}
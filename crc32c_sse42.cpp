@@ -0,0 +1,31 @@
+#include "crc32c.h"
+
+#include <cstring>
+
+#include <nmmintrin.h>
+
+uint32_t yzw2v::crc::detail::CRC32CSSE42(const char* const data, const size_t size) noexcept {
+    auto crc = ~uint32_t{};
+    auto i = size_t{};
+#if defined(__x86_64__) || defined(_M_X64)
+    auto crc64 = uint64_t{crc};
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        auto chunk = uint64_t{};
+        std::memcpy(&chunk, data + i, sizeof(chunk));
+        crc64 = _mm_crc32_u64(crc64, chunk);
+    }
+
+    crc = static_cast<uint32_t>(crc64);
+#endif
+    for (; i + sizeof(uint32_t) <= size; i += sizeof(uint32_t)) {
+        auto chunk = uint32_t{};
+        std::memcpy(&chunk, data + i, sizeof(chunk));
+        crc = _mm_crc32_u32(crc, chunk);
+    }
+
+    for (; i < size; ++i) {
+        crc = _mm_crc32_u8(crc, static_cast<uint8_t>(data[i]));
+    }
+
+    return ~crc;
+}
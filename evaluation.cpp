@@ -0,0 +1,266 @@
+#include "evaluation.h"
+
+#include "numeric.h"
+#include "query.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+#include <cmath>
+#include <cstring>
+
+// Questions are answered by batches of that many, every batch is a single `query::Nearest` call.
+static constexpr uint32_t QUESTIONS_BATCH_SIZE = 8192;
+
+// Three words of a question are excluded from answers, so one more is enough.
+static constexpr uint32_t ANSWERS_COUNT = 4;
+
+static std::string ToLower(std::string word) {
+    for (auto& c : word) {
+        if (c >= 'A' && c <= 'Z') {
+            c = static_cast<char>(c - 'A' + 'a');
+        }
+    }
+
+    return word;
+}
+
+yzw2v::eval::Evaluator::Evaluator(const query::Model& model, const uint32_t top_count) {
+    const auto rows_count = top_count ? std::min(top_count, model.rows_count())
+                                      : model.rows_count();
+    const auto columns_count = model.columns_count();
+    rows_.reset(new num::Matrix{rows_count, columns_count});
+    vocab_.reset(new vocab::Vocabulary{std::max(rows_count, uint32_t{1})});
+    for (auto i = uint32_t{}; i < rows_count; ++i) {
+        std::memcpy(rows_->row(i), model.matrix().row(i), sizeof(float) * columns_count);
+
+        // when words differ only by case the most frequent one is used
+        const auto token = model.vocab().Token(i).token;
+        const auto word = ToLower({token.cbegin(), token.cend()});
+        if (vocab_->Add({word.data(), word.data() + word.size()}) == rows_of_words_.size()) {
+            rows_of_words_.push_back(i);
+        }
+    }
+}
+
+uint32_t yzw2v::eval::Evaluator::ID(const std::string& word) const noexcept {
+    if (word.empty() || word.size() >= vocab::MAX_TOKEN_LENGTH) {
+        return vocab::INVALID_TOKEN_ID;
+    }
+
+    const auto lower = ToLower(word);
+    const auto id = vocab_->ID({lower.data(), lower.data() + lower.size()});
+    return vocab::INVALID_TOKEN_ID == id ? id : rows_of_words_[id];
+}
+
+namespace {
+    struct Question {
+        uint32_t words[4];  // a is to b as c is to d
+        uint32_t section;
+    };
+
+    struct Section {
+        std::string name;
+        uint32_t correct_count;
+        uint32_t questions_count;
+    };
+}
+
+static void WriteAccuracy(std::ostream& out, const std::string& name,
+                          const uint32_t correct_count, const uint32_t questions_count) {
+    out << name << ": " << std::fixed << std::setprecision(2)
+        << (questions_count ? 100.0 * correct_count / questions_count : 0.0) << "% ("
+        << correct_count << " / " << questions_count << ")\n";
+}
+
+void yzw2v::eval::Evaluator::EvaluateAnalogies(const std::string& path,
+                                               const uint32_t threads_count,
+                                               std::ostream& out) const {
+    std::ifstream in{path};
+    if (!in) {
+        throw std::runtime_error{"failed to open analogies file"};
+    }
+
+    auto sections = std::vector<Section>{};
+    auto questions = std::vector<Question>{};
+    auto all_questions_count = uint32_t{};
+    for (auto line = std::string{}; std::getline(in, line);) {
+        std::istringstream line_in{line};
+        if (!line.empty() && ':' == line.front()) {
+            line_in.ignore(1);
+            auto name = std::string{};
+            line_in >> name;
+            sections.push_back({name, 0, 0});
+            continue;
+        }
+
+        std::string words[4];
+        if (!(line_in >> words[0] >> words[1] >> words[2] >> words[3])) {
+            continue;
+        }
+
+        if (sections.empty()) {
+            sections.push_back({"(no section)", 0, 0});
+        }
+
+        ++all_questions_count;
+        auto question = Question{{}, static_cast<uint32_t>(sections.size() - 1)};
+        auto known = true;
+        for (auto i = 0; i < 4; ++i) {
+            question.words[i] = ID(words[i]);
+            known = known && vocab::INVALID_TOKEN_ID != question.words[i];
+        }
+
+        if (known) {
+            questions.push_back(question);
+        }
+    }
+
+    const auto start_time = std::chrono::steady_clock::now();
+    const auto columns_count = rows_->columns_count();
+    for (auto batch_begin = size_t{}; batch_begin < questions.size();
+         batch_begin += QUESTIONS_BATCH_SIZE) {
+        const auto batch_size = static_cast<uint32_t>(
+            std::min<size_t>(QUESTIONS_BATCH_SIZE, questions.size() - batch_begin));
+        num::Matrix queries{batch_size, columns_count};
+        for (auto i = uint32_t{}; i < batch_size; ++i) {
+            const auto& words = questions[batch_begin + i].words;
+            auto* const query = queries.row(i);
+            std::memcpy(query, rows_->row(words[1]), sizeof(float) * columns_count);
+            num::AddVector(query, columns_count, rows_->row(words[0]), -1.0f);
+            num::AddVector(query, columns_count, rows_->row(words[2]));
+
+            const auto norm = std::sqrt(num::ScalarProduct(query, columns_count, query));
+            if (norm > 0.0f) {
+                num::DivideVector(query, columns_count, norm);
+            }
+        }
+
+        const auto answers = query::Nearest(*rows_, queries, nullptr, ANSWERS_COUNT,
+                                            threads_count);
+        for (auto i = uint32_t{}; i < batch_size; ++i) {
+            const auto& question = questions[batch_begin + i];
+            const auto* const question_answers = answers.data() + i * ANSWERS_COUNT;
+            for (auto j = uint32_t{}; j < ANSWERS_COUNT; ++j) {
+                const auto id = question_answers[j].id;
+                if (question.words[0] != id && question.words[1] != id
+                    && question.words[2] != id) {
+                    sections[question.section].correct_count += question.words[3] == id;
+                    break;
+                }
+            }
+
+            ++sections[question.section].questions_count;
+        }
+    }
+
+    const auto seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start_time).count();
+
+    uint32_t correct_counts[2] = {};  // semantic, syntactic
+    uint32_t questions_counts[2] = {};
+    for (const auto& section : sections) {
+        WriteAccuracy(out, section.name, section.correct_count, section.questions_count);
+
+        const auto syntactic = 0 == section.name.compare(0, 4, "gram");
+        correct_counts[syntactic] += section.correct_count;
+        questions_counts[syntactic] += section.questions_count;
+    }
+
+    WriteAccuracy(out, "Semantic", correct_counts[0], questions_counts[0]);
+    WriteAccuracy(out, "Syntactic", correct_counts[1], questions_counts[1]);
+    WriteAccuracy(out, "Total", correct_counts[0] + correct_counts[1],
+                  static_cast<uint32_t>(questions.size()));
+    out << "Questions seen: " << questions.size() << " / " << all_questions_count << " ("
+        << (all_questions_count ? 100.0 * questions.size() / all_questions_count : 0.0)
+        << "%)\n";
+    out << "Answered in " << std::setprecision(3) << seconds << " seconds, "
+        << static_cast<uint64_t>(questions.size() / std::max(seconds, 1e-6))
+        << " questions/sec" << std::endl;
+}
+
+// Ranks from 1, tied values get their average rank.
+static std::vector<double> Ranks(const std::vector<double>& values) {
+    auto order = std::vector<size_t>(values.size());
+    for (auto i = size_t{}; i < order.size(); ++i) {
+        order[i] = i;
+    }
+
+    std::sort(order.begin(), order.end(), [&values](const size_t lhs, const size_t rhs) {
+        return values[lhs] < values[rhs];
+    });
+
+    auto ranks = std::vector<double>(values.size());
+    for (auto begin = size_t{}; begin < order.size();) {
+        auto end = begin + 1;
+        for (; end < order.size() && values[order[end]] == values[order[begin]]; ++end);
+        for (auto i = begin; i < end; ++i) {
+            ranks[order[i]] = (begin + end + 1) / 2.0;
+        }
+
+        begin = end;
+    }
+
+    return ranks;
+}
+
+static double SpearmanCorrelation(const std::vector<double>& lhs, const std::vector<double>& rhs) {
+    const auto lhs_ranks = Ranks(lhs);
+    const auto rhs_ranks = Ranks(rhs);
+    const auto mean = (lhs.size() + 1) / 2.0;
+    auto covariance = double{};
+    auto lhs_variance = double{};
+    auto rhs_variance = double{};
+    for (auto i = size_t{}; i < lhs.size(); ++i) {
+        covariance += (lhs_ranks[i] - mean) * (rhs_ranks[i] - mean);
+        lhs_variance += (lhs_ranks[i] - mean) * (lhs_ranks[i] - mean);
+        rhs_variance += (rhs_ranks[i] - mean) * (rhs_ranks[i] - mean);
+    }
+
+    if (!(lhs_variance > 0.0) || !(rhs_variance > 0.0)) {
+        return 0.0;
+    }
+
+    return covariance / std::sqrt(lhs_variance * rhs_variance);
+}
+
+void yzw2v::eval::Evaluator::EvaluateSimilarity(const std::string& path,
+                                                std::ostream& out) const {
+    std::ifstream in{path};
+    if (!in) {
+        throw std::runtime_error{"failed to open similarity file"};
+    }
+
+    auto similarities = std::vector<double>{};
+    auto scores = std::vector<double>{};
+    auto pairs_count = uint32_t{};
+    for (auto line = std::string{}; std::getline(in, line);) {
+        std::istringstream line_in{line};
+        auto lhs = std::string{};
+        auto rhs = std::string{};
+        auto score = double{};
+        if (!(line_in >> lhs >> rhs >> score)) {
+            continue;
+        }
+
+        ++pairs_count;
+        const auto lhs_id = ID(lhs);
+        const auto rhs_id = ID(rhs);
+        if (vocab::INVALID_TOKEN_ID == lhs_id || vocab::INVALID_TOKEN_ID == rhs_id) {
+            continue;
+        }
+
+        similarities.push_back(num::ScalarProduct(rows_->row(lhs_id), rows_->columns_count(),
+                                                  rows_->row(rhs_id)));
+        scores.push_back(score);
+    }
+
+    out << path << ": spearman " << std::fixed << std::setprecision(4)
+        << SpearmanCorrelation(similarities, scores) << ", pairs used " << similarities.size()
+        << " / " << pairs_count << std::endl;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "matrix.h"
+#include "vocabulary.h"
+
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <cstdint>
+
+namespace yzw2v {
+    namespace query {
+        class Model;
+    }
+}
+
+namespace yzw2v {
+    namespace eval {
+        /* Quality of word vectors on analogy and word similarity datasets, done the way
+         * `compute-accuracy` of word2vec does it: only `top_count` most frequent words of the
+         * model are used (rows of model go in order of vocabulary, the most frequent first) and
+         * words are compared case insensitively (ASCII only).
+         */
+        class Evaluator {
+        public:
+            // `top_count` of 0 means all words of the model.
+            Evaluator(const query::Model& model, const uint32_t top_count);
+
+            /* Analogies file is a list of sections, ": name" line followed by "a b c d" lines.
+             * Answer to a question is the word with vector most similar to `b - a + c` among
+             * all but `a`, `b` and `c`; it's correct if it's `d`. Questions with words out of
+             * the used part of vocabulary are skipped.
+             *
+             * Questions are answered in batches with `query::Nearest` by `threads_count`
+             * threads. Accuracy of every section, semantic ones, syntactic ones (name starts
+             * with "gram"), total and throughput are written to `out`.
+             */
+            void EvaluateAnalogies(const std::string& path, const uint32_t threads_count,
+                                   std::ostream& out) const;
+
+            /* Similarity file has "word word score" lines (lines that don't parse are skipped,
+             * e.g. headers). Spearman's rank correlation of cosine similarity with the scores is
+             * written to `out`, together with the number of pairs used.
+             */
+            void EvaluateSimilarity(const std::string& path, std::ostream& out) const;
+
+        private:
+            // `vocab::INVALID_TOKEN_ID` if word is not one of `top_count` words
+            uint32_t ID(const std::string& word) const noexcept;
+
+            std::unique_ptr<num::Matrix> rows_;
+            std::unique_ptr<vocab::Vocabulary> vocab_;  // lowercased
+            std::vector<uint32_t> rows_of_words_;       // by id in `vocab_`
+        };
+    }
+}
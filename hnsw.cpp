@@ -0,0 +1,647 @@
+#include "hnsw.h"
+
+#include "io.h"
+#include "matrix.h"
+#include "numeric.h"
+#include "prng.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+
+#include <cmath>
+#include <cstring>
+
+static const char HNSW_INDEX_MAGIC[] = {"YZW2V_HNSW_INDEX"};
+static constexpr size_t HNSW_INDEX_MAGIC_SIZE = sizeof(HNSW_INDEX_MAGIC)
+                                                / sizeof(HNSW_INDEX_MAGIC[0]);
+
+/* [HNSW_INDEX_MAGIC, rows count, hash(rows count), columns count, hash(columns count), m,
+ * hash(m), max level, hash(max level), entry point, hash(entry point)], padded by zeros.
+ *
+ * Sections that follow are padded to `SECTION_ALIGNMENT` bytes:
+ * - level of every row, uint8;
+ * - offset of upper levels links of every row in the last section, uint32;
+ * - links on level 0 of every row, [count, id * (2 * m)] of uint32;
+ * - links on upper levels of rows with level > 0, [count, id * m] of uint32 per level.
+ */
+static constexpr size_t HEADER_SIZE = 64;
+static constexpr size_t SECTION_ALIGNMENT = 64;
+static constexpr uint32_t HEADER_VALUES_COUNT = 10;
+static_assert(HNSW_INDEX_MAGIC_SIZE + HEADER_VALUES_COUNT * sizeof(uint32_t) <= HEADER_SIZE,
+              "header doesn't fit");
+
+static constexpr uint32_t MAX_LEVEL = 16;
+
+// Links of row `id` are guarded by `locks[id % LOCKS_COUNT]` during build.
+static constexpr uint32_t LOCKS_COUNT = 1 << 16;
+
+// Queries are taken by search threads in chunks of that many.
+static constexpr uint32_t QUERIES_CHUNK_SIZE = 64;
+
+static uint32_t IntHash(const uint32_t value) noexcept {
+    // Knuth's Multiplicative Method
+    return value * uint32_t{2654435761};
+}
+
+static size_t AlignSection(const size_t size) noexcept {
+    return (size + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+}
+
+static size_t Level0LinksSize(const uint32_t m) noexcept {
+    return 1 + 2 * size_t{m};
+}
+
+static size_t UpperLinksSize(const uint32_t m) noexcept {
+    return 1 + size_t{m};
+}
+
+static bool MoreSimilar(const yzw2v::query::Neighbour& lhs,
+                        const yzw2v::query::Neighbour& rhs) noexcept {
+    return lhs.similarity > rhs.similarity;
+}
+
+static bool LessSimilar(const yzw2v::query::Neighbour& lhs,
+                        const yzw2v::query::Neighbour& rhs) noexcept {
+    return lhs.similarity < rhs.similarity;
+}
+
+namespace yzw2v {
+    namespace hnsw {
+        namespace detail {
+            class SearchState {
+            public:
+                explicit SearchState(const uint32_t rows_count)
+                    : visited_(rows_count)
+                    , search_{0} {
+                }
+
+                void Start() noexcept {
+                    if (!++search_) {
+                        std::fill(visited_.begin(), visited_.end(), 0);
+                        search_ = 1;
+                    }
+                }
+
+                // false if `id` was already visited by the current search
+                bool Visit(const uint32_t id) noexcept {
+                    if (search_ == visited_[id]) {
+                        return false;
+                    }
+
+                    visited_[id] = search_;
+                    return true;
+                }
+
+                std::vector<query::Neighbour> candidates;  // max-heap
+                std::vector<query::Neighbour> results;     // min-heap
+                std::vector<uint32_t> links;
+                std::vector<query::Neighbour> selected;
+                std::vector<query::Neighbour> relinked;
+                std::vector<query::Neighbour> reselected;
+
+            private:
+                std::vector<uint32_t> visited_;
+                uint32_t search_;
+            };
+        }
+    }
+}
+
+static float Similarity(const yzw2v::num::Matrix& rows, const float* const query,
+                        const uint32_t id) noexcept {
+    return yzw2v::num::ScalarProduct(query, rows.columns_count(), rows.row(id));
+}
+
+/* The most similar row to `query` reachable from `entry` on `level` by moving to a more similar
+ * linked row while there is one. `read_links(id, level, links)` copies links of row to `links`.
+ */
+template <typename ReadLinks>
+static yzw2v::query::Neighbour SearchClosest(const yzw2v::num::Matrix& rows,
+                                             const float* const query,
+                                             yzw2v::query::Neighbour entry,
+                                             const uint32_t level, const ReadLinks& read_links,
+                                             std::vector<uint32_t>& links) {
+    for (auto changed = true; changed;) {
+        changed = false;
+        read_links(entry.id, level, links);
+        for (const auto id : links) {
+            const auto similarity = Similarity(rows, query, id);
+            if (similarity > entry.similarity) {
+                entry = {id, similarity};
+                changed = true;
+            }
+        }
+    }
+
+    return entry;
+}
+
+/* Best-first search on `level` from `entry`, leaves up to `ef` rows most similar to `query` in
+ * `state.results` (a heap, the least similar first).
+ */
+template <typename ReadLinks>
+static void SearchLevel(const yzw2v::num::Matrix& rows, const float* const query,
+                        const yzw2v::query::Neighbour entry, const uint32_t ef,
+                        const uint32_t level, const ReadLinks& read_links,
+                        yzw2v::hnsw::detail::SearchState& state) {
+    auto& candidates = state.candidates;
+    auto& results = state.results;
+    state.Start();
+    state.Visit(entry.id);
+    candidates.assign(1, entry);
+    results.assign(1, entry);
+    while (!candidates.empty()) {
+        const auto candidate = candidates.front();
+        if (results.size() >= ef && candidate.similarity < results.front().similarity) {
+            break;
+        }
+
+        std::pop_heap(candidates.begin(), candidates.end(), LessSimilar);
+        candidates.pop_back();
+
+        read_links(candidate.id, level, state.links);
+        for (const auto id : state.links) {
+            yzw2v::num::Prefetch(rows.row(id));
+        }
+
+        for (const auto id : state.links) {
+            if (!state.Visit(id)) {
+                continue;
+            }
+
+            const auto similarity = Similarity(rows, query, id);
+            if (results.size() < ef || similarity > results.front().similarity) {
+                candidates.push_back({id, similarity});
+                std::push_heap(candidates.begin(), candidates.end(), LessSimilar);
+                results.push_back({id, similarity});
+                std::push_heap(results.begin(), results.end(), MoreSimilar);
+                if (results.size() > ef) {
+                    std::pop_heap(results.begin(), results.end(), MoreSimilar);
+                    results.pop_back();
+                }
+            }
+        }
+    }
+}
+
+/* Heuristic of the paper: candidate (the most similar first) is selected only if it's more
+ * similar to the base row than to any of already selected ones, so links go to different
+ * directions instead of a single dense cluster.
+ */
+static void SelectNeighbours(const yzw2v::num::Matrix& rows,
+                             const std::vector<yzw2v::query::Neighbour>& candidates,
+                             const uint32_t count, std::vector<yzw2v::query::Neighbour>& res) {
+    res.clear();
+    for (const auto& candidate : candidates) {
+        if (res.size() >= count) {
+            break;
+        }
+
+        const auto* const row = rows.row(candidate.id);
+        const auto diverse = std::none_of(res.cbegin(), res.cend(),
+            [&rows, &candidate, row](const yzw2v::query::Neighbour& selected) {
+                return Similarity(rows, row, selected.id) > candidate.similarity;
+        });
+        if (diverse) {
+            res.push_back(candidate);
+        }
+    }
+}
+
+namespace {
+    class GraphBuilder {
+    public:
+        GraphBuilder(const yzw2v::num::Matrix& rows, const yzw2v::hnsw::BuildParams& params)
+            : rows_{rows}
+            , p_(params)
+            , levels_(rows.rows_count())
+            , upper_offsets_(rows.rows_count())
+            , locks_(LOCKS_COUNT)
+            , max_level_{0}
+            , entry_point_{0} {
+        }
+
+        void Build() {
+            const auto rows_count = rows_.rows_count();
+            auto prng = yzw2v::sampling::PRNG{p_.seed};
+            const auto level_multiple = 1.0 / std::log(static_cast<double>(std::max(p_.m, 2u)));
+            auto upper_links_count = size_t{};
+            for (auto i = uint32_t{}; i < rows_count; ++i) {
+                const auto level = static_cast<uint32_t>(
+                    -std::log(1.0 - prng.real_0_inc_1_exc()) * level_multiple);
+                levels_[i] = static_cast<uint8_t>(std::min(level, MAX_LEVEL));
+                upper_offsets_[i] = static_cast<uint32_t>(upper_links_count);
+                upper_links_count += levels_[i] * UpperLinksSize(p_.m);
+                if (upper_links_count > std::numeric_limits<uint32_t>::max()) {
+                    throw std::runtime_error{"too many links on upper levels"};
+                }
+            }
+
+            level0_links_.assign(rows_count * Level0LinksSize(p_.m), 0);
+            upper_links_.assign(upper_links_count, 0);
+            max_level_ = levels_.front();
+            entry_point_ = 0;
+
+            std::atomic<uint32_t> next_id{1};
+            const auto run = [this, &next_id, rows_count]{
+                yzw2v::hnsw::detail::SearchState state{rows_count};
+                for (auto id = next_id++; id < rows_count; id = next_id++) {
+                    Insert(id, state);
+                }
+            };
+
+            auto jobs = std::vector<std::future<void>>{};
+            for (auto i = uint32_t{1}; i < p_.threads_count; ++i) {
+                jobs.emplace_back(std::async(std::launch::async, run));
+            }
+
+            run();
+            for (auto&& job : jobs) {
+                job.get();
+            }
+        }
+
+        void Write(const std::string& path) const {
+            std::ofstream out{path, std::ios::binary};
+            if (!out) {
+                throw std::runtime_error{"failed to open file for write"};
+            }
+
+            static constexpr auto BUFFER_SIZE = size_t{1024} * 1024 * 128; // 128 Mb
+            yzw2v::io::BinaryBufferedWriteProxy proxy{out, BUFFER_SIZE};
+            {
+                char header[HEADER_SIZE] = {};
+                auto* cur = header;
+                std::memcpy(cur, HNSW_INDEX_MAGIC, HNSW_INDEX_MAGIC_SIZE);
+                cur += HNSW_INDEX_MAGIC_SIZE;
+                for (const auto value : {rows_.rows_count(), rows_.columns_count(), p_.m,
+                                         max_level_, entry_point_}) {
+                    for (const auto v : {value, IntHash(value)}) {
+                        std::memcpy(cur, &v, sizeof(v));
+                        cur += sizeof(v);
+                    }
+                }
+
+                proxy.Write(header, HEADER_SIZE);
+            }
+
+            static const char PADDING[SECTION_ALIGNMENT] = {};
+            const auto write_section = [&proxy](const void* const data, const size_t size) {
+                proxy.Write(data, size);
+                proxy.Write(PADDING, AlignSection(size) - size);
+            };
+            write_section(levels_.data(), levels_.size());
+            write_section(upper_offsets_.data(), sizeof(uint32_t) * upper_offsets_.size());
+            write_section(level0_links_.data(), sizeof(uint32_t) * level0_links_.size());
+            write_section(upper_links_.data(), sizeof(uint32_t) * upper_links_.size());
+        }
+
+        uint32_t max_level() const noexcept {
+            return max_level_;
+        }
+
+    private:
+        uint32_t* Links(const uint32_t id, const uint32_t level) noexcept {
+            if (!level) {
+                return level0_links_.data() + id * Level0LinksSize(p_.m);
+            }
+
+            return upper_links_.data() + upper_offsets_[id] + (level - 1) * UpperLinksSize(p_.m);
+        }
+
+        std::mutex& Lock(const uint32_t id) noexcept {
+            return locks_[id % LOCKS_COUNT];
+        }
+
+        void Insert(const uint32_t id, yzw2v::hnsw::detail::SearchState& state) {
+            const uint32_t level = levels_[id];
+
+            // new top level is rare, so insertion is just serialized in that case
+            std::unique_lock<std::mutex> entry_point_lock{entry_point_lock_};
+            const auto max_level = max_level_;
+            const auto entry_point = entry_point_;
+            if (level <= max_level) {
+                entry_point_lock.unlock();
+            }
+
+            const auto read_links = [this](const uint32_t link_id, const uint32_t link_level,
+                                           std::vector<uint32_t>& links) {
+                const std::lock_guard<std::mutex> lock{Lock(link_id)};
+                const auto* const link = Links(link_id, link_level);
+                links.assign(link + 1, link + 1 + *link);
+            };
+
+            const auto* const query = rows_.row(id);
+            auto entry = yzw2v::query::Neighbour{entry_point, Similarity(rows_, query, entry_point)};
+            for (auto l = max_level; l > level; --l) {
+                entry = SearchClosest(rows_, query, entry, l, read_links, state.links);
+            }
+
+            for (auto l = std::min(level, max_level) + 1; l-- > 0;) {
+                SearchLevel(rows_, query, entry, p_.ef_construction, l, read_links, state);
+                std::sort(state.results.begin(), state.results.end(), MoreSimilar);
+                entry = state.results.front();
+                SelectNeighbours(rows_, state.results, p_.m, state.selected);
+                {
+                    const std::lock_guard<std::mutex> lock{Lock(id)};
+                    auto* const links = Links(id, l);
+                    links[0] = static_cast<uint32_t>(state.selected.size());
+                    for (auto i = size_t{}; i < state.selected.size(); ++i) {
+                        links[1 + i] = state.selected[i].id;
+                    }
+                }
+
+                for (const auto& neighbour : state.selected) {
+                    Link(neighbour, id, l, state);
+                }
+            }
+
+            if (level > max_level) {
+                max_level_ = level;
+                entry_point_ = id;
+            }
+        }
+
+        // Adds back link from `neighbour` to `id`, links of `neighbour` are selected again if
+        // there are too many.
+        void Link(const yzw2v::query::Neighbour& neighbour, const uint32_t id,
+                  const uint32_t level, yzw2v::hnsw::detail::SearchState& state) {
+            const auto max_links_count = level ? p_.m : 2 * p_.m;
+            const std::lock_guard<std::mutex> lock{Lock(neighbour.id)};
+            auto* const links = Links(neighbour.id, level);
+            if (links[0] < max_links_count) {
+                links[1 + links[0]++] = id;
+                return;
+            }
+
+            const auto* const row = rows_.row(neighbour.id);
+            state.relinked.assign(1, {id, neighbour.similarity});
+            for (auto i = uint32_t{}; i < links[0]; ++i) {
+                state.relinked.push_back({links[1 + i], Similarity(rows_, row, links[1 + i])});
+            }
+
+            std::sort(state.relinked.begin(), state.relinked.end(), MoreSimilar);
+            SelectNeighbours(rows_, state.relinked, max_links_count, state.reselected);
+            links[0] = static_cast<uint32_t>(state.reselected.size());
+            for (auto i = size_t{}; i < state.reselected.size(); ++i) {
+                links[1 + i] = state.reselected[i].id;
+            }
+        }
+
+        const yzw2v::num::Matrix& rows_;
+        const yzw2v::hnsw::BuildParams p_;
+
+        std::vector<uint8_t> levels_;
+        std::vector<uint32_t> upper_offsets_;
+        std::vector<uint32_t> level0_links_;
+        std::vector<uint32_t> upper_links_;
+
+        std::vector<std::mutex> locks_;
+        std::mutex entry_point_lock_;
+        uint32_t max_level_;
+        uint32_t entry_point_;
+    };
+}
+
+void yzw2v::hnsw::BuildIndex(const num::Matrix& rows, const BuildParams& params,
+                             const std::string& path) {
+    if (!rows.rows_count()) {
+        throw std::runtime_error{"can't build index without rows"};
+    }
+
+    if (!params.m || !params.ef_construction || !params.threads_count) {
+        throw std::runtime_error{"bad index parameters"};
+    }
+
+    const auto start_time = std::chrono::steady_clock::now();
+    GraphBuilder builder{rows, params};
+    builder.Build();
+    builder.Write(path);
+    std::clog << "HNSW: " << rows.rows_count() << " rows, max level " << builder.max_level()
+              << ", built in "
+              << std::chrono::duration_cast<std::chrono::seconds>(
+                     std::chrono::steady_clock::now() - start_time).count()
+              << " seconds" << std::endl;
+}
+
+yzw2v::hnsw::Index::Index(const std::string& path)
+    : file_{new io::MappedFile{path, io::FileSize(path), 0, io::Access::RANDOM}}
+{
+    const auto* const data = file_->data();
+    const auto size = file_->size();
+    if (size < HEADER_SIZE) {
+        throw std::runtime_error{"index is too small"};
+    }
+
+    if (std::strncmp(HNSW_INDEX_MAGIC, data, HNSW_INDEX_MAGIC_SIZE)) {
+        throw std::runtime_error{"magic doesn't match"};
+    }
+
+    uint32_t values[HEADER_VALUES_COUNT] = {};
+    std::memcpy(values, data + HNSW_INDEX_MAGIC_SIZE, sizeof(values));
+    for (auto i = uint32_t{}; i < HEADER_VALUES_COUNT; i += 2) {
+        if (IntHash(values[i]) != values[i + 1]) {
+            throw std::runtime_error{"index header hash doesn't match"};
+        }
+    }
+
+    rows_count_ = values[0];
+    columns_count_ = values[2];
+    m_ = values[4];
+    max_level_ = values[6];
+    entry_point_ = values[8];
+    if (!rows_count_ || !m_ || max_level_ > MAX_LEVEL || entry_point_ >= rows_count_) {
+        throw std::runtime_error{"bad index header"};
+    }
+
+    const auto levels_begin = HEADER_SIZE;
+    const auto upper_offsets_begin = levels_begin + AlignSection(rows_count_);
+    const auto level0_links_begin = upper_offsets_begin
+                                    + AlignSection(sizeof(uint32_t) * rows_count_);
+    const auto upper_links_begin = level0_links_begin
+        + AlignSection(sizeof(uint32_t) * rows_count_ * Level0LinksSize(m_));
+    if (size < upper_links_begin) {
+        throw std::runtime_error{"index is truncated"};
+    }
+
+    levels_ = reinterpret_cast<const uint8_t*>(data + levels_begin);
+    upper_offsets_ = reinterpret_cast<const uint32_t*>(data + upper_offsets_begin);
+    level0_links_ = reinterpret_cast<const uint32_t*>(data + level0_links_begin);
+    upper_links_ = reinterpret_cast<const uint32_t*>(data + upper_links_begin);
+
+    const auto last = rows_count_ - 1;
+    const auto upper_links_end = upper_links_begin
+        + sizeof(uint32_t) * (upper_offsets_[last] + levels_[last] * UpperLinksSize(m_));
+    if (size < upper_links_end) {
+        throw std::runtime_error{"index is truncated"};
+    }
+}
+
+uint32_t yzw2v::hnsw::Index::rows_count() const noexcept {
+    return rows_count_;
+}
+
+uint32_t yzw2v::hnsw::Index::columns_count() const noexcept {
+    return columns_count_;
+}
+
+uint32_t yzw2v::hnsw::Index::m() const noexcept {
+    return m_;
+}
+
+uint32_t yzw2v::hnsw::Index::max_level() const noexcept {
+    return max_level_;
+}
+
+uint32_t yzw2v::hnsw::Index::entry_point() const noexcept {
+    return entry_point_;
+}
+
+uint32_t yzw2v::hnsw::Index::level(const uint32_t id) const noexcept {
+    return levels_[id];
+}
+
+const uint32_t* yzw2v::hnsw::Index::links(const uint32_t id,
+                                          const uint32_t level) const noexcept {
+    if (!level) {
+        return level0_links_ + id * Level0LinksSize(m_);
+    }
+
+    return upper_links_ + upper_offsets_[id] + (level - 1) * UpperLinksSize(m_);
+}
+
+yzw2v::hnsw::Searcher::Searcher(const Index& index, const num::Matrix& rows)
+    : index_{index}
+    , rows_{rows}
+    , state_{new detail::SearchState{index.rows_count()}}
+{
+    if (index.rows_count() != rows.rows_count() || index.columns_count() != rows.columns_count()) {
+        throw std::runtime_error{"index was built for another model"};
+    }
+}
+
+yzw2v::hnsw::Searcher::~Searcher() = default;
+
+std::vector<yzw2v::query::Neighbour> yzw2v::hnsw::Searcher::Search(
+    const float* const query, const uint32_t count, const uint32_t ef,
+    const uint32_t except_id)
+{
+    const auto read_links = [this](const uint32_t id, const uint32_t level,
+                                   std::vector<uint32_t>& links) {
+        const auto* const link = index_.links(id, level);
+        links.assign(link + 1, link + 1 + *link);
+    };
+
+    const auto entry_point = index_.entry_point();
+    auto entry = query::Neighbour{entry_point, Similarity(rows_, query, entry_point)};
+    for (auto l = index_.max_level(); l > 0; --l) {
+        entry = SearchClosest(rows_, query, entry, l, read_links, state_->links);
+    }
+
+    const auto except_count = vocab::INVALID_TOKEN_ID != except_id ? 1u : 0u;
+    SearchLevel(rows_, query, entry, std::max(ef, count + except_count), 0, read_links, *state_);
+
+    auto res = std::move(state_->results);
+    std::sort(res.begin(), res.end(), MoreSimilar);
+    res.erase(std::remove_if(res.begin(), res.end(), [except_id](const query::Neighbour& n) {
+        return except_id == n.id;
+    }), res.end());
+    if (res.size() > count) {
+        res.resize(count);
+    }
+
+    return res;
+}
+
+std::vector<yzw2v::query::Neighbour> yzw2v::hnsw::Nearest(
+    const Index& index, const query::Model& model, const std::vector<uint32_t>& ids,
+    const uint32_t count, const uint32_t ef, const uint32_t threads_count)
+{
+    const auto queries_count = static_cast<uint32_t>(ids.size());
+    auto res = std::vector<query::Neighbour>(static_cast<size_t>(queries_count) * count,
+                                             query::Neighbour{vocab::INVALID_TOKEN_ID, 0.0f});
+    std::atomic<uint32_t> next_chunk{0};
+    const auto run = [&]{
+        Searcher searcher{index, model.matrix()};
+        for (auto begin = QUERIES_CHUNK_SIZE * next_chunk++; begin < queries_count;
+             begin = QUERIES_CHUNK_SIZE * next_chunk++) {
+            const auto end = std::min(queries_count, begin + QUERIES_CHUNK_SIZE);
+            for (auto i = begin; i < end; ++i) {
+                const auto neighbours = searcher.Search(model.matrix().row(ids[i]), count, ef,
+                                                        ids[i]);
+                std::copy(neighbours.cbegin(), neighbours.cend(),
+                          res.begin() + static_cast<ptrdiff_t>(i) * count);
+            }
+        }
+    };
+
+    const auto chunks_count = (queries_count + QUERIES_CHUNK_SIZE - 1) / QUERIES_CHUNK_SIZE;
+    auto jobs = std::vector<std::future<void>>{};
+    for (auto i = uint32_t{1}; i < std::min(threads_count, chunks_count); ++i) {
+        jobs.emplace_back(std::async(std::launch::async, run));
+    }
+
+    run();
+    for (auto&& job : jobs) {
+        job.get();
+    }
+
+    return res;
+}
+
+void yzw2v::hnsw::ReportRecall(const Index& index, const query::Model& model,
+                               const std::vector<uint32_t>& ids, const uint32_t count,
+                               const std::vector<uint32_t>& efs, const uint32_t threads_count,
+                               std::ostream& out) {
+    const auto exact = query::Nearest(model, ids, count, threads_count);
+    Searcher searcher{index, model.matrix()};
+    auto latencies = std::vector<double>(ids.size());
+
+    out << "ef\trecall@" << count << "\tmean_us\tp50_us\tp99_us\n";
+    for (const auto ef : efs) {
+        auto found_count = uint64_t{};
+        auto exact_count = uint64_t{};
+        for (auto i = size_t{}; i < ids.size(); ++i) {
+            const auto start_time = std::chrono::steady_clock::now();
+            const auto neighbours = searcher.Search(model.matrix().row(ids[i]), count, ef, ids[i]);
+            latencies[i] = std::chrono::duration<double, std::micro>(
+                std::chrono::steady_clock::now() - start_time).count();
+
+            const auto exact_begin = exact.cbegin() + static_cast<ptrdiff_t>(i) * count;
+            const auto exact_end = exact_begin + count;
+            for (auto it = exact_begin; exact_end != it; ++it) {
+                if (vocab::INVALID_TOKEN_ID == it->id) {
+                    break;
+                }
+
+                ++exact_count;
+                found_count += std::any_of(neighbours.cbegin(), neighbours.cend(),
+                                           [it](const query::Neighbour& n) {
+                    return it->id == n.id;
+                });
+            }
+        }
+
+        auto mean = double{};
+        for (const auto latency : latencies) {
+            mean += latency;
+        }
+
+        std::sort(latencies.begin(), latencies.end());
+        const auto percentile = [&latencies](const double p) {
+            return latencies.empty() ? 0.0 : latencies[static_cast<size_t>(p * (latencies.size() - 1))];
+        };
+        out << ef << '\t' << (exact_count ? static_cast<double>(found_count) / exact_count : 1.0)
+            << '\t' << (latencies.empty() ? 0.0 : mean / latencies.size())
+            << '\t' << percentile(0.5) << '\t' << percentile(0.99) << '\n';
+    }
+
+    out.flush();
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "mapped_file.h"
+#include "query.h"
+
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <cstdint>
+
+namespace yzw2v {
+    namespace num {
+        class Matrix;
+    }
+
+    namespace hnsw {
+        namespace detail {
+            class SearchState;
+        }
+    }
+}
+
+namespace yzw2v {
+    namespace hnsw {
+        /* Hierarchical navigable small world graph (Malkov & Yashunin, 2016). Every row has links
+         * to at most `2 * m` rows on level 0 and to at most `m` rows on each of upper levels it
+         * was assigned to, level `l` is assigned with probability `exp(-l * ln(m))`.
+         */
+        struct BuildParams {
+            uint32_t m = 16;
+            uint32_t ef_construction = 200;  // candidates considered for links of a new row
+            uint32_t threads_count = 1;
+            uint64_t seed = 0;
+        };
+
+        /* Builds the graph for normalized `rows` (e.g. of `query::Model`) and writes it to `path`.
+         * Rows are inserted by `threads_count` threads concurrently; links of a row are guarded
+         * by one of a fixed set of locks.
+         *
+         * Vectors are not written, index is used together with the model it was built for.
+         */
+        void BuildIndex(const num::Matrix& rows, const BuildParams& params,
+                        const std::string& path);
+
+        // Index written by `BuildIndex`, the file is memory mapped and used as is.
+        class Index {
+        public:
+            explicit Index(const std::string& path);
+
+            uint32_t rows_count() const noexcept;
+            uint32_t columns_count() const noexcept;
+            uint32_t m() const noexcept;
+            uint32_t max_level() const noexcept;
+            uint32_t entry_point() const noexcept;
+
+            uint32_t level(const uint32_t id) const noexcept;
+            // [count, id * count] of links of row `id` on `level`
+            const uint32_t* links(const uint32_t id, const uint32_t level) const noexcept;
+
+        private:
+            std::unique_ptr<const io::MappedFile> file_;
+            uint32_t rows_count_;
+            uint32_t columns_count_;
+            uint32_t m_;
+            uint32_t max_level_;
+            uint32_t entry_point_;
+            const uint8_t* levels_;
+            const uint32_t* upper_offsets_;
+            const uint32_t* level0_links_;
+            const uint32_t* upper_links_;
+        };
+
+        /* Search state of one thread: visited rows are marked by search number in an array of
+         * `rows_count` values, so nothing is cleared between searches.
+         */
+        class Searcher {
+        public:
+            Searcher(const Index& index, const num::Matrix& rows);
+            ~Searcher();
+
+            // Approximately `count` rows most similar to normalized `query`, the most similar
+            // first; `ef` (at least `count`) candidates are tracked on level 0.
+            std::vector<query::Neighbour> Search(const float* query, const uint32_t count,
+                                                 const uint32_t ef,
+                                                 const uint32_t except_id = vocab::INVALID_TOKEN_ID);
+
+        private:
+            const Index& index_;
+            const num::Matrix& rows_;
+            std::unique_ptr<detail::SearchState> state_;
+        };
+
+        // Same layout as `query::Nearest`, queries are spread over `threads_count` threads.
+        std::vector<query::Neighbour> Nearest(const Index& index, const query::Model& model,
+                                              const std::vector<uint32_t>& ids,
+                                              const uint32_t count, const uint32_t ef,
+                                              const uint32_t threads_count);
+
+        /* For every `ef` in `efs` writes recall@`count` against exact search with
+         * `query::Nearest` and latency of single-threaded search (mean, median and 99th
+         * percentile in microseconds) for rows `ids` of `model` as queries, one TSV line per `ef`.
+         */
+        void ReportRecall(const Index& index, const query::Model& model,
+                          const std::vector<uint32_t>& ids, const uint32_t count,
+                          const std::vector<uint32_t>& efs, const uint32_t threads_count,
+                          std::ostream& out);
+    }
+}
@@ -1,6 +1,7 @@
 #include "huffman.h"
 #include "vocabulary.h"
 
+#include <algorithm>
 #include <limits>
 
 static constexpr size_t ELEMENTS_PER_BLOCK = 1024 * 1024 * 8;
@@ -87,12 +88,20 @@ static void CreateHuffmanTree(const ::yzw2v::vocab::Vocabulary& vocab,
 
 yzw2v::huff::HuffmanTree::HuffmanTree(const vocab::Vocabulary& vocab)
     : tokens_(vocab.size())
+    , max_code_length_{0}
     , points_pool_{POINTS_BLOCK_SIZE}
     , code_pool_{CODES_BLOCK_SIZE} {
     CreateHuffmanTree(vocab, tokens_, points_pool_, code_pool_);
+    for (const auto& token : tokens_) {
+        max_code_length_ = std::max(max_code_length_, token.length);
+    }
 }
 
 const std::vector<yzw2v::huff::Token>&
 yzw2v::huff::HuffmanTree::Tokens() const noexcept {
     return tokens_;
 }
+
+uint32_t yzw2v::huff::HuffmanTree::MaxCodeLength() const noexcept {
+    return max_code_length_;
+}
@@ -26,9 +26,11 @@ namespace yzw2v {
             HuffmanTree(const ::yzw2v::vocab::Vocabulary& vocab);
 
             const std::vector<Token>& Tokens() const noexcept;
+            uint32_t MaxCodeLength() const noexcept;
 
         private:
             std::vector<Token> tokens_;
+            uint32_t max_code_length_;
             mem::Pool points_pool_;
             mem::Pool code_pool_;
         };
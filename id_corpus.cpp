@@ -0,0 +1,200 @@
+#include "id_corpus.h"
+
+#include "io.h"
+#include "token_reader.h"
+#include "vocabulary.h"
+
+#include <algorithm>
+#include <fstream>
+#include <memory>
+
+#include <cstring>
+
+static const char ID_CORPUS_MAGIC[] = {"YZW2V_ID_CORPUS"};
+static constexpr size_t ID_CORPUS_MAGIC_SIZE = sizeof(ID_CORPUS_MAGIC)
+                                               / sizeof(ID_CORPUS_MAGIC[0]);
+
+// [ID_CORPUS_MAGIC, vocab.size(), hash(vocab.size())], multiple of id size
+static constexpr size_t ID_CORPUS_HEADER_SIZE = ID_CORPUS_MAGIC_SIZE + 2 * sizeof(uint32_t);
+static_assert(ID_CORPUS_HEADER_SIZE % sizeof(uint32_t) == 0, "ids must stay aligned");
+
+static constexpr uint32_t BUF_SIZE = 1024 * 1024 * 8; // 32 Mb of ids
+
+static uint32_t IntHash(const uint32_t value) noexcept {
+    // Knuth's Multiplicative Method
+    return value * uint32_t{2654435761};
+}
+
+void yzw2v::io::ConvertToIDCorpus(const std::string& text_path, const vocab::Vocabulary& vocab,
+                                  const ReadOptions& read_options, const std::string& path) {
+    std::ofstream out{path, std::ios::binary};
+    if (!out) {
+        throw std::runtime_error{"failed to open file for writing"};
+    }
+
+    static constexpr size_t BUFFER_SIZE = 1024 * 1024 * 32; // 32 Mb
+    BinaryBufferedWriteProxy proxy{out, BUFFER_SIZE};
+
+    proxy.Write(ID_CORPUS_MAGIC, ID_CORPUS_MAGIC_SIZE);
+    const auto vocab_size = vocab.size();
+    proxy.Write(&vocab_size, sizeof(vocab_size));
+    const auto vocab_size_hash = IntHash(vocab_size);
+    proxy.Write(&vocab_size_hash, sizeof(vocab_size_hash));
+
+    static constexpr uint32_t TOKENS_BATCH_SIZE = 64;
+    vocab::Token tokens[TOKENS_BATCH_SIZE];
+    uint32_t ids[TOKENS_BATCH_SIZE];
+    const std::unique_ptr<char[]> buffer{new char[TOKENS_BATCH_SIZE * vocab::MAX_TOKEN_LENGTH]};
+
+    TokenReader reader{text_path, FileSize(text_path), 0, read_options};
+    while (!reader.Done()) {
+        const auto tokens_count = reader.Read(tokens, TOKENS_BATCH_SIZE, buffer.get());
+        vocab.IDs(tokens, tokens_count, ids);
+        for (auto i = uint32_t{}; i < tokens_count; ++i) {
+            if (vocab::INVALID_TOKEN_ID == ids[i]) {
+                continue;
+            }
+
+            proxy.Write(ids + i, sizeof(ids[i]));
+        }
+    }
+}
+
+uint64_t yzw2v::io::IDCorpusSize(const std::string& path, const vocab::Vocabulary& vocab) {
+    const auto file_size = FileSize(path);
+    std::ifstream in{path, std::ios::binary};
+    if (!in) {
+        throw std::runtime_error{"failed to open file for reading"};
+    }
+
+    char header[ID_CORPUS_HEADER_SIZE] = {};
+    if (file_size < ID_CORPUS_HEADER_SIZE || !in.read(header, ID_CORPUS_HEADER_SIZE)) {
+        throw std::runtime_error{"id corpus is too small"};
+    }
+
+    if (std::strncmp(ID_CORPUS_MAGIC, header, ID_CORPUS_MAGIC_SIZE)) {
+        throw std::runtime_error{"magic doesn't match"};
+    }
+
+    uint32_t vocab_size = 0;
+    uint32_t vocab_size_hash = 0;
+    std::memcpy(&vocab_size, header + ID_CORPUS_MAGIC_SIZE, sizeof(vocab_size));
+    std::memcpy(&vocab_size_hash, header + ID_CORPUS_MAGIC_SIZE + sizeof(vocab_size),
+                sizeof(vocab_size_hash));
+    if (IntHash(vocab_size) != vocab_size_hash) {
+        throw std::runtime_error{"hash(vocab.size()) doesn't match"};
+    }
+
+    if (vocab.size() != vocab_size) {
+        throw std::runtime_error{"id corpus was made with another vocabulary"};
+    }
+
+    return (file_size - ID_CORPUS_HEADER_SIZE) / sizeof(uint32_t);
+}
+
+yzw2v::io::IDReader::IDReader(const std::string& path,
+                              const uint64_t ids_to_read,
+                              const uint64_t offset)
+    : buf_cur_{nullptr}
+    , buf_end_{nullptr}
+    , ids_left_{ids_to_read}
+    , buf_{new uint32_t[BUF_SIZE]}
+    , input_{path, std::ios::binary}
+    , ids_to_read_from_input_file_{ids_to_read}
+    , input_file_offset_{ID_CORPUS_HEADER_SIZE + offset * sizeof(uint32_t)} {
+    Restart();
+}
+
+void yzw2v::io::IDReader::LoadToBuffer() {
+    const auto ids_to_read = static_cast<uint32_t>(
+            std::min(ids_left_, static_cast<uint64_t>(BUF_SIZE)));
+    if (!input_.read(reinterpret_cast<char*>(buf_.get()),
+                     static_cast<std::streamsize>(ids_to_read * sizeof(uint32_t)))) {
+        throw std::runtime_error("read failed");
+    }
+
+    buf_cur_ = buf_.get();
+    buf_end_ = buf_.get() + ids_to_read;
+    ids_left_ -= ids_to_read;
+}
+
+void yzw2v::io::IDReader::Restart() {
+    ids_left_ = ids_to_read_from_input_file_;
+    if (!input_.seekg(static_cast<std::streamoff>(input_file_offset_))) {
+        throw std::runtime_error("seekg failed");
+    }
+
+    LoadToBuffer();
+}
+
+bool yzw2v::io::IDReader::Done() const noexcept {
+    return buf_cur_ == buf_end_ && !ids_left_;
+}
+
+uint32_t yzw2v::io::IDReader::Read() {
+    if (buf_cur_ == buf_end_) {
+        LoadToBuffer();
+    }
+
+    return *buf_cur_++;
+}
+
+void yzw2v::io::IDReader::Reset(const uint64_t ids_to_read, const uint64_t offset) {
+    ids_to_read_from_input_file_ = ids_to_read;
+    input_file_offset_ = ID_CORPUS_HEADER_SIZE + offset * sizeof(uint32_t);
+    Restart();
+}
+
+uint64_t yzw2v::io::IDReader::BytesRead() const noexcept {
+    return (ids_to_read_from_input_file_ - ids_left_ - static_cast<uint64_t>(buf_end_ - buf_cur_))
+           * sizeof(uint32_t);
+}
+
+std::vector<uint64_t> yzw2v::io::SplitIDCorpusIntoChunks(const std::string& path,
+                                                         const uint64_t ids_count,
+                                                         const uint64_t chunk_size) {
+    std::ifstream input{path, std::ios::binary};
+    if (!input) {
+        throw std::runtime_error{"failed to open file"};
+    }
+
+    static constexpr uint32_t SCAN_BUFFER_SIZE = 16 * 1024;  // in ids
+    uint32_t buf[SCAN_BUFFER_SIZE];
+
+    auto res = std::vector<uint64_t>{0};
+    for (auto boundary = chunk_size; boundary < ids_count;) {
+        // move boundary forward to the next paragraph
+        if (!input.seekg(static_cast<std::streamoff>(
+                ID_CORPUS_HEADER_SIZE + (boundary - 1) * sizeof(uint32_t)))) {
+            throw std::runtime_error{"seekg failed"};
+        }
+
+        auto found = false;
+        while (!found && boundary < ids_count) {
+            const auto size = static_cast<uint32_t>(
+                std::min<uint64_t>(SCAN_BUFFER_SIZE, ids_count - (boundary - 1)));
+            if (!input.read(reinterpret_cast<char*>(buf),
+                            static_cast<std::streamsize>(size * sizeof(uint32_t)))) {
+                throw std::runtime_error{"read failed"};
+            }
+
+            const auto* const paragraph = std::find(buf, buf + size, vocab::PARAGRAPH_TOKEN_ID);
+            if (paragraph != buf + size) {
+                boundary += static_cast<uint64_t>(paragraph - buf);
+                found = true;
+            } else {
+                boundary += size;
+            }
+        }
+
+        if (boundary >= ids_count) {
+            break;
+        }
+
+        res.push_back(boundary);
+        boundary += chunk_size;
+    }
+
+    res.push_back(ids_count);
+    return res;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "byte_source.h"
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <cstdint>
+
+namespace yzw2v {
+    namespace vocab {
+        class Vocabulary;
+    }
+}
+
+namespace yzw2v {
+    namespace io {
+        /* Text corpus where every token is already replaced by its id in the vocabulary, so
+         * training doesn't have to parse and hash the same text on every iteration. Tokens that
+         * are not in the vocabulary are dropped, paragraph tokens are kept as
+         * `vocab::PARAGRAPH_TOKEN_ID`.
+         *
+         * Ids depend on the whole vocabulary (it's pruned and sorted at the end of collection), so
+         * conversion is a separate pass over the text and the file may be used only with the same
+         * vocabulary.
+         */
+        void ConvertToIDCorpus(const std::string& text_path, const vocab::Vocabulary& vocab,
+                               const ReadOptions& read_options, const std::string& path);
+
+        // Number of token ids in the file, also checks that it was made with `vocab`
+        uint64_t IDCorpusSize(const std::string& path, const vocab::Vocabulary& vocab);
+
+        // Counterpart of `TokenReader` for id corpus, `offset` and `ids_to_read` are in ids.
+        class IDReader {
+        public:
+            IDReader(const std::string& path,
+                     const uint64_t ids_to_read,
+                     const uint64_t offset);
+
+            uint32_t Read();
+            bool Done() const noexcept;
+
+            void Restart();
+
+            // Continue with another region of the same file, as if it was a new reader.
+            void Reset(const uint64_t ids_to_read, const uint64_t offset);
+
+            // Bytes of the input processed since last `Restart` or `Reset`
+            uint64_t BytesRead() const noexcept;
+
+        private:
+            void LoadToBuffer();
+
+        private:
+            const uint32_t* buf_cur_;
+            const uint32_t* buf_end_;
+            uint64_t ids_left_;
+            std::unique_ptr<uint32_t[]> buf_;
+            std::ifstream input_;
+            uint64_t ids_to_read_from_input_file_;
+            uint64_t input_file_offset_;
+        };
+
+        // Counterpart of `SplitTextIntoChunks` for id corpus: boundaries are in ids and each of
+        // them except the first and the last one is right after `vocab::PARAGRAPH_TOKEN_ID`.
+        std::vector<uint64_t> SplitIDCorpusIntoChunks(const std::string& path,
+                                                      const uint64_t ids_count,
+                                                      const uint64_t chunk_size);
+    }
+}
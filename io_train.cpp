@@ -1,6 +1,8 @@
 #include "train.h"
 
 #include "io.h"
+#include "mem.h"
+#include "quantized_model.h"
 #include "vocabulary.h"
 
 #include <fstream>
@@ -18,11 +20,13 @@ void yzw2v::train::WriteModelTXT(const std::string& path,
     }
 
     const auto* const matrix = model.matrix_holder.get();
+    const auto row_holder = mem::AllocateFloatForSIMD(model.vector_size);
+    auto* const row = row_holder.get();
 
     out << model.vocabulary_size << ' ' << model.vector_size << '\n';
     for (auto i = uint32_t{}; i < model.vocabulary_size; ++i) {
         out << vocab.Token(i).token;
-        const auto* const row = matrix->row(i);
+        matrix->CopyRow(i, row);
         for (auto j = uint32_t{}; j < model.vector_size; ++j) {
             out << ' ' << row[j];
         }
@@ -30,9 +34,9 @@ void yzw2v::train::WriteModelTXT(const std::string& path,
     }
 }
 
-void yzw2v::train::WriteModelBinary(const std::string& path,
-                                    const vocab::Vocabulary& vocab, const Model& model) {
-    assert(vocab.size() == model.vocabulary_size);
+static void WriteMatrixBinary(const std::string& path, const yzw2v::vocab::Vocabulary& vocab,
+                              const yzw2v::num::Matrix& matrix) {
+    assert(vocab.size() == matrix.rows_count());
 
     std::ofstream out{path, std::ios::binary};
     if (!out) {
@@ -45,18 +49,42 @@ void yzw2v::train::WriteModelBinary(const std::string& path,
     static constexpr auto NEW_LINE_LEN = sizeof(NEW_LINE) - 1;
     static constexpr auto BUFFER_SIZE = size_t{1024} * 1024 * 128; // 128 Mb
 
-    const auto* const matrix = model.matrix_holder.get();
-    const auto vocabulary_size_str = std::to_string(model.vocabulary_size);
-    const auto vector_size_str = std::to_string(model.vector_size);
+    const auto vector_size = matrix.columns_count();
+    const auto row_holder = yzw2v::mem::AllocateFloatForSIMD(vector_size);
+    auto* const row = row_holder.get();
+    const auto vocabulary_size_str = std::to_string(vocab.size());
+    const auto vector_size_str = std::to_string(vector_size);
 
-    io::BinaryBufferedWriteProxy proxy{out, BUFFER_SIZE};
+    yzw2v::io::BinaryBufferedWriteProxy proxy{out, BUFFER_SIZE};
     proxy.Write(vocabulary_size_str.c_str(), vocabulary_size_str.size());
     proxy.Write(SPACE, SPACE_LEN);
     proxy.Write(vector_size_str.c_str(), vector_size_str.size());
-    for (auto i = uint32_t{}; i < model.vocabulary_size; ++i) {
+    for (auto i = uint32_t{}; i < vocab.size(); ++i) {
         proxy.Write(vocab.Token(i).token.cbegin(), vocab.Token(i).token.length());
         proxy.Write(SPACE, SPACE_LEN);
-        proxy.Write(matrix->row(i), model.vector_size * sizeof(float));
+        matrix.CopyRow(i, row);
+        proxy.Write(row, vector_size * sizeof(float));
         proxy.Write(NEW_LINE, NEW_LINE_LEN);
     }
 }
+
+void yzw2v::train::WriteModelBinary(const std::string& path,
+                                    const vocab::Vocabulary& vocab, const Model& model) {
+    assert(vocab.size() == model.vocabulary_size);
+    WriteMatrixBinary(path, vocab, *model.matrix_holder);
+}
+
+void yzw2v::train::WriteOutputLayerBinary(const std::string& path,
+                                          const vocab::Vocabulary& vocab, const Model& model) {
+    if (!model.output_layer_holder) {
+        throw std::runtime_error{"model has no output layer of negative sampling"};
+    }
+
+    WriteMatrixBinary(path, vocab, *model.output_layer_holder);
+}
+
+void yzw2v::train::WriteModelInt8(const std::string& path,
+                                  const vocab::Vocabulary& vocab, const Model& model) {
+    assert(vocab.size() == model.vocabulary_size);
+    quant::WriteModel(path, vocab, *model.matrix_holder);
+}
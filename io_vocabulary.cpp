@@ -30,13 +30,13 @@ void yzw2v::vocab::Vocabulary::WriteTSVWithFilter(const Vocabulary& vocab, const
         throw std::runtime_error{"failed to open file for writing"};
     }
 
-    for (const auto& info : vocab.tokens_) {
-        if (info.count < min_token_freq) {
+    for (const auto& entry : vocab.tokens_) {
+        if (entry.count < min_token_freq) {
             continue;
         }
 
-        out << info.count
-            << '\t' << info.token
+        out << entry.count
+            << '\t' << vocab.MakeToken(entry)
             << '\n';
     }
 }
@@ -68,8 +68,8 @@ void yzw2v::vocab::Vocabulary::WriteBinaryWithFilter(
         }
 
         auto res = uint32_t{};
-        for (const auto& info : vocab.tokens_) {
-            if (info.count >= min_token_freq) {
+        for (const auto& entry : vocab.tokens_) {
+            if (entry.count >= min_token_freq) {
                 ++res;
             }
         }
@@ -93,9 +93,11 @@ void yzw2v::vocab::Vocabulary::WriteBinaryWithFilter(
     const auto max_number_of_tokens_hash = IntHash(vocab.max_number_of_tokens_);
     proxy.Write(&max_number_of_tokens_hash, sizeof(max_number_of_tokens_hash));
 
-    // [vocab.hash_table_size_, hash(vocab.hash_table_size_)]
-    proxy.Write(&vocab.hash_table_size_, sizeof(vocab.hash_table_size_));
-    const auto hash_table_size_hash = IntHash(vocab.hash_table_size_);
+    // [hash_table_size, hash(hash_table_size)], size table used to be preallocated with; table
+    // grows with vocabulary now, value is only kept so the format stays the same
+    const auto hash_table_size = vocab.max_number_of_tokens_ * 10 / 7;
+    proxy.Write(&hash_table_size, sizeof(hash_table_size));
+    const auto hash_table_size_hash = IntHash(hash_table_size);
     proxy.Write(&hash_table_size_hash, sizeof(hash_table_size_hash));
 
     // [vocab.tokens_.size(), hash(vocab.tokens_.size())]
@@ -104,15 +106,14 @@ void yzw2v::vocab::Vocabulary::WriteBinaryWithFilter(
     proxy.Write(&number_of_tokens_hash, sizeof(number_of_tokens_hash));
 
     // [count, length(token), token]
-    for (const auto& info : vocab.tokens_) {
-        if (info.count < min_token_freq) {
+    for (const auto& entry : vocab.tokens_) {
+        if (entry.count < min_token_freq) {
             continue;
         }
 
-        proxy.Write(&info.count, sizeof(info.count));
-        const auto size = info.token.length();
-        proxy.Write(&size, sizeof(size));
-        proxy.Write(info.token.cbegin(), info.token.length());
+        proxy.Write(&entry.count, sizeof(entry.count));
+        proxy.Write(&entry.length, sizeof(entry.length));
+        proxy.Write(vocab.chars_.data() + entry.offset, entry.length);
     }
 }
 
@@ -167,12 +168,13 @@ void yzw2v::vocab::Vocabulary::ReadBinaryWithFilter(const std::string& path,
         }
     }
 
-    proxy.Read(&vocab.hash_table_size_, sizeof(vocab.hash_table_size_));
     {
+        auto hash_table_size = uint32_t{};
+        proxy.Read(&hash_table_size, sizeof(hash_table_size));
         auto hash_table_size_hash = uint32_t{};
         proxy.Read(&hash_table_size_hash, sizeof(hash_table_size_hash));
-        if (IntHash(vocab.hash_table_size_) != hash_table_size_hash) {
-            throw std::runtime_error{"hash(vocab.hash_table_size_) does't match"};
+        if (IntHash(hash_table_size) != hash_table_size_hash) {
+            throw std::runtime_error{"hash(hash_table_size) doesn't match"};
         }
     }
 
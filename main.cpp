@@ -1,12 +1,20 @@
+#include "evaluation.h"
+#include "hnsw.h"
 #include "huffman.h"
+#include "id_corpus.h"
+#include "mem.h"
+#include "numeric.h"
+#include "query.h"
 #include "train.h"
 #include "vocabulary.h"
 
 #include "third_party/cxxopts/src/cxxopts.hpp"
 
+#include <algorithm>
 #include <chrono>
 #include <future>
 #include <iostream>
+#include <stdexcept>
 #include <string>
 #include <thread>
 #include <vector>
@@ -27,6 +35,8 @@ namespace {
     struct Args {
         std::string text_file;
         std::string model_file;
+        bool use_cbow = true;
+        uint32_t cbow_batch_size = 1;
         uint32_t vector_size = 100;
         uint32_t max_window_size = 5;
         float sample_rate = 1e-3f;
@@ -36,9 +46,44 @@ namespace {
         uint32_t iterations = 5;
         uint32_t min_word_frequency = 5;
         float alpha = 0.05f;
+        float final_alpha = 0.0f;
         bool save_model_in_binary_format = true;
         std::string vocabulary_out_file;
         std::string vocabulary_in_file;
+        std::string ids_out_file;
+        std::string ids_in_file;
+        std::string read_mode = "mmap";
+        uint32_t read_buffer_size_mb = 32;
+        uint32_t read_buffers_count = 2;
+        std::string instruction_set = "auto";
+        std::string metrics_file;
+        std::string metrics_format = "json";
+        uint32_t metrics_interval_ms = 1000;
+        std::string checkpoint_file;
+        uint32_t checkpoint_interval_sec = 1800;
+        bool resume = false;
+        bool numa_aware = false;
+        std::string huge_pages = "thp";
+        std::string syn0_precision = "fp32";
+        std::string syn1neg_precision = "fp32";
+        std::string int8_model_file;
+        std::string output_layer_file;
+        std::string init_model_file;
+        std::string init_output_layer_file;
+        std::string query_model_file;
+        std::string queries_file;
+        std::string query_output_file = "-";
+        uint32_t query_neighbours_count = 10;
+        uint32_t query_batch_size = 65536;
+        std::string hnsw_output_file;
+        std::string hnsw_index_file;
+        uint32_t hnsw_m = 16;
+        uint32_t hnsw_ef_construction = 200;
+        uint32_t hnsw_ef = 100;
+        bool hnsw_report = false;
+        std::string analogies_file;
+        std::string similarity_files;
+        uint32_t eval_top_count = 30000;
 
         bool fail_on_bad_floating_arithmetics = false;
     };
@@ -71,20 +116,66 @@ static Args ParseOptions(int argc, char* argv[]) {
         "The vocabulary will be read from FILE, not constructed from the training data",
         cxxopts::value<>(args.vocabulary_in_file),
         "FILE"
+    )(
+        "save-ids",
+        "Training data converted to ids of the vocabulary will be saved to FILE",
+        cxxopts::value<>(args.ids_out_file),
+        "FILE"
+    )(
+        "train-ids",
+        "Use ids from FILE made by --save-ids with the same vocabulary to train the model",
+        cxxopts::value<>(args.ids_in_file),
+        "FILE"
     )(
         "binary",
         "Save the resulting vectors in binary format",
         cxxopts::value<>(args.save_model_in_binary_format)->default_value("1")
+    )(
+        "cbow",
+        "Use the continuous bag of words model; use 0 for skip-gram model",
+        cxxopts::value<>(args.use_cbow)->default_value("1")
+    )(
+        "cbow-batch",
+        "Number of consecutive positions in a sentence that share negative samples in CBOW",
+        cxxopts::value<>(args.cbow_batch_size)->default_value("1"),
+        "INT"
     )(
         "alpha",
-        "Set the starting learning rate",
+        "Set the starting learning rate; default is 0.025 for skip-gram and 0.05 for CBOW",
         cxxopts::value<>(args.alpha)->default_value("0.05"),
         "FLOAT"
+    )(
+        "final-alpha",
+        "Learning rate goes down linearly from starting one to FLOAT by the end of training",
+        cxxopts::value<>(args.final_alpha)->default_value("0"),
+        "FLOAT"
     )(
         "output",
         "Use FILE to save the resulting word vectors",
         cxxopts::value<>(args.model_file),
         "FILE"
+    )(
+        "output-int8",
+        "Also save the resulting word vectors quantized to int8 with per-row scale and offset to"
+        " FILE",
+        cxxopts::value<>(args.int8_model_file),
+        "FILE"
+    )(
+        "output-layer",
+        "Also save the output layer of negative sampling to FILE, to continue training later",
+        cxxopts::value<>(args.output_layer_file),
+        "FILE"
+    )(
+        "init-model",
+        "Continue training of word vectors saved to FILE by --output (binary) instead of random"
+        " ones; words are matched by text, new words start at random",
+        cxxopts::value<>(args.init_model_file),
+        "FILE"
+    )(
+        "init-output-layer",
+        "Continue training of the output layer saved to FILE by --output-layer",
+        cxxopts::value<>(args.init_output_layer_file),
+        "FILE"
     )(
         "window",
         "Set max skip length between words",
@@ -119,6 +210,154 @@ static Args ParseOptions(int argc, char* argv[]) {
         "This will discard words that appear less than INT times",
         cxxopts::value<>(args.min_word_frequency)->default_value("5"),
         "INT"
+    )(
+        "instruction-set",
+        "Instruction set for linear algebra: auto, simple, sse, avx, avx2 or avx512",
+        cxxopts::value<>(args.instruction_set)->default_value("auto"),
+        "NAME"
+    )(
+        "read-mode",
+        "How text is read: mmap (tokenize memory mapped file), buffered (read into a buffer) or"
+        " async (read ahead into several buffers with io_uring or a background thread)",
+        cxxopts::value<>(args.read_mode)->default_value("mmap"),
+        "MODE"
+    )(
+        "read-buffer-size",
+        "Size of read buffer in Mb for buffered and async read modes",
+        cxxopts::value<>(args.read_buffer_size_mb)->default_value("32"),
+        "INT"
+    )(
+        "read-buffers",
+        "Number of buffers in flight for async read mode, at least 2",
+        cxxopts::value<>(args.read_buffers_count)->default_value("2"),
+        "INT"
+    )(
+        "metrics",
+        "Write training metrics to FILE instead of progress line (\"-\" for stdout, /dev/fd/N for a"
+        " file descriptor)",
+        cxxopts::value<>(args.metrics_file),
+        "FILE"
+    )(
+        "metrics-format",
+        "Format of training metrics: json (one object per line) or tsv",
+        cxxopts::value<>(args.metrics_format)->default_value("json"),
+        "FORMAT"
+    )(
+        "metrics-interval",
+        "Training metrics are written every INT milliseconds",
+        cxxopts::value<>(args.metrics_interval_ms)->default_value("1000"),
+        "INT"
+    )(
+        "checkpoint",
+        "Periodically save model matrices and training state to FILE while training",
+        cxxopts::value<>(args.checkpoint_file),
+        "FILE"
+    )(
+        "checkpoint-interval",
+        "Checkpoint is saved every INT seconds",
+        cxxopts::value<>(args.checkpoint_interval_sec)->default_value("1800"),
+        "INT"
+    )(
+        "resume",
+        "Continue training from checkpoint if it exists; training parameters and input must be"
+        " the same, number of threads may differ",
+        cxxopts::value<>(args.resume)
+    )(
+        "numa",
+        "Pin training threads to CPUs of all NUMA nodes, replicate read-only tables on each node"
+        " and interleave model matrices over nodes",
+        cxxopts::value<>(args.numa_aware)
+    )(
+        "huge-pages",
+        "Pages for model matrices and sampling tables: none, thp (transparent huge pages), 2mb or"
+        " 1gb (reserved huge pages, fall back to thp if there are not enough)",
+        cxxopts::value<>(args.huge_pages)->default_value("thp"),
+        "MODE"
+    )(
+        "syn0-precision",
+        "Storage of word vectors during training: fp32, fp16 or bf16; saved vectors are always"
+        " fp32",
+        cxxopts::value<>(args.syn0_precision)->default_value("fp32"),
+        "TYPE"
+    )(
+        "syn1neg-precision",
+        "Storage of output layer of negative sampling: fp32, fp16 or bf16",
+        cxxopts::value<>(args.syn1neg_precision)->default_value("fp32"),
+        "TYPE"
+    )(
+        "query-model",
+        "Load model FILE in binary format to answer queries, build index or evaluate it instead"
+        " of training",
+        cxxopts::value<>(args.query_model_file),
+        "FILE"
+    )(
+        "query",
+        "Query words for --query-model, one per line",
+        cxxopts::value<>(args.queries_file),
+        "FILE"
+    )(
+        "query-output",
+        "Write \"query<TAB>neighbour<TAB>similarity\" lines to FILE (\"-\" for stdout)",
+        cxxopts::value<>(args.query_output_file)->default_value("-"),
+        "FILE"
+    )(
+        "top",
+        "Number of nearest neighbours for each query",
+        cxxopts::value<>(args.query_neighbours_count)->default_value("10"),
+        "INT"
+    )(
+        "query-batch",
+        "Number of queries answered at once",
+        cxxopts::value<>(args.query_batch_size)->default_value("65536"),
+        "INT"
+    )(
+        "hnsw-output",
+        "Build HNSW index for approximate nearest neighbour search over the resulting (or"
+        " --query-model) vectors and save it to FILE",
+        cxxopts::value<>(args.hnsw_output_file),
+        "FILE"
+    )(
+        "hnsw-m",
+        "Number of links of every word in HNSW index (twice as many on the bottom level)",
+        cxxopts::value<>(args.hnsw_m)->default_value("16"),
+        "INT"
+    )(
+        "hnsw-ef-construction",
+        "Number of candidates for links of a word considered while HNSW index is built",
+        cxxopts::value<>(args.hnsw_ef_construction)->default_value("200"),
+        "INT"
+    )(
+        "hnsw-index",
+        "Answer --query with HNSW index FILE built for --query-model instead of exact search",
+        cxxopts::value<>(args.hnsw_index_file),
+        "FILE"
+    )(
+        "hnsw-ef",
+        "Number of candidates tracked by HNSW search, more is slower and more precise",
+        cxxopts::value<>(args.hnsw_ef)->default_value("100"),
+        "INT"
+    )(
+        "hnsw-report",
+        "Instead of answering --query, report recall and latency of --hnsw-index against exact"
+        " search for a range of --hnsw-ef values",
+        cxxopts::value<>(args.hnsw_report)
+    )(
+        "eval-analogies",
+        "Evaluate the resulting (or --query-model) vectors on analogy questions from FILE in"
+        " questions-words.txt format",
+        cxxopts::value<>(args.analogies_file),
+        "FILE"
+    )(
+        "eval-similarity",
+        "Evaluate the resulting (or --query-model) vectors on word similarity datasets from"
+        " comma separated FILES of \"word word score\" lines",
+        cxxopts::value<>(args.similarity_files),
+        "FILES"
+    )(
+        "eval-top",
+        "Use only INT most frequent words for evaluation, 0 for all",
+        cxxopts::value<>(args.eval_top_count)->default_value("30000"),
+        "INT"
     )(
         "fail-on-bad-floating-arithmetics",
         "properly set floating point environment",
@@ -134,35 +373,262 @@ static Args ParseOptions(int argc, char* argv[]) {
         std::exit(EXIT_SUCCESS);
     }
 
+    if (!args.ids_in_file.empty() && args.vocabulary_in_file.empty() && args.text_file.empty()) {
+        throw std::runtime_error{"vocabulary for ids must be read or collected from training data"};
+    }
+
+    if (!args.query_model_file.empty() && args.queries_file.empty()
+        && args.hnsw_output_file.empty() && args.analogies_file.empty()
+        && args.similarity_files.empty()) {
+        throw std::runtime_error{"queries, index to build or evaluation must be given for"
+                                 " --query-model"};
+    }
+
+    if (!args.hnsw_index_file.empty() && args.query_model_file.empty()) {
+        throw std::runtime_error{"HNSW index is used only with --query-model"};
+    }
+
+    if (args.hnsw_report && (args.hnsw_index_file.empty() || args.queries_file.empty())) {
+        throw std::runtime_error{"HNSW report needs --hnsw-index and --query"};
+    }
+
+    if (!args.hnsw_m || !args.hnsw_ef_construction || !args.hnsw_ef) {
+        throw std::runtime_error{"HNSW parameters must be positive"};
+    }
+
+    if (!args.query_batch_size) {
+        throw std::runtime_error{"query batch must not be empty"};
+    }
+
+    if (!args.query_neighbours_count) {
+        throw std::runtime_error{"number of neighbours must be positive"};
+    }
+
+    if ("mmap" != args.read_mode && "buffered" != args.read_mode && "async" != args.read_mode) {
+        throw std::runtime_error{"unknown read mode: " + args.read_mode};
+    }
+
+    if (!args.read_buffer_size_mb || args.read_buffer_size_mb > 1024) {
+        throw std::runtime_error{"read buffer size must be from 1 to 1024 Mb"};
+    }
+
+    if (args.read_buffers_count < 2) {
+        throw std::runtime_error{"at least two read buffers must be in flight"};
+    }
+
+    if ("none" != args.huge_pages && "thp" != args.huge_pages && "2mb" != args.huge_pages
+        && "1gb" != args.huge_pages) {
+        throw std::runtime_error{"unknown huge pages mode: " + args.huge_pages};
+    }
+
+    for (const auto* const precision : {&args.syn0_precision, &args.syn1neg_precision}) {
+        if ("fp32" != *precision && "fp16" != *precision && "bf16" != *precision) {
+            throw std::runtime_error{"unknown precision: " + *precision};
+        }
+    }
+
+    if ("json" != args.metrics_format && "tsv" != args.metrics_format) {
+        throw std::runtime_error{"unknown metrics format: " + args.metrics_format};
+    }
+
+    if (!args.number_of_negative_samples
+        && (!args.output_layer_file.empty() || !args.init_output_layer_file.empty())) {
+        throw std::runtime_error{"output layer is saved and loaded only for negative sampling"};
+    }
+
+    if (!args.checkpoint_interval_sec) {
+        throw std::runtime_error{"checkpoint interval must be positive"};
+    }
+
+    if (args.resume && args.checkpoint_file.empty()) {
+        throw std::runtime_error{"nothing to resume from without checkpoint"};
+    }
+
+    if (!args.use_cbow && !options.count("alpha")) {
+        args.alpha = 0.025f;
+    }
+
+    if (args.final_alpha < 0.0f || args.final_alpha > args.alpha) {
+        throw std::runtime_error{"final alpha must be from 0 to starting alpha"};
+    }
+
     return args;
 }
 
+static yzw2v::mem::HugePages MakeHugePagesFromArgs(const Args& args) noexcept {
+    if ("none" == args.huge_pages) {
+        return yzw2v::mem::HugePages::NONE;
+    } else if ("2mb" == args.huge_pages) {
+        return yzw2v::mem::HugePages::EXPLICIT_2MB;
+    } else if ("1gb" == args.huge_pages) {
+        return yzw2v::mem::HugePages::EXPLICIT_1GB;
+    }
+
+    return yzw2v::mem::HugePages::TRANSPARENT;
+}
+
+static yzw2v::num::Precision MakePrecision(const std::string& name) noexcept {
+    if ("fp16" == name) {
+        return yzw2v::num::Precision::FP16;
+    } else if ("bf16" == name) {
+        return yzw2v::num::Precision::BF16;
+    }
+
+    return yzw2v::num::Precision::FP32;
+}
+
+static yzw2v::io::ReadOptions MakeReadOptionsFromArgs(const Args& args) noexcept {
+    auto options = yzw2v::io::ReadOptions{};
+    if ("mmap" == args.read_mode) {
+        options.mode = yzw2v::io::ReadMode::MMAP;
+    } else if ("async" == args.read_mode) {
+        options.mode = yzw2v::io::ReadMode::ASYNC;
+    } else {
+        options.mode = yzw2v::io::ReadMode::BUFFERED;
+    }
+
+    options.buffer_size = args.read_buffer_size_mb * 1024 * 1024;
+    options.in_flight_count = args.read_buffers_count;
+    return options;
+}
+
 static yzw2v::train::Params MakeParamsFromArgs(const Args& args) noexcept {
     auto params = yzw2v::train::Params{};
     params.iterations_count = args.iterations;
     params.starting_alpha = args.alpha;
+    params.final_alpha = args.final_alpha;
     params.min_token_freq_threshold = args.sample_rate;
     params.negative_samples_count = args.number_of_negative_samples;
     params.use_hierarchical_softmax = args.use_hierarchical_softmax;
     params.vector_size = args.vector_size;
     params.window_size = args.max_window_size;
+    params.cbow_batch_size = args.cbow_batch_size;
+    params.init_model_path = args.init_model_file;
+    params.init_output_layer_path = args.init_output_layer_file;
+    params.input_is_id_corpus = !args.ids_in_file.empty();
+    params.read_options = MakeReadOptionsFromArgs(args);
+    params.metrics_path = args.metrics_file;
+    params.metrics_format = "tsv" == args.metrics_format
+                            ? yzw2v::train::MetricsFormat::TSV
+                            : yzw2v::train::MetricsFormat::JSON;
+    params.metrics_interval_ms = args.metrics_interval_ms;
+    params.checkpoint_path = args.checkpoint_file;
+    params.checkpoint_interval_sec = args.checkpoint_interval_sec;
+    params.resume = args.resume;
+    params.numa_aware = args.numa_aware;
+    params.syn0_precision = MakePrecision(args.syn0_precision);
+    params.syn1neg_precision = MakePrecision(args.syn1neg_precision);
     return params;
 }
 
+static yzw2v::hnsw::BuildParams MakeHNSWParamsFromArgs(const Args& args) noexcept {
+    auto params = yzw2v::hnsw::BuildParams{};
+    params.m = args.hnsw_m;
+    params.ef_construction = args.hnsw_ef_construction;
+    params.threads_count = args.thread_count;
+    return params;
+}
+
+static std::vector<std::string> SplitList(const std::string& list) {
+    auto res = std::vector<std::string>{};
+    for (auto begin = size_t{}; begin <= list.size();) {
+        const auto end = std::min(list.find(',', begin), list.size());
+        if (end > begin) {
+            res.push_back(list.substr(begin, end - begin));
+        }
+
+        begin = end + 1;
+    }
+
+    return res;
+}
+
+static void Evaluate(const Args& args, const yzw2v::query::Model& model) {
+    if (args.analogies_file.empty() && args.similarity_files.empty()) {
+        return;
+    }
+
+    const yzw2v::eval::Evaluator evaluator{model, args.eval_top_count};
+    if (!args.analogies_file.empty()) {
+        evaluator.EvaluateAnalogies(args.analogies_file, args.thread_count, std::cout);
+    }
+
+    for (const auto& path : SplitList(args.similarity_files)) {
+        evaluator.EvaluateSimilarity(path, std::cout);
+    }
+}
+
+static int Query(const Args& args) {
+    const yzw2v::query::Model model{args.query_model_file};
+    std::clog << "Model: " << model.rows_count() << " words, " << model.columns_count()
+              << " columns" << std::endl;
+    if (!args.hnsw_output_file.empty()) {
+        yzw2v::hnsw::BuildIndex(model.matrix(), MakeHNSWParamsFromArgs(args),
+                                args.hnsw_output_file);
+    }
+
+    Evaluate(args, model);
+    if (args.queries_file.empty()) {
+        return EXIT_SUCCESS;
+    }
+
+    if (args.hnsw_index_file.empty()) {
+        yzw2v::query::AnswerQueries(model, args.queries_file, args.query_output_file,
+                                    args.query_neighbours_count, args.query_batch_size,
+                                    args.thread_count);
+        return EXIT_SUCCESS;
+    }
+
+    const yzw2v::hnsw::Index index{args.hnsw_index_file};
+    if (args.hnsw_report) {
+        // at least one ef, even when it is 1024 or more
+        auto efs = std::vector<uint32_t>{};
+        for (auto ef = std::max(uint32_t{1}, args.query_neighbours_count);
+             efs.empty() || ef < 1024; ef *= 2) {
+            efs.push_back(ef);
+        }
+
+        yzw2v::hnsw::ReportRecall(index, model,
+                                  yzw2v::query::ReadIDs(model, args.queries_file),
+                                  args.query_neighbours_count, efs, args.thread_count,
+                                  std::cout);
+        return EXIT_SUCCESS;
+    }
+
+    yzw2v::query::AnswerQueries(model, args.queries_file, args.query_output_file,
+                                args.query_neighbours_count, args.query_batch_size,
+                                args.thread_count,
+                                [&index, &model, &args](const std::vector<uint32_t>& ids,
+                                                        const uint32_t count) {
+        return yzw2v::hnsw::Nearest(index, model, ids, count, args.hnsw_ef, args.thread_count);
+    });
+    return EXIT_SUCCESS;
+}
+
 static int Main(const Args& args) {
+    if (!args.query_model_file.empty()) {
+        return Query(args);
+    }
+
     const auto vocab = [&args]{
         if (!args.vocabulary_in_file.empty()) {
             return yzw2v::vocab::ReadBinary(args.vocabulary_in_file);
         }
 
         return yzw2v::vocab::CollectVocabulary(args.text_file, args.min_word_frequency,
-                                               MAX_NUMBER_OF_TOKENS);
+                                               MAX_NUMBER_OF_TOKENS,
+                                               MakeReadOptionsFromArgs(args), args.thread_count);
     }();
 
     if (!args.vocabulary_out_file.empty()) {
         yzw2v::vocab::WriteBinary(vocab, args.vocabulary_out_file);
     }
 
+    if (!args.ids_out_file.empty()) {
+        yzw2v::io::ConvertToIDCorpus(args.text_file, vocab, MakeReadOptionsFromArgs(args),
+                                     args.ids_out_file);
+    }
+
     if (args.model_file.empty()) {
         return EXIT_SUCCESS;
     }
@@ -170,15 +636,37 @@ static int Main(const Args& args) {
     std::clog << "Vocabulary size: " << vocab.size() << std::endl;
     const yzw2v::huff::HuffmanTree huffman_tree{vocab};
     const auto params = MakeParamsFromArgs(args);
+    const auto& train_file = params.input_is_id_corpus ? args.ids_in_file : args.text_file;
     const auto start_time = std::chrono::high_resolution_clock::now();
-    const auto model = yzw2v::train::TrainCBOWModel(args.text_file, vocab, huffman_tree, params,
-                                                    args.thread_count);
+    const auto model = args.use_cbow
+        ? yzw2v::train::TrainCBOWModel(train_file, vocab, huffman_tree, params,
+                                       args.thread_count)
+        : yzw2v::train::TrainSkipGramModel(train_file, vocab, huffman_tree, params,
+                                           args.thread_count);
     const auto stop_time = std::chrono::high_resolution_clock::now();
     std::clog << "Training done in "
               << std::chrono::duration_cast<std::chrono::seconds>(stop_time - start_time).count()
               << " seconds"
               << std::endl;
     WriteModelBinary(args.model_file, vocab, model);
+    if (!args.int8_model_file.empty()) {
+        WriteModelInt8(args.int8_model_file, vocab, model);
+    }
+
+    if (!args.output_layer_file.empty()) {
+        WriteOutputLayerBinary(args.output_layer_file, vocab, model);
+    }
+
+    if (!args.hnsw_output_file.empty() || !args.analogies_file.empty()
+        || !args.similarity_files.empty()) {
+        const yzw2v::query::Model normalized{vocab, *model.matrix_holder};
+        if (!args.hnsw_output_file.empty()) {
+            yzw2v::hnsw::BuildIndex(normalized.matrix(), MakeHNSWParamsFromArgs(args),
+                                    args.hnsw_output_file);
+        }
+
+        Evaluate(args, normalized);
+    }
 
     return EXIT_SUCCESS;
 }
@@ -189,5 +677,10 @@ int main(int argc, char* argv[]) {
         SetFloatinPointEnvironment();
     }
 
+    // must be done before any vector is allocated
+    yzw2v::num::SelectInstructionSet(args.instruction_set);
+    std::clog << "Instruction set: " << yzw2v::num::SelectedInstructionSet() << std::endl;
+    yzw2v::mem::SetHugePages(MakeHugePagesFromArgs(args));
+
     return Main(args);
 }
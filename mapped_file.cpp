@@ -0,0 +1,7 @@
+#if defined(__linux__) || defined(__APPLE__)
+#include "mapped_file_posix.cpp"
+#elif defined(_WIN32) || defined(_WIN64)
+#include "mapped_file_win.cpp"
+#else
+#error "No implementation for current platform"
+#endif
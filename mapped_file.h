@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string>
+
+#include <cstdint>
+
+namespace yzw2v {
+    namespace io {
+        enum class Access {
+            SEQUENTIAL,  // aggressive read-ahead
+            RANDOM       // no read-ahead, e.g. rows of a model
+        };
+
+        // Read-only mapping of `size` bytes of file starting at `offset`, `access` is a hint for
+        // OS how pages are going to be accessed.
+        class MappedFile {
+        public:
+            MappedFile(const std::string& path, const uint64_t size, const uint64_t offset,
+                       const Access access = Access::SEQUENTIAL);
+            ~MappedFile();
+
+            MappedFile(const MappedFile&) = delete;
+            MappedFile& operator=(const MappedFile&) = delete;
+
+            const char* data() const noexcept;
+            uint64_t size() const noexcept;
+
+        private:
+            const char* data_;
+            uint64_t size_;
+
+            // actual mapping starts at offset aligned by page (allocation granularity on Windows)
+            void* mapping_;
+            uint64_t mapping_size_;
+        };
+    }
+}
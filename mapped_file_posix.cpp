@@ -0,0 +1,56 @@
+#include "mapped_file.h"
+
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+yzw2v::io::MappedFile::MappedFile(const std::string& path, const uint64_t size,
+                                  const uint64_t offset, const Access access)
+    : data_{nullptr}
+    , size_{size}
+    , mapping_{nullptr}
+    , mapping_size_{0}
+{
+    if (!size) {
+        return;
+    }
+
+    const auto fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error{"failed to open file"};
+    }
+
+    const auto page_size = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    const auto mapping_offset = offset - offset % page_size;
+    mapping_size_ = size + (offset - mapping_offset);
+    mapping_ = mmap(nullptr, static_cast<size_t>(mapping_size_), PROT_READ, MAP_PRIVATE, fd,
+                    static_cast<off_t>(mapping_offset));
+    // mapping holds its own reference to the file
+    close(fd);
+    if (MAP_FAILED == mapping_) {
+        throw std::runtime_error{"mmap failed"};
+    }
+
+    // more aggressive read-ahead, pages behind may be dropped early (or no read-ahead at all for
+    // random access); it's only an advice, so result is ignored
+    madvise(mapping_, static_cast<size_t>(mapping_size_),
+            Access::RANDOM == access ? MADV_RANDOM : MADV_SEQUENTIAL);
+
+    data_ = static_cast<const char*>(mapping_) + (offset - mapping_offset);
+}
+
+yzw2v::io::MappedFile::~MappedFile() {
+    if (mapping_) {
+        munmap(mapping_, static_cast<size_t>(mapping_size_));
+    }
+}
+
+const char* yzw2v::io::MappedFile::data() const noexcept {
+    return data_;
+}
+
+uint64_t yzw2v::io::MappedFile::size() const noexcept {
+    return size_;
+}
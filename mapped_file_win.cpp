@@ -0,0 +1,64 @@
+#include "mapped_file.h"
+
+#include <stdexcept>
+
+#include <windows.h>
+
+yzw2v::io::MappedFile::MappedFile(const std::string& path, const uint64_t size,
+                                  const uint64_t offset, const Access access)
+    : data_{nullptr}
+    , size_{size}
+    , mapping_{nullptr}
+    , mapping_size_{0}
+{
+    if (!size) {
+        return;
+    }
+
+    const auto file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                                  OPEN_EXISTING,
+                                  Access::RANDOM == access
+                                      ? FILE_FLAG_RANDOM_ACCESS
+                                      : FILE_FLAG_SEQUENTIAL_SCAN,
+                                  nullptr);
+    if (INVALID_HANDLE_VALUE == file) {
+        throw std::runtime_error{"failed to open file"};
+    }
+
+    const auto file_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!file_mapping) {
+        throw std::runtime_error{"CreateFileMapping failed"};
+    }
+
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    const auto granularity = static_cast<uint64_t>(info.dwAllocationGranularity);
+    const auto mapping_offset = offset - offset % granularity;
+    mapping_size_ = size + (offset - mapping_offset);
+    mapping_ = MapViewOfFile(file_mapping, FILE_MAP_READ,
+                             static_cast<DWORD>(mapping_offset >> 32),
+                             static_cast<DWORD>(mapping_offset & 0xFFFFFFFF),
+                             static_cast<SIZE_T>(mapping_size_));
+    // view holds its own reference to the mapping
+    CloseHandle(file_mapping);
+    if (!mapping_) {
+        throw std::runtime_error{"MapViewOfFile failed"};
+    }
+
+    data_ = static_cast<const char*>(mapping_) + (offset - mapping_offset);
+}
+
+yzw2v::io::MappedFile::~MappedFile() {
+    if (mapping_) {
+        UnmapViewOfFile(mapping_);
+    }
+}
+
+const char* yzw2v::io::MappedFile::data() const noexcept {
+    return data_;
+}
+
+uint64_t yzw2v::io::MappedFile::size() const noexcept {
+    return size_;
+}
@@ -1,20 +1,58 @@
 #include "matrix.h"
 
-yzw2v::num::Matrix::Matrix(const uint32_t rows_count, const uint32_t columns_count)
+#include <cassert>
+#include <cstring>
+
+static size_t ElementSize(const yzw2v::num::Precision precision) noexcept {
+    return yzw2v::num::Precision::FP32 == precision ? sizeof(float) : sizeof(uint16_t);
+}
+
+// Half precision matrix takes half as many floats, rounded up.
+static size_t FloatsCount(const uint32_t rows_count, const uint32_t padded_columns_count,
+                          const yzw2v::num::Precision precision) noexcept {
+    const auto count = size_t{rows_count} * padded_columns_count;
+    return yzw2v::num::Precision::FP32 == precision ? count : (count + 1) / 2;
+}
+
+yzw2v::num::Matrix::Matrix(const uint32_t rows_count, const uint32_t columns_count,
+                           const Precision precision)
     : padded_columns_count_{mem::RoundSizeUpByVecSize(columns_count)}
     , rows_count_{rows_count}
     , columns_count_{columns_count}
-    , matrix_holder_{mem::AllocateFloatForSIMD(rows_count * padded_columns_count_)}
+    , precision_{precision}
+    , matrix_holder_{mem::AllocateFloatForSIMD(FloatsCount(rows_count, padded_columns_count_,
+                                                           precision))}
 {
     matrix_ = matrix_holder_.get();
+    half_matrix_ = reinterpret_cast<uint16_t*>(matrix_);
 }
 
 float* yzw2v::num::Matrix::row(const uint32_t index) noexcept {
-    return matrix_ + padded_columns_count_ * index;
+    assert(Precision::FP32 == precision_);
+    return matrix_ + static_cast<size_t>(padded_columns_count_) * index;
 }
 
 const float* yzw2v::num::Matrix::row(const uint32_t index) const noexcept {
-    return matrix_ + padded_columns_count_ * index;
+    assert(Precision::FP32 == precision_);
+    return matrix_ + static_cast<size_t>(padded_columns_count_) * index;
+}
+
+uint16_t* yzw2v::num::Matrix::half_row(const uint32_t index) noexcept {
+    assert(Precision::FP32 != precision_);
+    return half_matrix_ + static_cast<size_t>(padded_columns_count_) * index;
+}
+
+const uint16_t* yzw2v::num::Matrix::half_row(const uint32_t index) const noexcept {
+    assert(Precision::FP32 != precision_);
+    return half_matrix_ + static_cast<size_t>(padded_columns_count_) * index;
+}
+
+void yzw2v::num::Matrix::CopyRow(const uint32_t index, float* const res) const noexcept {
+    if (Precision::FP32 == precision_) {
+        std::memcpy(res, row(index), sizeof(float) * columns_count_);
+    } else {
+        Widen(half_row(index), columns_count_, precision_, res);
+    }
 }
 
 uint32_t yzw2v::num::Matrix::rows_count() const noexcept {
@@ -24,3 +62,19 @@ uint32_t yzw2v::num::Matrix::rows_count() const noexcept {
 uint32_t yzw2v::num::Matrix::columns_count() const noexcept {
     return columns_count_;
 }
+
+yzw2v::num::Precision yzw2v::num::Matrix::precision() const noexcept {
+    return precision_;
+}
+
+void* yzw2v::num::Matrix::data() noexcept {
+    return matrix_;
+}
+
+const void* yzw2v::num::Matrix::data() const noexcept {
+    return matrix_;
+}
+
+size_t yzw2v::num::Matrix::bytes_count() const noexcept {
+    return ElementSize(precision_) * rows_count_ * padded_columns_count_;
+}
@@ -1,28 +1,47 @@
 #pragma once
 
 #include "mem.h"
+#include "numeric.h"
 
 #include <memory>
 
+#include <cstddef>
 #include <cstdint>
 
 namespace yzw2v {
     namespace num {
         class Matrix {
         public:
-            Matrix(const uint32_t rows_count, const uint32_t columns_count);
+            Matrix(const uint32_t rows_count, const uint32_t columns_count,
+                   const Precision precision = Precision::FP32);
 
+            // Only for FP32 matrix.
             float* row(const uint32_t index) noexcept;
             const float* row(const uint32_t index) const noexcept;
 
+            // Only for FP16 and BF16 matrix.
+            uint16_t* half_row(const uint32_t index) noexcept;
+            const uint16_t* half_row(const uint32_t index) const noexcept;
+
+            // Row as floats whatever the precision is, `res` must be allocated by
+            // `mem::AllocateFloatForSIMD` for `columns_count()` values.
+            void CopyRow(const uint32_t index, float* res) const noexcept;
+
             uint32_t rows_count() const noexcept;
             uint32_t columns_count() const noexcept;
+            Precision precision() const noexcept;
+
+            void* data() noexcept;
+            const void* data() const noexcept;
+            size_t bytes_count() const noexcept;
 
         private:
             uint32_t padded_columns_count_;
             float* matrix_;
+            uint16_t* half_matrix_;
             uint32_t rows_count_;
             uint32_t columns_count_;
+            Precision precision_;
             std::unique_ptr<float, mem::detail::Deleter> matrix_holder_;
         };
     }
@@ -2,21 +2,55 @@
 
 #include <memory>
 
+#include <cstddef>
 #include <cstdint>
 
 namespace yzw2v {
     namespace mem {
         namespace detail {
+            // Knows how the memory was allocated: `free` for heap, `munmap` for mapped memory.
             class Deleter {
             public:
+                Deleter() noexcept;
+                explicit Deleter(const size_t mapped_size) noexcept;
+
                 void operator() (void* const ptr) const noexcept;
+
+            private:
+                size_t mapped_size_;  // 0 for heap
             };
         }
 
-        extern const uint32_t VEC_SIZE;
+        // Floats per SIMD register of `num` kernels in use, set by `num::SelectInstructionSet`.
+        extern uint32_t VEC_SIZE;
 
         uint32_t RoundSizeUpByVecSize(const uint32_t size) noexcept;
 
-        std::unique_ptr<float, detail::Deleter> AllocateFloatForSIMD(const uint32_t size);
+        enum class HugePages {
+            NONE,         // plain heap
+            TRANSPARENT,  // 2 Mb aligned mapping with `madvise(MADV_HUGEPAGE)`
+            EXPLICIT_2MB, // MAP_HUGETLB from hugetlbfs pool, then as TRANSPARENT
+            EXPLICIT_1GB  // MAP_HUGETLB | MAP_HUGE_1GB, then as EXPLICIT_2MB
+        };
+
+        /* Applies to allocations of at least one huge page (2 Mb) made afterwards, smaller ones
+         * always go to heap. Whatever the OS refuses falls back to the next option down to heap,
+         * so allocation never fails because of huge pages. Not supported on Windows.
+         */
+        void SetHugePages(const HugePages policy) noexcept;
+
+        struct HugePagesStats {
+            uint64_t large_bytes;         // live allocations of at least one huge page
+            uint64_t explicit_bytes;      // backed by MAP_HUGETLB pages
+            uint64_t transparent_bytes;   // backed by transparent huge pages right now
+        };
+
+        // Transparent huge pages are assigned by kernel on page faults, so they are counted in
+        // /proc/self/smaps at the moment of the call.
+        HugePagesStats GetHugePagesStats();
+
+        // Zeroed memory aligned for any of `num` kernels, `size` is rounded up by `VEC_SIZE`.
+        std::unique_ptr<float, detail::Deleter> AllocateFloatForSIMD(const size_t size);
+        std::unique_ptr<uint32_t, detail::Deleter> AllocateUInt32(const size_t size);
     }
 }
@@ -1,24 +1,236 @@
 #include "mem.h"
 
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <sstream>
 #include <stdexcept>
+#include <string>
 
 #include <cstdlib>
 #include <cstring>
 
+#include <sys/mman.h>
+
+// enough for any instruction set we have kernels for; also can't be less than `sizeof(void*)`
+static constexpr size_t ALIGNMENT = 64;
+
+static constexpr size_t HUGE_PAGE_SIZE = size_t{1} << 21;      // 2 Mb
+static constexpr size_t GIGANTIC_PAGE_SIZE = size_t{1} << 30;  // 1 Gb
+
+#if defined(__linux__) && !defined(MAP_HUGE_SHIFT)
+#define MAP_HUGE_SHIFT 26
+#endif
+
+namespace {
+    enum class Backing {
+        HEAP,
+        EXPLICIT,
+        TRANSPARENT
+    };
+
+    struct Region {
+        size_t size;
+        Backing backing;
+    };
+
+    // every allocation of at least `HUGE_PAGE_SIZE` bytes, by address
+    struct Registry {
+        std::mutex mutex;
+        std::map<uintptr_t, Region> regions;
+        yzw2v::mem::HugePages policy = yzw2v::mem::HugePages::TRANSPARENT;
+    };
+}
+
+static Registry& GetRegistry() {
+    static Registry registry;
+    return registry;
+}
+
+static void Register(void* const ptr, const size_t size, const Backing backing) {
+    auto& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock{registry.mutex};
+    registry.regions[reinterpret_cast<uintptr_t>(ptr)] = {size, backing};
+}
+
+yzw2v::mem::detail::Deleter::Deleter() noexcept
+    : mapped_size_{0} {
+}
+
+yzw2v::mem::detail::Deleter::Deleter(const size_t mapped_size) noexcept
+    : mapped_size_{mapped_size} {
+}
+
 void yzw2v::mem::detail::Deleter::operator ()(void* const ptr) const noexcept {
-    std::free(ptr);
+    {
+        auto& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock{registry.mutex};
+        registry.regions.erase(reinterpret_cast<uintptr_t>(ptr));
+    }
+
+    if (mapped_size_) {
+        munmap(ptr, mapped_size_);
+    } else {
+        std::free(ptr);
+    }
 }
 
-std::unique_ptr<float, yzw2v::mem::detail::Deleter>
-yzw2v::mem::AllocateFloatForSIMD(const uint32_t size) {
-    auto* res = static_cast<float*>(nullptr);
-    const auto actual_size = RoundSizeUpByVecSize(size);
-    const auto ret = posix_memalign(reinterpret_cast<void**>(&res), sizeof(float) * VEC_SIZE, sizeof(float) * actual_size);
-    if (ret) {
+void yzw2v::mem::SetHugePages(const HugePages policy) noexcept {
+    auto& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock{registry.mutex};
+    registry.policy = policy;
+}
+
+static yzw2v::mem::HugePages GetPolicy() {
+    auto& registry = GetRegistry();
+    std::lock_guard<std::mutex> lock{registry.mutex};
+    return registry.policy;
+}
+
+#if defined(__linux__)
+static void* MapExplicit(const size_t size, const int page_size_flag) {
+    auto* const res = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | page_size_flag, -1, 0);
+    return MAP_FAILED == res ? nullptr : res;
+}
+
+// Transparent huge pages are used only for 2 Mb aligned parts of a mapping, so we map a bit
+// more and trim both ends.
+static void* MapTransparent(const size_t size) {
+    auto* const mapping = mmap(nullptr, size + HUGE_PAGE_SIZE, PROT_READ | PROT_WRITE,
+                               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (MAP_FAILED == mapping) {
+        return nullptr;
+    }
+
+    const auto begin = reinterpret_cast<uintptr_t>(mapping);
+    const auto aligned_begin = (begin + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    if (aligned_begin > begin) {
+        munmap(mapping, aligned_begin - begin);
+    }
+
+    const auto tail = begin + size + HUGE_PAGE_SIZE - (aligned_begin + size);
+    if (tail) {
+        munmap(reinterpret_cast<void*>(aligned_begin + size), tail);
+    }
+
+    auto* const res = reinterpret_cast<void*>(aligned_begin);
+
+    // only an advice, e.g. THP may be disabled system-wide; then we just have regular pages
+    madvise(res, size, MADV_HUGEPAGE);
+    return res;
+}
+#endif
+
+// Zeroed memory, `bytes` is a multiple of `ALIGNMENT`.
+static void* Allocate(const size_t bytes, yzw2v::mem::detail::Deleter& deleter) {
+    const auto policy = bytes >= HUGE_PAGE_SIZE ? GetPolicy() : yzw2v::mem::HugePages::NONE;
+#if defined(__linux__)
+    if (yzw2v::mem::HugePages::EXPLICIT_1GB == policy) {
+        const auto size = (bytes + GIGANTIC_PAGE_SIZE - 1) / GIGANTIC_PAGE_SIZE * GIGANTIC_PAGE_SIZE;
+        if (auto* const res = MapExplicit(size, 30 << MAP_HUGE_SHIFT)) {
+            Register(res, size, Backing::EXPLICIT);
+            deleter = yzw2v::mem::detail::Deleter{size};
+            return res;
+        }
+    }
+
+    if (yzw2v::mem::HugePages::EXPLICIT_1GB == policy
+        || yzw2v::mem::HugePages::EXPLICIT_2MB == policy) {
+        const auto size = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+        if (auto* const res = MapExplicit(size, 21 << MAP_HUGE_SHIFT)) {
+            Register(res, size, Backing::EXPLICIT);
+            deleter = yzw2v::mem::detail::Deleter{size};
+            return res;
+        }
+    }
+
+    if (yzw2v::mem::HugePages::NONE != policy) {
+        const auto size = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+        if (auto* const res = MapTransparent(size)) {
+            Register(res, size, Backing::TRANSPARENT);
+            deleter = yzw2v::mem::detail::Deleter{size};
+            return res;
+        }
+    }
+#endif
+
+    auto* res = static_cast<void*>(nullptr);
+    if (posix_memalign(&res, ALIGNMENT, bytes)) {
         throw std::runtime_error{"aligned allocation failed"};
     }
 
-    std::memset(res, 0, sizeof(float) * actual_size);
+    std::memset(res, 0, bytes);
+    if (bytes >= HUGE_PAGE_SIZE) {
+        Register(res, bytes, Backing::HEAP);
+    }
+
+    deleter = yzw2v::mem::detail::Deleter{};
+    return res;
+}
+
+std::unique_ptr<float, yzw2v::mem::detail::Deleter>
+yzw2v::mem::AllocateFloatForSIMD(const size_t size) {
+    // not `RoundSizeUpByVecSize`, whole matrix may have more than 2^32 floats
+    const auto actual_size = (size + VEC_SIZE - 1) / VEC_SIZE * VEC_SIZE;
+    auto deleter = detail::Deleter{};
+    auto* const res = Allocate(sizeof(float) * actual_size, deleter);
+    return std::unique_ptr<float, yzw2v::mem::detail::Deleter>{static_cast<float*>(res), deleter};
+}
+
+std::unique_ptr<uint32_t, yzw2v::mem::detail::Deleter>
+yzw2v::mem::AllocateUInt32(const size_t size) {
+    const auto bytes = (sizeof(uint32_t) * size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+    auto deleter = detail::Deleter{};
+    auto* const res = Allocate(bytes, deleter);
+    return std::unique_ptr<uint32_t, yzw2v::mem::detail::Deleter>{static_cast<uint32_t*>(res),
+                                                                   deleter};
+}
+
+yzw2v::mem::HugePagesStats yzw2v::mem::GetHugePagesStats() {
+    auto res = HugePagesStats{};
+    auto transparent_regions = std::map<uintptr_t, Region>{};
+    {
+        auto& registry = GetRegistry();
+        std::lock_guard<std::mutex> lock{registry.mutex};
+        for (const auto& region : registry.regions) {
+            res.large_bytes += region.second.size;
+            if (Backing::EXPLICIT == region.second.backing) {
+                res.explicit_bytes += region.second.size;
+            } else if (Backing::TRANSPARENT == region.second.backing) {
+                transparent_regions.insert(region);
+            }
+        }
+    }
+
+#if defined(__linux__)
+    if (transparent_regions.empty()) {
+        return res;
+    }
+
+    // "begin-end perms ..." starts description of a mapping, "AnonHugePages: N kB" is one of its
+    // fields; adjacent regions with the same flags may be merged into one mapping by kernel
+    std::ifstream smaps{"/proc/self/smaps"};
+    auto counted = false;
+    for (std::string line; std::getline(smaps, line);) {
+        auto begin = uintptr_t{};
+        auto end = uintptr_t{};
+        auto dash = char{};
+        std::istringstream in{line};
+        if (in >> std::hex >> begin >> dash >> end && '-' == dash) {
+            const auto next = transparent_regions.lower_bound(end);
+            counted = next != transparent_regions.begin()
+                      && std::prev(next)->first + std::prev(next)->second.size > begin;
+            continue;
+        }
+
+        static const std::string FIELD = "AnonHugePages:";
+        if (counted && !line.compare(0, FIELD.size(), FIELD)) {
+            res.transparent_bytes += std::stoull(line.substr(FIELD.size())) * 1024;
+        }
+    }
+#endif
 
-    return std::unique_ptr<float, yzw2v::mem::detail::Deleter>{res};
+    return res;
 }
@@ -1,12 +1,8 @@
 #include "mem.h"
 
-#if defined(__AVX__)
-const uint32_t yzw2v::mem::VEC_SIZE = 8;
-#elif defined(__SSE__)
-const uint32_t yzw2v::mem::VEC_SIZE = 4;
-#else
-const uint32_t yzw2v::mem::VEC_SIZE = 1;
-#endif
+// actual value is set during static initialization of `numeric.cpp`, it's up to 16 floats (64 bytes,
+// one AVX-512 register), so every row is padded to it and aligned to a cache line
+uint32_t yzw2v::mem::VEC_SIZE = 1;
 
 uint32_t yzw2v::mem::RoundSizeUpByVecSize(const uint32_t size) noexcept {
     if (const auto remainder = size % VEC_SIZE) {
@@ -7,19 +7,50 @@
 
 #include <malloc.h>
 
+// large pages on Windows require SeLockMemoryPrivilege, so everything goes to heap
+static constexpr size_t ALIGNMENT = 128;
+
+yzw2v::mem::detail::Deleter::Deleter() noexcept
+    : mapped_size_{0} {
+}
+
+yzw2v::mem::detail::Deleter::Deleter(const size_t mapped_size) noexcept
+    : mapped_size_{mapped_size} {
+}
+
 void yzw2v::mem::detail::Deleter::operator ()(void* const ptr) const noexcept {
     _aligned_free(ptr);
 }
 
-std::unique_ptr<float, yzw2v::mem::detail::Deleter>
-yzw2v::mem::AllocateFloatForSIMD(const uint32_t size) {
-    const auto actual_size = RoundSizeUpByVecSize(size);
-    auto* const res = reinterpret_cast<float*>(_aligned_malloc(sizeof(float) * actual_size, 128));
+void yzw2v::mem::SetHugePages(const HugePages) noexcept {
+}
+
+yzw2v::mem::HugePagesStats yzw2v::mem::GetHugePagesStats() {
+    return {};
+}
+
+static void* Allocate(const size_t bytes) {
+    auto* const res = _aligned_malloc(bytes, ALIGNMENT);
     if (!res) {
-        std::runtime_error{"aligned allocation failed"};
+        throw std::runtime_error{"aligned allocation failed"};
     }
 
-    std::memset(res, 0, sizeof(float) * actual_size);
+    std::memset(res, 0, bytes);
+    return res;
+}
+
+std::unique_ptr<float, yzw2v::mem::detail::Deleter>
+yzw2v::mem::AllocateFloatForSIMD(const size_t size) {
+    // not `RoundSizeUpByVecSize`, whole matrix may have more than 2^32 floats
+    const auto actual_size = (size + VEC_SIZE - 1) / VEC_SIZE * VEC_SIZE;
+    return std::unique_ptr<float, yzw2v::mem::detail::Deleter>{
+        static_cast<float*>(Allocate(sizeof(float) * actual_size))
+    };
+}
 
-    return std::unique_ptr<float, yzw2v::mem::detail::Deleter>{res};
+std::unique_ptr<uint32_t, yzw2v::mem::detail::Deleter>
+yzw2v::mem::AllocateUInt32(const size_t size) {
+    return std::unique_ptr<uint32_t, yzw2v::mem::detail::Deleter>{
+        static_cast<uint32_t*>(Allocate(sizeof(uint32_t) * size))
+    };
 }
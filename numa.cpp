@@ -0,0 +1,29 @@
+#if defined(__linux__)
+#include "numa_linux.cpp"
+#else
+#include "numa_other.cpp"
+#endif
+
+std::string yzw2v::numa::FormatList(const std::vector<uint32_t>& values) {
+    auto res = std::string{};
+    for (auto i = size_t{}; i < values.size();) {
+        auto j = i + 1;
+        while (j < values.size() && values[j] == values[j - 1] + 1) {
+            ++j;
+        }
+
+        if (!res.empty()) {
+            res += ',';
+        }
+
+        res += std::to_string(values[i]);
+        if (j - i > 1) {
+            res += '-';
+            res += std::to_string(values[j - 1]);
+        }
+
+        i = j;
+    }
+
+    return res;
+}
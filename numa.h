@@ -0,0 +1,33 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace yzw2v {
+    namespace numa {
+        struct Node {
+            uint32_t id;
+            std::vector<uint32_t> cpus;  // only CPUs the process is allowed to run on
+        };
+
+        /* Nodes that have CPUs available to the process. On platforms we can't query (or if
+         * sysfs is not mounted) it's a single node 0 with all CPUs.
+         */
+        std::vector<Node> DetectNodes();
+
+        // Restricts current thread to `cpus`, false if OS refused.
+        bool PinCurrentThread(const std::vector<uint32_t>& cpus);
+
+        /* Spreads pages of [ptr, ptr + size) round-robin over `nodes`, pages that are already
+         * touched are moved. Only whole pages inside the range are affected. False if OS refused
+         * (e.g. mbind is forbidden in container).
+         */
+        bool InterleaveMemory(void* const ptr, const size_t size, const std::vector<Node>& nodes);
+
+        // "0-3,8,10-11"
+        std::string FormatList(const std::vector<uint32_t>& values);
+    }
+}
@@ -0,0 +1,120 @@
+#include "numa.h"
+
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+#include <linux/mempolicy.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// libnuma is not a dependency, so topology is read from sysfs and memory policy is set by syscalls
+static const char NODES_DIR[] = "/sys/devices/system/node/";
+
+// Parses lists like "0-3,8,10-11", empty on error.
+static std::vector<uint32_t> ParseList(const std::string& str) {
+    auto res = std::vector<uint32_t>{};
+    std::istringstream in{str};
+    for (std::string range; std::getline(in, range, ',');) {
+        if (range.empty() || '\n' == range[0]) {
+            continue;
+        }
+
+        const auto dash = range.find('-');
+        try {
+            const auto first = std::stoul(range.substr(0, dash));
+            const auto last = std::string::npos == dash ? first : std::stoul(range.substr(dash + 1));
+            for (auto value = first; value <= last; ++value) {
+                res.push_back(static_cast<uint32_t>(value));
+            }
+        } catch (const std::exception&) {
+            return {};
+        }
+    }
+
+    return res;
+}
+
+static std::vector<uint32_t> ReadList(const std::string& path) {
+    std::ifstream in{path};
+    auto str = std::string{};
+    std::getline(in, str);
+    return ParseList(str);
+}
+
+static std::vector<uint32_t> AllowedCPUs() {
+    auto res = std::vector<uint32_t>{};
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set)) {
+        return res;
+    }
+
+    for (auto cpu = uint32_t{}; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &set)) {
+            res.push_back(cpu);
+        }
+    }
+
+    return res;
+}
+
+std::vector<yzw2v::numa::Node> yzw2v::numa::DetectNodes() {
+    const auto allowed = AllowedCPUs();
+    auto res = std::vector<Node>{};
+    for (const auto id : ReadList(std::string{NODES_DIR} + "online")) {
+        auto node = Node{id, {}};
+        const auto node_cpus = ReadList(std::string{NODES_DIR} + "node" + std::to_string(id)
+                                        + "/cpulist");
+        std::set_intersection(node_cpus.begin(), node_cpus.end(), allowed.begin(), allowed.end(),
+                              std::back_inserter(node.cpus));
+        if (!node.cpus.empty()) {
+            res.push_back(std::move(node));
+        }
+    }
+
+    if (res.empty()) {
+        res.push_back({0, allowed});
+    }
+
+    return res;
+}
+
+bool yzw2v::numa::PinCurrentThread(const std::vector<uint32_t>& cpus) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (const auto cpu : cpus) {
+        if (cpu < CPU_SETSIZE) {
+            CPU_SET(cpu, &set);
+        }
+    }
+
+    return !sched_setaffinity(0, sizeof(set), &set);
+}
+
+bool yzw2v::numa::InterleaveMemory(void* const ptr, const size_t size,
+                                   const std::vector<Node>& nodes) {
+    static constexpr size_t BITS_PER_WORD = sizeof(unsigned long) * 8;
+    auto max_id = uint32_t{};
+    for (const auto& node : nodes) {
+        max_id = std::max(max_id, node.id);
+    }
+
+    auto mask = std::vector<unsigned long>(max_id / BITS_PER_WORD + 1);
+    for (const auto& node : nodes) {
+        mask[node.id / BITS_PER_WORD] |= 1ul << (node.id % BITS_PER_WORD);
+    }
+
+    const auto page_size = static_cast<uintptr_t>(sysconf(_SC_PAGESIZE));
+    const auto begin = (reinterpret_cast<uintptr_t>(ptr) + page_size - 1) / page_size * page_size;
+    const auto end = (reinterpret_cast<uintptr_t>(ptr) + size) / page_size * page_size;
+    if (begin >= end) {
+        return true;
+    }
+
+    return !syscall(__NR_mbind, begin, end - begin, MPOL_INTERLEAVE, mask.data(),
+                    mask.size() * BITS_PER_WORD, MPOL_MF_MOVE);
+}
@@ -0,0 +1,22 @@
+#include "numa.h"
+
+#include <algorithm>
+#include <thread>
+
+std::vector<yzw2v::numa::Node> yzw2v::numa::DetectNodes() {
+    auto node = Node{0, {}};
+    const auto cpus_count = std::max(std::thread::hardware_concurrency(), 1u);
+    for (auto cpu = uint32_t{}; cpu < cpus_count; ++cpu) {
+        node.cpus.push_back(cpu);
+    }
+
+    return {node};
+}
+
+bool yzw2v::numa::PinCurrentThread(const std::vector<uint32_t>&) {
+    return false;
+}
+
+bool yzw2v::numa::InterleaveMemory(void* const, const size_t, const std::vector<Node>&) {
+    return false;
+}
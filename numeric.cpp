@@ -1,10 +1,245 @@
-#if defined(__AVX__)
-#pragma message("[yzw2v] will use AVX instruction set for linear algebra")
-#include "numeric_avx.cpp"
-#elif defined(__SSE__)
-#pragma message("[yzw2v] will use SSE instruction set for linear algebra")
-#include "numeric_sse.cpp"
-#else
-#pragma message("[yzw2v] will use basic C++ code for linear algebra")
-#include "numeric_simple.cpp"
+#include "numeric.h"
+#include "numeric_kernels.h"
+
+#include "cpu.h"
+#include "mem.h"
+
+#include <stdexcept>
+
+#include <cassert>
+
+static_assert(yzw2v::num::INT8_ROW_ALIGNMENT == yzw2v::num::detail::INT8_ROW_ALIGNMENT,
+              "kernels must agree on padding of int8 rows");
+
+using yzw2v::num::detail::HalfKernels;
+using yzw2v::num::detail::Kernels;
+
+static const Kernels* const ALL_KERNELS[] = {
+    &yzw2v::num::detail::SIMPLE_KERNELS,
+#if defined(YZ_NUM_X86_KERNELS)
+    &yzw2v::num::detail::SSE_KERNELS,
+    &yzw2v::num::detail::AVX_KERNELS,
+    &yzw2v::num::detail::AVX2_KERNELS,
+    &yzw2v::num::detail::AVX512_KERNELS,
 #endif
+};
+
+static bool IsSupported(const Kernels& kernels) noexcept {
+#if defined(YZ_NUM_X86_KERNELS)
+    const auto& features = yzw2v::cpu::GetFeatures();
+    if (&yzw2v::num::detail::SSE_KERNELS == &kernels) {
+        return features.sse2;
+    } else if (&yzw2v::num::detail::AVX_KERNELS == &kernels) {
+        return features.avx;
+    } else if (&yzw2v::num::detail::AVX2_KERNELS == &kernels) {
+        return features.avx2 && features.fma && features.f16c;
+    } else if (&yzw2v::num::detail::AVX512_KERNELS == &kernels) {
+        return features.avx512f;
+    }
+#endif
+
+    return &yzw2v::num::detail::SIMPLE_KERNELS == &kernels;
+}
+
+static const Kernels* Activate(const Kernels& kernels) noexcept {
+    yzw2v::mem::VEC_SIZE = kernels.vec_size;
+    return &kernels;
+}
+
+static const Kernels& Best() noexcept {
+    // kernels are listed from the narrowest to the widest instruction set
+    const auto* res = &yzw2v::num::detail::SIMPLE_KERNELS;
+    for (const auto* const kernels : ALL_KERNELS) {
+        if (IsSupported(*kernels)) {
+            res = kernels;
+        }
+    }
+
+    return *res;
+}
+
+// Selected during static initialization, `mem::VEC_SIZE` is constant-initialized so it's safe to
+// update it from here.
+static const Kernels* KERNELS = Activate(Best());
+
+void yzw2v::num::SelectInstructionSet(const std::string& name) {
+    if ("auto" == name) {
+        KERNELS = Activate(Best());
+        return;
+    }
+
+    for (const auto* const kernels : ALL_KERNELS) {
+        if (name != kernels->name) {
+            continue;
+        }
+
+        if (!IsSupported(*kernels)) {
+            throw std::runtime_error{"instruction set is not supported by CPU: " + name};
+        }
+
+        KERNELS = Activate(*kernels);
+        return;
+    }
+
+    throw std::runtime_error{"unknown instruction set: " + name};
+}
+
+const char* yzw2v::num::SelectedInstructionSet() noexcept {
+    return KERNELS->name;
+}
+
+const char* yzw2v::num::PrecisionName(const Precision precision) noexcept {
+    switch (precision) {
+        case Precision::FP32:
+            return "fp32";
+        case Precision::FP16:
+            return "fp16";
+        case Precision::BF16:
+            return "bf16";
+    }
+
+    return "unknown";
+}
+
+static const HalfKernels* Half(const yzw2v::num::Precision precision) noexcept {
+    assert(yzw2v::num::Precision::FP32 != precision);
+    return yzw2v::num::Precision::BF16 == precision ? KERNELS->bf16 : KERNELS->fp16;
+}
+
+void yzw2v::num::Fill(float* v, const uint32_t v_size, const float value) noexcept {
+    KERNELS->fill(v, v_size, value);
+}
+
+void yzw2v::num::Zeroize(float* v, const uint32_t v_size) noexcept {
+    KERNELS->zeroize(v, v_size);
+}
+
+void yzw2v::num::Prefetch(const float* v) noexcept {
+    KERNELS->prefetch(v);
+}
+
+void yzw2v::num::DivideVector(float* v, const uint32_t v_size, const float divisor) noexcept {
+    KERNELS->divide_vector(v, v_size, divisor);
+}
+
+void yzw2v::num::MultiplyVector(float* v, const uint32_t v_size, const float multiple) noexcept {
+    KERNELS->multiply_vector(v, v_size, multiple);
+}
+
+void yzw2v::num::AddVector(float* v, const uint32_t v_size, const float* summand) noexcept {
+    KERNELS->add_vector(v, v_size, summand);
+}
+
+void yzw2v::num::AddVector(float* v, const uint32_t v_size,
+                           const float* summand, const float summand_multiple) noexcept {
+    KERNELS->add_vector_with_multiple(v, v_size, summand, summand_multiple);
+}
+
+float yzw2v::num::ScalarProduct(const float* lhs, const uint32_t lhs_size,
+                                const float* rhs) noexcept {
+    return KERNELS->scalar_product(lhs, lhs_size, rhs);
+}
+
+int32_t yzw2v::num::ScalarProduct(const int8_t* lhs, const uint32_t lhs_size,
+                                  const int8_t* rhs) noexcept {
+    return KERNELS->int8_scalar_product(lhs, lhs_size, rhs);
+}
+
+void yzw2v::num::Prefetch(const uint16_t* v) noexcept {
+    // prefetches as much as for a float row, which is more than enough
+    KERNELS->prefetch(reinterpret_cast<const float*>(v));
+}
+
+void yzw2v::num::Widen(const uint16_t* v, const uint32_t v_size, const Precision precision,
+                       float* res) noexcept {
+    Half(precision)->widen(v, v_size, res);
+}
+
+void yzw2v::num::Narrow(const float* v, const uint32_t v_size, const Precision precision,
+                        uint16_t* res) noexcept {
+    Half(precision)->narrow(v, v_size, res);
+}
+
+void yzw2v::num::AddVector(float* v, const uint32_t v_size,
+                           const uint16_t* summand, const Precision summand_precision) noexcept {
+    Half(summand_precision)->add_to_float(v, v_size, summand);
+}
+
+void yzw2v::num::AddVector(uint16_t* v, const Precision v_precision, const uint32_t v_size,
+                           const float* summand) noexcept {
+    Half(v_precision)->add_float(v, v_size, summand);
+}
+
+void yzw2v::num::ScalarProducts(const float* const* lhs, const uint32_t lhs_count,
+                                const float* const* rhs, const uint32_t rhs_count,
+                                const uint32_t v_size, float* res) noexcept {
+    KERNELS->scalar_products(lhs, lhs_count, rhs, rhs_count, v_size, res);
+}
+
+void yzw2v::num::AddVectors(float* const* v, const uint32_t v_count,
+                            const float* const* summands, const uint32_t summands_count,
+                            const uint32_t v_size, const float* summands_multiples) noexcept {
+    KERNELS->add_vectors(v, v_count, summands, summands_count, v_size, summands_multiples);
+}
+
+float yzw2v::num::NegativeSamplingGradient(const float f, const float label,
+                                           const float* const exp_table) noexcept {
+    static constexpr auto MAX_EXP_FLT = static_cast<float>(MAX_EXP);
+    if (f > MAX_EXP_FLT) {
+        return label - 1.0f;
+    } else if (f < -MAX_EXP_FLT) {
+        return label - 0.0f;
+    }
+
+    const auto exp_index = static_cast<uint32_t>(
+        (f + MAX_EXP_FLT) * (EXP_TABLE_SIZE / MAX_EXP / 2)
+    );
+    return label - exp_table[exp_index];
+}
+
+float yzw2v::num::HierarchicalSoftmaxGradient(const float f, const float label,
+                                              const float* const exp_table) noexcept {
+    static constexpr auto MAX_EXP_FLT = static_cast<float>(MAX_EXP);
+    if (f <= -MAX_EXP_FLT || f >= MAX_EXP_FLT) {
+        return 0.0f;
+    }
+
+    const auto exp_index = static_cast<uint32_t>(
+        (f + MAX_EXP_FLT) * (EXP_TABLE_SIZE / MAX_EXP / 2)
+    );
+    return label - exp_table[exp_index];
+}
+
+float yzw2v::num::NegativeSamplingUpdate(const float* const hidden, float* const errors,
+                                         float* const row, const uint32_t v_size,
+                                         const float label, const float alpha,
+                                         const float* const exp_table) noexcept {
+    const auto f = KERNELS->scalar_product(hidden, v_size, row);
+    const auto g = alpha * NegativeSamplingGradient(f, label, exp_table);
+    KERNELS->exchange_gradients(errors, row, v_size, hidden, g);
+    return g;
+}
+
+float yzw2v::num::HierarchicalSoftmaxUpdate(const float* const hidden, float* const errors,
+                                            float* const row, const uint32_t v_size,
+                                            const float label, const float alpha,
+                                            const float* const exp_table) noexcept {
+    const auto f = KERNELS->scalar_product(hidden, v_size, row);
+    const auto g = alpha * HierarchicalSoftmaxGradient(f, label, exp_table);
+    if (0.0f != g) {
+        KERNELS->exchange_gradients(errors, row, v_size, hidden, g);
+    }
+
+    return g;
+}
+
+float yzw2v::num::NegativeSamplingUpdate(const float* const hidden, float* const errors,
+                                         uint16_t* const row, const Precision row_precision,
+                                         const uint32_t v_size, const float label,
+                                         const float alpha, const float* const exp_table) noexcept {
+    const auto* const kernels = Half(row_precision);
+    const auto f = kernels->scalar_product(hidden, v_size, row);
+    const auto g = alpha * NegativeSamplingGradient(f, label, exp_table);
+    kernels->exchange_gradients(errors, row, v_size, hidden, g);
+    return g;
+}
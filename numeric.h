@@ -1,9 +1,33 @@
 #pragma once
 
+#include <string>
+
 #include <cinttypes>
 
 namespace yzw2v {
     namespace num {
+        // sigmoid is approximated by a table of `EXP_TABLE_SIZE` values on [-MAX_EXP, MAX_EXP]
+        static constexpr uint32_t EXP_TABLE_SIZE = 1000;
+        static constexpr uint32_t MAX_EXP = 6;
+
+        // How elements of a `Matrix` are stored. FP16 and BF16 values are converted to float in
+        // registers, all arithmetic is done in float and results are rounded to nearest even.
+        enum class Precision {
+            FP32,
+            FP16,  // IEEE half: 10 bits of mantissa, |x| < 65504
+            BF16   // upper half of float: 7 bits of mantissa, same range as float
+        };
+
+        const char* PrecisionName(const Precision precision) noexcept;
+
+        /* All kernel variants are compiled into the binary and the best one supported by CPU is
+         * selected on startup. Variant can be changed by name ("auto", "simple", "sse", "avx", "avx2",
+         * "avx512"), but only before any memory for vectors was allocated, since it also changes
+         * `mem::VEC_SIZE`.
+         */
+        void SelectInstructionSet(const std::string& name);
+        const char* SelectedInstructionSet() noexcept;
+
         void Fill(float* v, const uint32_t v_size, const float value) noexcept;
         void Zeroize(float* v, const uint32_t v_size) noexcept;
         void Prefetch(const float* v) noexcept;
@@ -17,5 +41,71 @@ namespace yzw2v {
                        const float* summand, const float summand_multiple) noexcept;
 
         float ScalarProduct(const float* lhs, const uint32_t lhs_size, const float* rhs) noexcept;
+
+        /* Exact scalar product of int8 vectors with values in [-127, 127] (so pairwise products
+         * fit `pmaddubsw`). Rows must be aligned to and padded by zeros to a multiple of
+         * `INT8_ROW_ALIGNMENT` bytes, whatever the instruction set is.
+         */
+        static constexpr uint32_t INT8_ROW_ALIGNMENT = 64;
+        int32_t ScalarProduct(const int8_t* lhs, const uint32_t lhs_size, const int8_t* rhs) noexcept;
+
+        /* Same for rows stored in 16-bit `precision` (FP16 or BF16). Half precision rows must be
+         * padded to `mem::VEC_SIZE` values just as float ones.
+         */
+        void Prefetch(const uint16_t* v) noexcept;
+        void Widen(const uint16_t* v, const uint32_t v_size, const Precision precision,
+                   float* res) noexcept;
+        void Narrow(const float* v, const uint32_t v_size, const Precision precision,
+                    uint16_t* res) noexcept;
+        void AddVector(float* v, const uint32_t v_size,
+                       const uint16_t* summand, const Precision summand_precision) noexcept;
+        void AddVector(uint16_t* v, const Precision v_precision, const uint32_t v_size,
+                       const float* summand) noexcept;
+
+        /* Small matrix-matrix kernels, rows are passed as arrays of pointers so they may point
+         * directly into rows of `Matrix`.
+         */
+
+        // res[i * rhs_count + j] = <lhs[i], rhs[j]>
+        void ScalarProducts(const float* const* lhs, const uint32_t lhs_count,
+                            const float* const* rhs, const uint32_t rhs_count,
+                            const uint32_t v_size, float* res) noexcept;
+
+        // v[i] += sum_j summands_multiples[i * summands_count + j] * summands[j]
+        void AddVectors(float* const* v, const uint32_t v_count,
+                        const float* const* summands, const uint32_t summands_count,
+                        const uint32_t v_size, const float* summands_multiples) noexcept;
+
+        // Gradient of log-likelihood of `label` w.r.t. `f` clipped at the ends of exp table, as it
+        // is done for negative sampling in word2vec
+        float NegativeSamplingGradient(const float f, const float label,
+                                       const float* exp_table) noexcept;
+
+        // Same as `NegativeSamplingGradient`, but zero outside of exp table, as it is done for
+        // hierarchical softmax in word2vec
+        float HierarchicalSoftmaxGradient(const float f, const float label,
+                                          const float* exp_table) noexcept;
+
+        /* Fused kernels for one (hidden vector, output row) pair, hottest part of training:
+         *
+         * g = alpha * gradient(<hidden, row>, label)
+         * errors += g * row
+         * row += g * hidden
+         *
+         * Both updates are done in a single pass over `row`, right after the pass of scalar
+         * product, so `row` is read from L1 and written back once. Return `g`.
+         */
+        float NegativeSamplingUpdate(const float* hidden, float* errors, float* row,
+                                     const uint32_t v_size, const float label, const float alpha,
+                                     const float* exp_table) noexcept;
+        float HierarchicalSoftmaxUpdate(const float* hidden, float* errors, float* row,
+                                        const uint32_t v_size, const float label,
+                                        const float alpha, const float* exp_table) noexcept;
+
+        // `row` is converted in registers and rounded once, after the update
+        float NegativeSamplingUpdate(const float* hidden, float* errors, uint16_t* row,
+                                     const Precision row_precision, const uint32_t v_size,
+                                     const float label, const float alpha,
+                                     const float* exp_table) noexcept;
     }
 }
@@ -1,58 +1,58 @@
-#include "numeric.h"
+#include "numeric_kernels.h"
 
 #include "assume_aligned.h"
 #include "mem.h"
 
 #include <immintrin.h>
 
-void yzw2v::num::Prefetch(const float* v) noexcept {
-    v = YZ_ASSUME_ALIGNED(v, 256);
+static void Prefetch(const float* v) {
+    v = YZ_ASSUME_ALIGNED(v, 32);
     for (auto i = uint32_t{}; i < 8 * 4; ++i) {
         _mm_prefetch(v + i * 8, _MM_HINT_T0);
     }
 }
 
-void yzw2v::num::Fill(float* v, const uint32_t v_size, const float value) noexcept {
-    v = YZ_ASSUME_ALIGNED(v, 256);
+static void Fill(float* v, const uint32_t v_size, const float value) {
+    v = YZ_ASSUME_ALIGNED(v, 32);
     const auto wide_value = _mm256_set1_ps(value);
-    for (const auto* const v_end = v + mem::RoundSizeUpByVecSize(v_size); v < v_end; v += 8) {
+    for (const auto* const v_end = v + yzw2v::mem::RoundSizeUpByVecSize(v_size); v < v_end; v += 8) {
         _mm256_store_ps(v, wide_value);
     }
 }
 
-void yzw2v::num::Zeroize(float* const v, const uint32_t v_size) noexcept {
+static void Zeroize(float* const v, const uint32_t v_size) {
     Fill(v, v_size, 0.0f);
 }
 
-void yzw2v::num::DivideVector(float* v, const uint32_t v_size, const float divisor) noexcept {
-    v = YZ_ASSUME_ALIGNED(v, 256);
+static void DivideVector(float* v, const uint32_t v_size, const float divisor) {
+    v = YZ_ASSUME_ALIGNED(v, 32);
     const auto wide_divisor = _mm256_set1_ps(divisor);
-    for (const auto* const v_end = v + mem::RoundSizeUpByVecSize(v_size); v < v_end; v += 8) {
+    for (const auto* const v_end = v + yzw2v::mem::RoundSizeUpByVecSize(v_size); v < v_end; v += 8) {
         _mm256_store_ps(v, _mm256_div_ps(_mm256_load_ps(v), wide_divisor));
     }
 }
 
-void yzw2v::num::MultiplyVector(float* v, const uint32_t v_size, const float multiple) noexcept {
-    v = YZ_ASSUME_ALIGNED(v, 256);
+static void MultiplyVector(float* v, const uint32_t v_size, const float multiple) {
+    v = YZ_ASSUME_ALIGNED(v, 32);
     const auto wide_multiple = _mm256_set1_ps(multiple);
-    for (const auto* const v_end = v + mem::RoundSizeUpByVecSize(v_size); v < v_end; v += 8) {
+    for (const auto* const v_end = v + yzw2v::mem::RoundSizeUpByVecSize(v_size); v < v_end; v += 8) {
         _mm256_store_ps(v, _mm256_mul_ps(_mm256_load_ps(v), wide_multiple));
     }
 }
 
-void yzw2v::num::AddVector(float* v, const uint32_t v_size, const float* summand) noexcept {
-    v = YZ_ASSUME_ALIGNED(v, 256);
-    for (const auto* const v_end = v + mem::RoundSizeUpByVecSize(v_size); v < v_end; summand += 8, v += 8) {
+static void AddVector(float* v, const uint32_t v_size, const float* summand) {
+    v = YZ_ASSUME_ALIGNED(v, 32);
+    for (const auto* const v_end = v + yzw2v::mem::RoundSizeUpByVecSize(v_size); v < v_end; summand += 8, v += 8) {
         _mm256_store_ps(v, _mm256_add_ps(_mm256_load_ps(v), _mm256_load_ps(summand)));
     }
 }
 
-void yzw2v::num::AddVector(float* v, const uint32_t v_size,
-                           const float* summand, const float summand_multiple) noexcept {
-    v = YZ_ASSUME_ALIGNED(v, 256);
-    summand = YZ_ASSUME_ALIGNED(summand, 256);
+static void AddVector(float* v, const uint32_t v_size,
+                      const float* summand, const float summand_multiple) {
+    v = YZ_ASSUME_ALIGNED(v, 32);
+    summand = YZ_ASSUME_ALIGNED(summand, 32);
     const auto wide_summand_multiple = _mm256_set1_ps(summand_multiple);
-    for (const auto* const v_end = v + mem::RoundSizeUpByVecSize(v_size); v < v_end; summand += 8, v += 8) {
+    for (const auto* const v_end = v + yzw2v::mem::RoundSizeUpByVecSize(v_size); v < v_end; summand += 8, v += 8) {
         _mm256_store_ps(v, _mm256_add_ps(_mm256_load_ps(v),
                                          _mm256_mul_ps(wide_summand_multiple,
                                                        _mm256_load_ps(summand)
@@ -62,11 +62,11 @@ void yzw2v::num::AddVector(float* v, const uint32_t v_size,
     }
 }
 
-float yzw2v::num::ScalarProduct(const float* v, const uint32_t v_size,
-                                const float* rhs) noexcept {
-    const auto* const v_end_rounded_up = v + mem::RoundSizeUpByVecSize(v_size);
-    v = YZ_ASSUME_ALIGNED(v, 256);
-    rhs = YZ_ASSUME_ALIGNED(rhs, 256);
+static float ScalarProduct(const float* v, const uint32_t v_size,
+                           const float* rhs) {
+    const auto* const v_end_rounded_up = v + yzw2v::mem::RoundSizeUpByVecSize(v_size);
+    v = YZ_ASSUME_ALIGNED(v, 32);
+    rhs = YZ_ASSUME_ALIGNED(rhs, 32);
 
     __m256 wide_res[8] = {};
     for (const auto* const v_end = v + ((v_end_rounded_up - v) % 64); v < v_end; v += 8, rhs += 8) {
@@ -99,3 +99,155 @@ float yzw2v::num::ScalarProduct(const float* v, const uint32_t v_size,
     return wide_res[0][0] + wide_res[0][1] + wide_res[0][2] + wide_res[0][3]
            + wide_res[0][4] + wide_res[0][5] + wide_res[0][6] + wide_res[0][7];
 }
+
+/* Both matrix kernels go over columns in blocks, so the part of every row used by the block stays
+ * in L1 until all rows on the other side are done with it.
+ */
+static constexpr uint32_t COLUMNS_BLOCK_SIZE = 128;  // 512 bytes of each row
+
+static void ScalarProducts(const float* const* lhs, const uint32_t lhs_count,
+                           const float* const* rhs, const uint32_t rhs_count,
+                           const uint32_t v_size, float* res) {
+    const auto v_size_rounded_up = yzw2v::mem::RoundSizeUpByVecSize(v_size);
+    for (auto i = uint32_t{}; i < lhs_count * rhs_count; ++i) {
+        res[i] = 0.0f;
+    }
+
+    for (auto block_begin = uint32_t{}; block_begin < v_size_rounded_up; block_begin += COLUMNS_BLOCK_SIZE) {
+        const auto block_end = block_begin + COLUMNS_BLOCK_SIZE < v_size_rounded_up
+                               ? block_begin + COLUMNS_BLOCK_SIZE
+                               : v_size_rounded_up;
+        for (auto i = uint32_t{}; i < lhs_count; ++i) {
+            const auto* const l = lhs[i];
+            auto* const res_row = res + i * rhs_count;
+
+            // four rows of `rhs` at a time, so every chunk of `l` loaded into register is used
+            // four times
+            auto j = uint32_t{};
+            for (; j + 4 <= rhs_count; j += 4) {
+                const auto* const r0 = rhs[j];
+                const auto* const r1 = rhs[j + 1];
+                const auto* const r2 = rhs[j + 2];
+                const auto* const r3 = rhs[j + 3];
+
+                auto wide_res0 = _mm256_setzero_ps();
+                auto wide_res1 = _mm256_setzero_ps();
+                auto wide_res2 = _mm256_setzero_ps();
+                auto wide_res3 = _mm256_setzero_ps();
+                for (auto k = block_begin; k < block_end; k += 8) {
+                    const auto wide_l = _mm256_load_ps(l + k);
+                    wide_res0 = _mm256_add_ps(wide_res0, _mm256_mul_ps(wide_l, _mm256_load_ps(r0 + k)));
+                    wide_res1 = _mm256_add_ps(wide_res1, _mm256_mul_ps(wide_l, _mm256_load_ps(r1 + k)));
+                    wide_res2 = _mm256_add_ps(wide_res2, _mm256_mul_ps(wide_l, _mm256_load_ps(r2 + k)));
+                    wide_res3 = _mm256_add_ps(wide_res3, _mm256_mul_ps(wide_l, _mm256_load_ps(r3 + k)));
+                }
+
+                // [sum(wide_res0), sum(wide_res1), sum(wide_res2), sum(wide_res3)]
+                const auto wide_res01 = _mm256_hadd_ps(wide_res0, wide_res1);
+                const auto wide_res23 = _mm256_hadd_ps(wide_res2, wide_res3);
+                const auto wide_res0123 = _mm256_hadd_ps(wide_res01, wide_res23);
+                _mm_storeu_ps(res_row + j,
+                              _mm_add_ps(_mm_loadu_ps(res_row + j),
+                                         _mm_add_ps(_mm256_castps256_ps128(wide_res0123),
+                                                    _mm256_extractf128_ps(wide_res0123, 1))));
+            }
+
+            for (; j < rhs_count; ++j) {
+                const auto* const r = rhs[j];
+                auto wide_res = _mm256_setzero_ps();
+                for (auto k = block_begin; k < block_end; k += 8) {
+                    wide_res = _mm256_add_ps(wide_res, _mm256_mul_ps(_mm256_load_ps(l + k),
+                                                                     _mm256_load_ps(r + k)));
+                }
+
+                res_row[j] += wide_res[0] + wide_res[1] + wide_res[2] + wide_res[3]
+                              + wide_res[4] + wide_res[5] + wide_res[6] + wide_res[7];
+            }
+        }
+    }
+}
+
+static void AddVectors(float* const* v, const uint32_t v_count,
+                       const float* const* summands, const uint32_t summands_count,
+                       const uint32_t v_size, const float* summands_multiples) {
+    const auto v_size_rounded_up = yzw2v::mem::RoundSizeUpByVecSize(v_size);
+    for (auto block_begin = uint32_t{}; block_begin < v_size_rounded_up; block_begin += COLUMNS_BLOCK_SIZE) {
+        const auto block_end = block_begin + COLUMNS_BLOCK_SIZE < v_size_rounded_up
+                               ? block_begin + COLUMNS_BLOCK_SIZE
+                               : v_size_rounded_up;
+        for (auto i = uint32_t{}; i < v_count; ++i) {
+            auto* const row = v[i];
+            const auto* const multiples = summands_multiples + i * summands_count;
+
+            // each chunk of `row` is loaded and stored only once
+            for (auto k = block_begin; k < block_end; k += 8) {
+                auto wide_row = _mm256_load_ps(row + k);
+                for (auto j = uint32_t{}; j < summands_count; ++j) {
+                    wide_row = _mm256_add_ps(wide_row,
+                                             _mm256_mul_ps(_mm256_broadcast_ss(multiples + j),
+                                                           _mm256_load_ps(summands[j] + k)));
+                }
+
+                _mm256_store_ps(row + k, wide_row);
+            }
+        }
+    }
+}
+
+static void ExchangeGradients(float* errors, float* row, const uint32_t v_size,
+                              const float* summand, const float multiple) {
+    errors = YZ_ASSUME_ALIGNED(errors, 32);
+    row = YZ_ASSUME_ALIGNED(row, 32);
+    summand = YZ_ASSUME_ALIGNED(summand, 32);
+    const auto wide_multiple = _mm256_set1_ps(multiple);
+    for (const auto* const row_end = row + yzw2v::mem::RoundSizeUpByVecSize(v_size); row < row_end;
+         errors += 8, row += 8, summand += 8) {
+        const auto wide_row = _mm256_load_ps(row);
+        _mm256_store_ps(errors, _mm256_add_ps(_mm256_load_ps(errors),
+                                              _mm256_mul_ps(wide_multiple, wide_row)));
+        _mm256_store_ps(row, _mm256_add_ps(wide_row,
+                                           _mm256_mul_ps(wide_multiple, _mm256_load_ps(summand))));
+    }
+}
+
+/* No 256-bit integer instructions in AVX, but SSSE3 `pmaddubsw` is there: it multiplies unsigned
+ * bytes by signed ones, so sign of `lhs` is moved to `rhs`. Values are in [-127, 127], so sums of
+ * pairs of products fit int16 without saturation.
+ */
+static int32_t ScalarProduct(const int8_t* lhs, const uint32_t lhs_size, const int8_t* rhs) {
+    using yzw2v::num::detail::INT8_ROW_ALIGNMENT;
+    const auto* const lhs_end = lhs + (lhs_size + INT8_ROW_ALIGNMENT - 1) / INT8_ROW_ALIGNMENT
+                                      * INT8_ROW_ALIGNMENT;
+    const auto ones = _mm_set1_epi16(1);
+    auto wide_res = _mm_setzero_si128();
+    for (; lhs < lhs_end; lhs += 16, rhs += 16) {
+        const auto wide_lhs = _mm_load_si128(reinterpret_cast<const __m128i*>(lhs));
+        const auto wide_rhs = _mm_load_si128(reinterpret_cast<const __m128i*>(rhs));
+        const auto products = _mm_maddubs_epi16(_mm_sign_epi8(wide_lhs, wide_lhs),
+                                                _mm_sign_epi8(wide_rhs, wide_lhs));
+        wide_res = _mm_add_epi32(wide_res, _mm_madd_epi16(products, ones));
+    }
+
+    wide_res = _mm_hadd_epi32(wide_res, wide_res);
+    wide_res = _mm_hadd_epi32(wide_res, wide_res);
+    return _mm_cvtsi128_si32(wide_res);
+}
+
+const yzw2v::num::detail::Kernels yzw2v::num::detail::AVX_KERNELS = {
+    "avx",
+    8,
+    Fill,
+    Zeroize,
+    Prefetch,
+    DivideVector,
+    MultiplyVector,
+    AddVector,
+    AddVector,
+    ScalarProduct,
+    ScalarProducts,
+    AddVectors,
+    ExchangeGradients,
+    &SIMPLE_FP16_KERNELS,  // no conversion instructions, F16C is a separate extension
+    &SIMPLE_BF16_KERNELS,
+    ScalarProduct
+};
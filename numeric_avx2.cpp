@@ -0,0 +1,376 @@
+#include "numeric_kernels.h"
+
+#include "assume_aligned.h"
+#include "mem.h"
+
+#include <immintrin.h>
+
+// Same as AVX kernels, but every multiply-add is a single FMA instruction and FP16 rows are
+// converted by F16C instructions
+
+static float HorizontalSum(const __m256 v) {
+    const auto half = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    const auto quarter = _mm_add_ps(half, _mm_movehl_ps(half, half));
+    return _mm_cvtss_f32(_mm_add_ss(quarter, _mm_movehdup_ps(quarter)));
+}
+
+static void Prefetch(const float* v) {
+    v = YZ_ASSUME_ALIGNED(v, 32);
+    // one prefetch per cache line instead of one per register
+    for (auto i = uint32_t{}; i < 16; ++i) {
+        _mm_prefetch(v + i * 16, _MM_HINT_T0);
+    }
+}
+
+static void Fill(float* v, const uint32_t v_size, const float value) {
+    v = YZ_ASSUME_ALIGNED(v, 32);
+    const auto wide_value = _mm256_set1_ps(value);
+    for (const auto* const v_end = v + yzw2v::mem::RoundSizeUpByVecSize(v_size); v < v_end; v += 8) {
+        _mm256_store_ps(v, wide_value);
+    }
+}
+
+static void Zeroize(float* const v, const uint32_t v_size) {
+    Fill(v, v_size, 0.0f);
+}
+
+static void DivideVector(float* v, const uint32_t v_size, const float divisor) {
+    v = YZ_ASSUME_ALIGNED(v, 32);
+    const auto wide_divisor = _mm256_set1_ps(divisor);
+    for (const auto* const v_end = v + yzw2v::mem::RoundSizeUpByVecSize(v_size); v < v_end; v += 8) {
+        _mm256_store_ps(v, _mm256_div_ps(_mm256_load_ps(v), wide_divisor));
+    }
+}
+
+static void MultiplyVector(float* v, const uint32_t v_size, const float multiple) {
+    v = YZ_ASSUME_ALIGNED(v, 32);
+    const auto wide_multiple = _mm256_set1_ps(multiple);
+    for (const auto* const v_end = v + yzw2v::mem::RoundSizeUpByVecSize(v_size); v < v_end; v += 8) {
+        _mm256_store_ps(v, _mm256_mul_ps(_mm256_load_ps(v), wide_multiple));
+    }
+}
+
+static void AddVector(float* v, const uint32_t v_size, const float* summand) {
+    v = YZ_ASSUME_ALIGNED(v, 32);
+    summand = YZ_ASSUME_ALIGNED(summand, 32);
+    for (const auto* const v_end = v + yzw2v::mem::RoundSizeUpByVecSize(v_size); v < v_end; summand += 8, v += 8) {
+        _mm256_store_ps(v, _mm256_add_ps(_mm256_load_ps(v), _mm256_load_ps(summand)));
+    }
+}
+
+static void AddVector(float* v, const uint32_t v_size,
+                      const float* summand, const float summand_multiple) {
+    v = YZ_ASSUME_ALIGNED(v, 32);
+    summand = YZ_ASSUME_ALIGNED(summand, 32);
+    const auto wide_summand_multiple = _mm256_set1_ps(summand_multiple);
+    for (const auto* const v_end = v + yzw2v::mem::RoundSizeUpByVecSize(v_size); v < v_end; summand += 8, v += 8) {
+        _mm256_store_ps(v, _mm256_fmadd_ps(wide_summand_multiple, _mm256_load_ps(summand),
+                                           _mm256_load_ps(v)));
+    }
+}
+
+static float ScalarProduct(const float* v, const uint32_t v_size,
+                           const float* rhs) {
+    const auto* const v_end_rounded_up = v + yzw2v::mem::RoundSizeUpByVecSize(v_size);
+    v = YZ_ASSUME_ALIGNED(v, 32);
+    rhs = YZ_ASSUME_ALIGNED(rhs, 32);
+
+    // four independent accumulators to hide FMA latency
+    __m256 wide_res[4] = {};
+    for (const auto* const v_end = v + ((v_end_rounded_up - v) % 32); v < v_end; v += 8, rhs += 8) {
+        wide_res[0] = _mm256_fmadd_ps(_mm256_load_ps(v), _mm256_load_ps(rhs), wide_res[0]);
+    }
+
+    for (; v < v_end_rounded_up; v += 32, rhs += 32) {
+        wide_res[0] = _mm256_fmadd_ps(_mm256_load_ps(v), _mm256_load_ps(rhs), wide_res[0]);
+        wide_res[1] = _mm256_fmadd_ps(_mm256_load_ps(v + 8), _mm256_load_ps(rhs + 8), wide_res[1]);
+        wide_res[2] = _mm256_fmadd_ps(_mm256_load_ps(v + 16), _mm256_load_ps(rhs + 16), wide_res[2]);
+        wide_res[3] = _mm256_fmadd_ps(_mm256_load_ps(v + 24), _mm256_load_ps(rhs + 24), wide_res[3]);
+    }
+
+    wide_res[0] = _mm256_add_ps(wide_res[0], wide_res[1]);
+    wide_res[2] = _mm256_add_ps(wide_res[2], wide_res[3]);
+
+    return HorizontalSum(_mm256_add_ps(wide_res[0], wide_res[2]));
+}
+
+/* Both matrix kernels go over columns in blocks, so the part of every row used by the block stays
+ * in L1 until all rows on the other side are done with it.
+ */
+static constexpr uint32_t COLUMNS_BLOCK_SIZE = 128;  // 512 bytes of each row
+
+static void ScalarProducts(const float* const* lhs, const uint32_t lhs_count,
+                           const float* const* rhs, const uint32_t rhs_count,
+                           const uint32_t v_size, float* res) {
+    const auto v_size_rounded_up = yzw2v::mem::RoundSizeUpByVecSize(v_size);
+    for (auto i = uint32_t{}; i < lhs_count * rhs_count; ++i) {
+        res[i] = 0.0f;
+    }
+
+    for (auto block_begin = uint32_t{}; block_begin < v_size_rounded_up; block_begin += COLUMNS_BLOCK_SIZE) {
+        const auto block_end = block_begin + COLUMNS_BLOCK_SIZE < v_size_rounded_up
+                               ? block_begin + COLUMNS_BLOCK_SIZE
+                               : v_size_rounded_up;
+        for (auto i = uint32_t{}; i < lhs_count; ++i) {
+            const auto* const l = lhs[i];
+            auto* const res_row = res + i * rhs_count;
+
+            // four rows of `rhs` at a time, so every chunk of `l` loaded into register is used
+            // four times
+            auto j = uint32_t{};
+            for (; j + 4 <= rhs_count; j += 4) {
+                const auto* const r0 = rhs[j];
+                const auto* const r1 = rhs[j + 1];
+                const auto* const r2 = rhs[j + 2];
+                const auto* const r3 = rhs[j + 3];
+
+                auto wide_res0 = _mm256_setzero_ps();
+                auto wide_res1 = _mm256_setzero_ps();
+                auto wide_res2 = _mm256_setzero_ps();
+                auto wide_res3 = _mm256_setzero_ps();
+                for (auto k = block_begin; k < block_end; k += 8) {
+                    const auto wide_l = _mm256_load_ps(l + k);
+                    wide_res0 = _mm256_fmadd_ps(wide_l, _mm256_load_ps(r0 + k), wide_res0);
+                    wide_res1 = _mm256_fmadd_ps(wide_l, _mm256_load_ps(r1 + k), wide_res1);
+                    wide_res2 = _mm256_fmadd_ps(wide_l, _mm256_load_ps(r2 + k), wide_res2);
+                    wide_res3 = _mm256_fmadd_ps(wide_l, _mm256_load_ps(r3 + k), wide_res3);
+                }
+
+                // [sum(wide_res0), sum(wide_res1), sum(wide_res2), sum(wide_res3)]
+                const auto wide_res01 = _mm256_hadd_ps(wide_res0, wide_res1);
+                const auto wide_res23 = _mm256_hadd_ps(wide_res2, wide_res3);
+                const auto wide_res0123 = _mm256_hadd_ps(wide_res01, wide_res23);
+                _mm_storeu_ps(res_row + j,
+                              _mm_add_ps(_mm_loadu_ps(res_row + j),
+                                         _mm_add_ps(_mm256_castps256_ps128(wide_res0123),
+                                                    _mm256_extractf128_ps(wide_res0123, 1))));
+            }
+
+            for (; j < rhs_count; ++j) {
+                const auto* const r = rhs[j];
+                auto wide_res = _mm256_setzero_ps();
+                for (auto k = block_begin; k < block_end; k += 8) {
+                    wide_res = _mm256_fmadd_ps(_mm256_load_ps(l + k), _mm256_load_ps(r + k), wide_res);
+                }
+
+                res_row[j] += HorizontalSum(wide_res);
+            }
+        }
+    }
+}
+
+static void AddVectors(float* const* v, const uint32_t v_count,
+                       const float* const* summands, const uint32_t summands_count,
+                       const uint32_t v_size, const float* summands_multiples) {
+    const auto v_size_rounded_up = yzw2v::mem::RoundSizeUpByVecSize(v_size);
+    for (auto block_begin = uint32_t{}; block_begin < v_size_rounded_up; block_begin += COLUMNS_BLOCK_SIZE) {
+        const auto block_end = block_begin + COLUMNS_BLOCK_SIZE < v_size_rounded_up
+                               ? block_begin + COLUMNS_BLOCK_SIZE
+                               : v_size_rounded_up;
+        for (auto i = uint32_t{}; i < v_count; ++i) {
+            auto* const row = v[i];
+            const auto* const multiples = summands_multiples + i * summands_count;
+
+            // each chunk of `row` is loaded and stored only once
+            for (auto k = block_begin; k < block_end; k += 8) {
+                auto wide_row = _mm256_load_ps(row + k);
+                for (auto j = uint32_t{}; j < summands_count; ++j) {
+                    wide_row = _mm256_fmadd_ps(_mm256_broadcast_ss(multiples + j),
+                                               _mm256_load_ps(summands[j] + k), wide_row);
+                }
+
+                _mm256_store_ps(row + k, wide_row);
+            }
+        }
+    }
+}
+
+static void ExchangeGradients(float* errors, float* row, const uint32_t v_size,
+                              const float* summand, const float multiple) {
+    errors = YZ_ASSUME_ALIGNED(errors, 32);
+    row = YZ_ASSUME_ALIGNED(row, 32);
+    summand = YZ_ASSUME_ALIGNED(summand, 32);
+    const auto wide_multiple = _mm256_set1_ps(multiple);
+    for (const auto* const row_end = row + yzw2v::mem::RoundSizeUpByVecSize(v_size); row < row_end;
+         errors += 8, row += 8, summand += 8) {
+        const auto wide_row = _mm256_load_ps(row);
+        _mm256_store_ps(errors, _mm256_fmadd_ps(wide_multiple, wide_row, _mm256_load_ps(errors)));
+        _mm256_store_ps(row, _mm256_fmadd_ps(wide_multiple, _mm256_load_ps(summand), wide_row));
+    }
+}
+
+/* Half precision rows: 8 values (16 bytes, rows are padded to `VEC_SIZE` values) are converted to
+ * or from one register. FP16 uses F16C instructions, BF16 is the upper half of float, so it is
+ * converted by shifts, rounding to nearest even is done by hand.
+ */
+namespace {
+    struct FP16 {
+        static __m256 Load(const uint16_t* const v) {
+            return _mm256_cvtph_ps(_mm_load_si128(reinterpret_cast<const __m128i*>(v)));
+        }
+
+        static void Store(uint16_t* const v, const __m256 value) {
+            _mm_store_si128(reinterpret_cast<__m128i*>(v),
+                            _mm256_cvtps_ph(value, _MM_FROUND_TO_NEAREST_INT));
+        }
+    };
+
+    struct BF16 {
+        static __m256 Load(const uint16_t* const v) {
+            const auto wide = _mm256_cvtepu16_epi32(_mm_load_si128(reinterpret_cast<const __m128i*>(v)));
+            return _mm256_castsi256_ps(_mm256_slli_epi32(wide, 16));
+        }
+
+        static void Store(uint16_t* const v, const __m256 value) {
+            const auto bits = _mm256_castps_si256(value);
+            const auto lsb = _mm256_and_si256(_mm256_srli_epi32(bits, 16), _mm256_set1_epi32(1));
+            const auto rounded = _mm256_add_epi32(bits, _mm256_add_epi32(_mm256_set1_epi32(0x7FFF), lsb));
+            const auto quiet_nan = _mm256_or_si256(bits, _mm256_set1_epi32(0x400000));
+            const auto is_nan = _mm256_castps_si256(_mm256_cmp_ps(value, value, _CMP_UNORD_Q));
+            const auto res = _mm256_srli_epi32(_mm256_blendv_epi8(rounded, quiet_nan, is_nan), 16);
+            _mm_store_si128(reinterpret_cast<__m128i*>(v),
+                            _mm_packus_epi32(_mm256_castsi256_si128(res),
+                                             _mm256_extracti128_si256(res, 1)));
+        }
+    };
+}
+
+template <typename Format>
+static void Widen(const uint16_t* v, const uint32_t v_size, float* res) {
+    res = YZ_ASSUME_ALIGNED(res, 32);
+    for (const auto* const res_end = res + yzw2v::mem::RoundSizeUpByVecSize(v_size); res < res_end;
+         v += 8, res += 8) {
+        _mm256_store_ps(res, Format::Load(v));
+    }
+}
+
+template <typename Format>
+static void Narrow(const float* v, const uint32_t v_size, uint16_t* res) {
+    v = YZ_ASSUME_ALIGNED(v, 32);
+    for (const auto* const v_end = v + yzw2v::mem::RoundSizeUpByVecSize(v_size); v < v_end;
+         v += 8, res += 8) {
+        Format::Store(res, _mm256_load_ps(v));
+    }
+}
+
+template <typename Format>
+static void AddToFloat(float* v, const uint32_t v_size, const uint16_t* summand) {
+    v = YZ_ASSUME_ALIGNED(v, 32);
+    for (const auto* const v_end = v + yzw2v::mem::RoundSizeUpByVecSize(v_size); v < v_end;
+         summand += 8, v += 8) {
+        _mm256_store_ps(v, _mm256_add_ps(_mm256_load_ps(v), Format::Load(summand)));
+    }
+}
+
+template <typename Format>
+static void AddFloat(uint16_t* v, const uint32_t v_size, const float* summand) {
+    summand = YZ_ASSUME_ALIGNED(summand, 32);
+    for (const auto* const v_end = v + yzw2v::mem::RoundSizeUpByVecSize(v_size); v < v_end;
+         summand += 8, v += 8) {
+        Format::Store(v, _mm256_add_ps(Format::Load(v), _mm256_load_ps(summand)));
+    }
+}
+
+template <typename Format>
+static float ScalarProduct(const float* v, const uint32_t v_size, const uint16_t* rhs) {
+    const auto* const v_end_rounded_up = v + yzw2v::mem::RoundSizeUpByVecSize(v_size);
+    v = YZ_ASSUME_ALIGNED(v, 32);
+
+    __m256 wide_res[4] = {};
+    for (const auto* const v_end = v + ((v_end_rounded_up - v) % 32); v < v_end; v += 8, rhs += 8) {
+        wide_res[0] = _mm256_fmadd_ps(_mm256_load_ps(v), Format::Load(rhs), wide_res[0]);
+    }
+
+    for (; v < v_end_rounded_up; v += 32, rhs += 32) {
+        wide_res[0] = _mm256_fmadd_ps(_mm256_load_ps(v), Format::Load(rhs), wide_res[0]);
+        wide_res[1] = _mm256_fmadd_ps(_mm256_load_ps(v + 8), Format::Load(rhs + 8), wide_res[1]);
+        wide_res[2] = _mm256_fmadd_ps(_mm256_load_ps(v + 16), Format::Load(rhs + 16), wide_res[2]);
+        wide_res[3] = _mm256_fmadd_ps(_mm256_load_ps(v + 24), Format::Load(rhs + 24), wide_res[3]);
+    }
+
+    wide_res[0] = _mm256_add_ps(wide_res[0], wide_res[1]);
+    wide_res[2] = _mm256_add_ps(wide_res[2], wide_res[3]);
+
+    return HorizontalSum(_mm256_add_ps(wide_res[0], wide_res[2]));
+}
+
+template <typename Format>
+static void ExchangeGradients(float* errors, uint16_t* row, const uint32_t v_size,
+                              const float* summand, const float multiple) {
+    errors = YZ_ASSUME_ALIGNED(errors, 32);
+    summand = YZ_ASSUME_ALIGNED(summand, 32);
+    const auto wide_multiple = _mm256_set1_ps(multiple);
+    for (const auto* const errors_end = errors + yzw2v::mem::RoundSizeUpByVecSize(v_size);
+         errors < errors_end; errors += 8, row += 8, summand += 8) {
+        const auto wide_row = Format::Load(row);
+        _mm256_store_ps(errors, _mm256_fmadd_ps(wide_multiple, wide_row, _mm256_load_ps(errors)));
+        Format::Store(row, _mm256_fmadd_ps(wide_multiple, _mm256_load_ps(summand), wide_row));
+    }
+}
+
+static const yzw2v::num::detail::HalfKernels FP16_KERNELS = {
+    Widen<FP16>,
+    Narrow<FP16>,
+    AddToFloat<FP16>,
+    AddFloat<FP16>,
+    ScalarProduct<FP16>,
+    ExchangeGradients<FP16>
+};
+
+static const yzw2v::num::detail::HalfKernels BF16_KERNELS = {
+    Widen<BF16>,
+    Narrow<BF16>,
+    AddToFloat<BF16>,
+    AddFloat<BF16>,
+    ScalarProduct<BF16>,
+    ExchangeGradients<BF16>
+};
+
+/* `pmaddubsw` multiplies unsigned bytes by signed ones, so sign of `lhs` is moved to `rhs`. Values
+ * are in [-127, 127], so sums of pairs of products fit int16 without saturation.
+ */
+static int32_t ScalarProduct(const int8_t* lhs, const uint32_t lhs_size, const int8_t* rhs) {
+    using yzw2v::num::detail::INT8_ROW_ALIGNMENT;
+    const auto* const lhs_end = lhs + (lhs_size + INT8_ROW_ALIGNMENT - 1) / INT8_ROW_ALIGNMENT
+                                      * INT8_ROW_ALIGNMENT;
+    const auto ones = _mm256_set1_epi16(1);
+    auto wide_res0 = _mm256_setzero_si256();
+    auto wide_res1 = _mm256_setzero_si256();
+    for (; lhs < lhs_end; lhs += 64, rhs += 64) {
+        const auto wide_lhs0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(lhs));
+        const auto wide_rhs0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(rhs));
+        const auto wide_lhs1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(lhs + 32));
+        const auto wide_rhs1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(rhs + 32));
+        const auto products0 = _mm256_maddubs_epi16(_mm256_sign_epi8(wide_lhs0, wide_lhs0),
+                                                    _mm256_sign_epi8(wide_rhs0, wide_lhs0));
+        const auto products1 = _mm256_maddubs_epi16(_mm256_sign_epi8(wide_lhs1, wide_lhs1),
+                                                    _mm256_sign_epi8(wide_rhs1, wide_lhs1));
+        wide_res0 = _mm256_add_epi32(wide_res0, _mm256_madd_epi16(products0, ones));
+        wide_res1 = _mm256_add_epi32(wide_res1, _mm256_madd_epi16(products1, ones));
+    }
+
+    const auto wide_res = _mm256_add_epi32(wide_res0, wide_res1);
+    auto half = _mm_add_epi32(_mm256_castsi256_si128(wide_res), _mm256_extracti128_si256(wide_res, 1));
+    half = _mm_hadd_epi32(half, half);
+    half = _mm_hadd_epi32(half, half);
+    return _mm_cvtsi128_si32(half);
+}
+
+const yzw2v::num::detail::Kernels yzw2v::num::detail::AVX2_KERNELS = {
+    "avx2",
+    8,
+    Fill,
+    Zeroize,
+    Prefetch,
+    DivideVector,
+    MultiplyVector,
+    AddVector,
+    AddVector,
+    ScalarProduct,
+    ScalarProducts,
+    AddVectors,
+    ExchangeGradients,
+    &FP16_KERNELS,
+    &BF16_KERNELS,
+    ScalarProduct
+};
@@ -0,0 +1,364 @@
+#include "numeric_kernels.h"
+
+#include "assume_aligned.h"
+#include "mem.h"
+
+#include <immintrin.h>
+
+static void Prefetch(const float* v) {
+    v = YZ_ASSUME_ALIGNED(v, 64);
+    // one prefetch per cache line
+    for (auto i = uint32_t{}; i < 16; ++i) {
+        _mm_prefetch(v + i * 16, _MM_HINT_T0);
+    }
+}
+
+static void Fill(float* v, const uint32_t v_size, const float value) {
+    v = YZ_ASSUME_ALIGNED(v, 64);
+    const auto wide_value = _mm512_set1_ps(value);
+    for (const auto* const v_end = v + yzw2v::mem::RoundSizeUpByVecSize(v_size); v < v_end; v += 16) {
+        _mm512_store_ps(v, wide_value);
+    }
+}
+
+static void Zeroize(float* const v, const uint32_t v_size) {
+    Fill(v, v_size, 0.0f);
+}
+
+static void DivideVector(float* v, const uint32_t v_size, const float divisor) {
+    v = YZ_ASSUME_ALIGNED(v, 64);
+    const auto wide_divisor = _mm512_set1_ps(divisor);
+    for (const auto* const v_end = v + yzw2v::mem::RoundSizeUpByVecSize(v_size); v < v_end; v += 16) {
+        _mm512_store_ps(v, _mm512_div_ps(_mm512_load_ps(v), wide_divisor));
+    }
+}
+
+static void MultiplyVector(float* v, const uint32_t v_size, const float multiple) {
+    v = YZ_ASSUME_ALIGNED(v, 64);
+    const auto wide_multiple = _mm512_set1_ps(multiple);
+    for (const auto* const v_end = v + yzw2v::mem::RoundSizeUpByVecSize(v_size); v < v_end; v += 16) {
+        _mm512_store_ps(v, _mm512_mul_ps(_mm512_load_ps(v), wide_multiple));
+    }
+}
+
+static void AddVector(float* v, const uint32_t v_size, const float* summand) {
+    v = YZ_ASSUME_ALIGNED(v, 64);
+    summand = YZ_ASSUME_ALIGNED(summand, 64);
+    for (const auto* const v_end = v + yzw2v::mem::RoundSizeUpByVecSize(v_size); v < v_end; summand += 16, v += 16) {
+        _mm512_store_ps(v, _mm512_add_ps(_mm512_load_ps(v), _mm512_load_ps(summand)));
+    }
+}
+
+static void AddVector(float* v, const uint32_t v_size,
+                      const float* summand, const float summand_multiple) {
+    v = YZ_ASSUME_ALIGNED(v, 64);
+    summand = YZ_ASSUME_ALIGNED(summand, 64);
+    const auto wide_summand_multiple = _mm512_set1_ps(summand_multiple);
+    for (const auto* const v_end = v + yzw2v::mem::RoundSizeUpByVecSize(v_size); v < v_end; summand += 16, v += 16) {
+        _mm512_store_ps(v, _mm512_fmadd_ps(wide_summand_multiple, _mm512_load_ps(summand),
+                                           _mm512_load_ps(v)));
+    }
+}
+
+static float ScalarProduct(const float* v, const uint32_t v_size,
+                           const float* rhs) {
+    const auto* const v_end_rounded_up = v + yzw2v::mem::RoundSizeUpByVecSize(v_size);
+    v = YZ_ASSUME_ALIGNED(v, 64);
+    rhs = YZ_ASSUME_ALIGNED(rhs, 64);
+
+    // four independent accumulators to hide FMA latency
+    __m512 wide_res[4] = {_mm512_setzero_ps(), _mm512_setzero_ps(),
+                          _mm512_setzero_ps(), _mm512_setzero_ps()};
+    for (const auto* const v_end = v + ((v_end_rounded_up - v) % 64); v < v_end; v += 16, rhs += 16) {
+        wide_res[0] = _mm512_fmadd_ps(_mm512_load_ps(v), _mm512_load_ps(rhs), wide_res[0]);
+    }
+
+    for (; v < v_end_rounded_up; v += 64, rhs += 64) {
+        wide_res[0] = _mm512_fmadd_ps(_mm512_load_ps(v), _mm512_load_ps(rhs), wide_res[0]);
+        wide_res[1] = _mm512_fmadd_ps(_mm512_load_ps(v + 16), _mm512_load_ps(rhs + 16), wide_res[1]);
+        wide_res[2] = _mm512_fmadd_ps(_mm512_load_ps(v + 32), _mm512_load_ps(rhs + 32), wide_res[2]);
+        wide_res[3] = _mm512_fmadd_ps(_mm512_load_ps(v + 48), _mm512_load_ps(rhs + 48), wide_res[3]);
+    }
+
+    wide_res[0] = _mm512_add_ps(wide_res[0], wide_res[1]);
+    wide_res[2] = _mm512_add_ps(wide_res[2], wide_res[3]);
+
+    return _mm512_reduce_add_ps(_mm512_add_ps(wide_res[0], wide_res[2]));
+}
+
+/* Both matrix kernels go over columns in blocks, so the part of every row used by the block stays
+ * in L1 until all rows on the other side are done with it.
+ */
+static constexpr uint32_t COLUMNS_BLOCK_SIZE = 128;  // 512 bytes of each row
+
+static void ScalarProducts(const float* const* lhs, const uint32_t lhs_count,
+                           const float* const* rhs, const uint32_t rhs_count,
+                           const uint32_t v_size, float* res) {
+    const auto v_size_rounded_up = yzw2v::mem::RoundSizeUpByVecSize(v_size);
+    for (auto i = uint32_t{}; i < lhs_count * rhs_count; ++i) {
+        res[i] = 0.0f;
+    }
+
+    for (auto block_begin = uint32_t{}; block_begin < v_size_rounded_up; block_begin += COLUMNS_BLOCK_SIZE) {
+        const auto block_end = block_begin + COLUMNS_BLOCK_SIZE < v_size_rounded_up
+                               ? block_begin + COLUMNS_BLOCK_SIZE
+                               : v_size_rounded_up;
+        for (auto i = uint32_t{}; i < lhs_count; ++i) {
+            const auto* const l = lhs[i];
+            auto* const res_row = res + i * rhs_count;
+
+            // four rows of `rhs` at a time, so every chunk of `l` loaded into register is used
+            // four times
+            auto j = uint32_t{};
+            for (; j + 4 <= rhs_count; j += 4) {
+                const auto* const r0 = rhs[j];
+                const auto* const r1 = rhs[j + 1];
+                const auto* const r2 = rhs[j + 2];
+                const auto* const r3 = rhs[j + 3];
+
+                auto wide_res0 = _mm512_setzero_ps();
+                auto wide_res1 = _mm512_setzero_ps();
+                auto wide_res2 = _mm512_setzero_ps();
+                auto wide_res3 = _mm512_setzero_ps();
+                for (auto k = block_begin; k < block_end; k += 16) {
+                    const auto wide_l = _mm512_load_ps(l + k);
+                    wide_res0 = _mm512_fmadd_ps(wide_l, _mm512_load_ps(r0 + k), wide_res0);
+                    wide_res1 = _mm512_fmadd_ps(wide_l, _mm512_load_ps(r1 + k), wide_res1);
+                    wide_res2 = _mm512_fmadd_ps(wide_l, _mm512_load_ps(r2 + k), wide_res2);
+                    wide_res3 = _mm512_fmadd_ps(wide_l, _mm512_load_ps(r3 + k), wide_res3);
+                }
+
+                res_row[j] += _mm512_reduce_add_ps(wide_res0);
+                res_row[j + 1] += _mm512_reduce_add_ps(wide_res1);
+                res_row[j + 2] += _mm512_reduce_add_ps(wide_res2);
+                res_row[j + 3] += _mm512_reduce_add_ps(wide_res3);
+            }
+
+            for (; j < rhs_count; ++j) {
+                const auto* const r = rhs[j];
+                auto wide_res = _mm512_setzero_ps();
+                for (auto k = block_begin; k < block_end; k += 16) {
+                    wide_res = _mm512_fmadd_ps(_mm512_load_ps(l + k), _mm512_load_ps(r + k), wide_res);
+                }
+
+                res_row[j] += _mm512_reduce_add_ps(wide_res);
+            }
+        }
+    }
+}
+
+static void AddVectors(float* const* v, const uint32_t v_count,
+                       const float* const* summands, const uint32_t summands_count,
+                       const uint32_t v_size, const float* summands_multiples) {
+    const auto v_size_rounded_up = yzw2v::mem::RoundSizeUpByVecSize(v_size);
+    for (auto block_begin = uint32_t{}; block_begin < v_size_rounded_up; block_begin += COLUMNS_BLOCK_SIZE) {
+        const auto block_end = block_begin + COLUMNS_BLOCK_SIZE < v_size_rounded_up
+                               ? block_begin + COLUMNS_BLOCK_SIZE
+                               : v_size_rounded_up;
+        for (auto i = uint32_t{}; i < v_count; ++i) {
+            auto* const row = v[i];
+            const auto* const multiples = summands_multiples + i * summands_count;
+
+            // each chunk of `row` is loaded and stored only once
+            for (auto k = block_begin; k < block_end; k += 16) {
+                auto wide_row = _mm512_load_ps(row + k);
+                for (auto j = uint32_t{}; j < summands_count; ++j) {
+                    wide_row = _mm512_fmadd_ps(_mm512_set1_ps(multiples[j]),
+                                               _mm512_load_ps(summands[j] + k), wide_row);
+                }
+
+                _mm512_store_ps(row + k, wide_row);
+            }
+        }
+    }
+}
+
+static void ExchangeGradients(float* errors, float* row, const uint32_t v_size,
+                              const float* summand, const float multiple) {
+    errors = YZ_ASSUME_ALIGNED(errors, 64);
+    row = YZ_ASSUME_ALIGNED(row, 64);
+    summand = YZ_ASSUME_ALIGNED(summand, 64);
+    const auto wide_multiple = _mm512_set1_ps(multiple);
+    for (const auto* const row_end = row + yzw2v::mem::RoundSizeUpByVecSize(v_size); row < row_end;
+         errors += 16, row += 16, summand += 16) {
+        const auto wide_row = _mm512_load_ps(row);
+        _mm512_store_ps(errors, _mm512_fmadd_ps(wide_multiple, wide_row, _mm512_load_ps(errors)));
+        _mm512_store_ps(row, _mm512_fmadd_ps(wide_multiple, _mm512_load_ps(summand), wide_row));
+    }
+}
+
+/* Half precision rows: 16 values (32 bytes, rows are padded to `VEC_SIZE` values) are converted
+ * to or from one register, FP16 by AVX-512F conversions, BF16 by shifts with rounding to nearest
+ * even done by hand.
+ */
+namespace {
+    struct FP16 {
+        static __m512 Load(const uint16_t* const v) {
+            return _mm512_cvtph_ps(_mm256_load_si256(reinterpret_cast<const __m256i*>(v)));
+        }
+
+        static void Store(uint16_t* const v, const __m512 value) {
+            _mm256_store_si256(reinterpret_cast<__m256i*>(v),
+                               _mm512_cvtps_ph(value, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC));
+        }
+    };
+
+    struct BF16 {
+        static __m512 Load(const uint16_t* const v) {
+            const auto wide = _mm512_cvtepu16_epi32(_mm256_load_si256(reinterpret_cast<const __m256i*>(v)));
+            return _mm512_castsi512_ps(_mm512_slli_epi32(wide, 16));
+        }
+
+        static void Store(uint16_t* const v, const __m512 value) {
+            const auto bits = _mm512_castps_si512(value);
+            const auto lsb = _mm512_and_si512(_mm512_srli_epi32(bits, 16), _mm512_set1_epi32(1));
+            const auto rounded = _mm512_add_epi32(bits, _mm512_add_epi32(_mm512_set1_epi32(0x7FFF), lsb));
+            const auto is_nan = _mm512_cmp_ps_mask(value, value, _CMP_UNORD_Q);
+            const auto res = _mm512_mask_or_epi32(rounded, is_nan, bits, _mm512_set1_epi32(0x400000));
+            _mm256_store_si256(reinterpret_cast<__m256i*>(v),
+                               _mm512_cvtepi32_epi16(_mm512_srli_epi32(res, 16)));
+        }
+    };
+}
+
+template <typename Format>
+static void Widen(const uint16_t* v, const uint32_t v_size, float* res) {
+    res = YZ_ASSUME_ALIGNED(res, 64);
+    for (const auto* const res_end = res + yzw2v::mem::RoundSizeUpByVecSize(v_size); res < res_end;
+         v += 16, res += 16) {
+        _mm512_store_ps(res, Format::Load(v));
+    }
+}
+
+template <typename Format>
+static void Narrow(const float* v, const uint32_t v_size, uint16_t* res) {
+    v = YZ_ASSUME_ALIGNED(v, 64);
+    for (const auto* const v_end = v + yzw2v::mem::RoundSizeUpByVecSize(v_size); v < v_end;
+         v += 16, res += 16) {
+        Format::Store(res, _mm512_load_ps(v));
+    }
+}
+
+template <typename Format>
+static void AddToFloat(float* v, const uint32_t v_size, const uint16_t* summand) {
+    v = YZ_ASSUME_ALIGNED(v, 64);
+    for (const auto* const v_end = v + yzw2v::mem::RoundSizeUpByVecSize(v_size); v < v_end;
+         summand += 16, v += 16) {
+        _mm512_store_ps(v, _mm512_add_ps(_mm512_load_ps(v), Format::Load(summand)));
+    }
+}
+
+template <typename Format>
+static void AddFloat(uint16_t* v, const uint32_t v_size, const float* summand) {
+    summand = YZ_ASSUME_ALIGNED(summand, 64);
+    for (const auto* const v_end = v + yzw2v::mem::RoundSizeUpByVecSize(v_size); v < v_end;
+         summand += 16, v += 16) {
+        Format::Store(v, _mm512_add_ps(Format::Load(v), _mm512_load_ps(summand)));
+    }
+}
+
+template <typename Format>
+static float ScalarProduct(const float* v, const uint32_t v_size, const uint16_t* rhs) {
+    const auto* const v_end_rounded_up = v + yzw2v::mem::RoundSizeUpByVecSize(v_size);
+    v = YZ_ASSUME_ALIGNED(v, 64);
+
+    __m512 wide_res[4] = {_mm512_setzero_ps(), _mm512_setzero_ps(),
+                          _mm512_setzero_ps(), _mm512_setzero_ps()};
+    for (const auto* const v_end = v + ((v_end_rounded_up - v) % 64); v < v_end; v += 16, rhs += 16) {
+        wide_res[0] = _mm512_fmadd_ps(_mm512_load_ps(v), Format::Load(rhs), wide_res[0]);
+    }
+
+    for (; v < v_end_rounded_up; v += 64, rhs += 64) {
+        wide_res[0] = _mm512_fmadd_ps(_mm512_load_ps(v), Format::Load(rhs), wide_res[0]);
+        wide_res[1] = _mm512_fmadd_ps(_mm512_load_ps(v + 16), Format::Load(rhs + 16), wide_res[1]);
+        wide_res[2] = _mm512_fmadd_ps(_mm512_load_ps(v + 32), Format::Load(rhs + 32), wide_res[2]);
+        wide_res[3] = _mm512_fmadd_ps(_mm512_load_ps(v + 48), Format::Load(rhs + 48), wide_res[3]);
+    }
+
+    wide_res[0] = _mm512_add_ps(wide_res[0], wide_res[1]);
+    wide_res[2] = _mm512_add_ps(wide_res[2], wide_res[3]);
+
+    return _mm512_reduce_add_ps(_mm512_add_ps(wide_res[0], wide_res[2]));
+}
+
+template <typename Format>
+static void ExchangeGradients(float* errors, uint16_t* row, const uint32_t v_size,
+                              const float* summand, const float multiple) {
+    errors = YZ_ASSUME_ALIGNED(errors, 64);
+    summand = YZ_ASSUME_ALIGNED(summand, 64);
+    const auto wide_multiple = _mm512_set1_ps(multiple);
+    for (const auto* const errors_end = errors + yzw2v::mem::RoundSizeUpByVecSize(v_size);
+         errors < errors_end; errors += 16, row += 16, summand += 16) {
+        const auto wide_row = Format::Load(row);
+        _mm512_store_ps(errors, _mm512_fmadd_ps(wide_multiple, wide_row, _mm512_load_ps(errors)));
+        Format::Store(row, _mm512_fmadd_ps(wide_multiple, _mm512_load_ps(summand), wide_row));
+    }
+}
+
+static const yzw2v::num::detail::HalfKernels FP16_KERNELS = {
+    Widen<FP16>,
+    Narrow<FP16>,
+    AddToFloat<FP16>,
+    AddFloat<FP16>,
+    ScalarProduct<FP16>,
+    ExchangeGradients<FP16>
+};
+
+static const yzw2v::num::detail::HalfKernels BF16_KERNELS = {
+    Widen<BF16>,
+    Narrow<BF16>,
+    AddToFloat<BF16>,
+    AddFloat<BF16>,
+    ScalarProduct<BF16>,
+    ExchangeGradients<BF16>
+};
+
+/* AVX-512F has no byte instructions (they are in AVX-512BW, dot products in AVX-512 VNNI), so this
+ * is the AVX2 kernel: `pmaddubsw` multiplies unsigned bytes by signed ones, sign of `lhs` is moved
+ * to `rhs`, values in [-127, 127] keep sums of pairs of products within int16.
+ */
+static int32_t ScalarProduct(const int8_t* lhs, const uint32_t lhs_size, const int8_t* rhs) {
+    using yzw2v::num::detail::INT8_ROW_ALIGNMENT;
+    const auto* const lhs_end = lhs + (lhs_size + INT8_ROW_ALIGNMENT - 1) / INT8_ROW_ALIGNMENT
+                                      * INT8_ROW_ALIGNMENT;
+    const auto ones = _mm256_set1_epi16(1);
+    auto wide_res0 = _mm256_setzero_si256();
+    auto wide_res1 = _mm256_setzero_si256();
+    for (; lhs < lhs_end; lhs += 64, rhs += 64) {
+        const auto wide_lhs0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(lhs));
+        const auto wide_rhs0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(rhs));
+        const auto wide_lhs1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(lhs + 32));
+        const auto wide_rhs1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(rhs + 32));
+        const auto products0 = _mm256_maddubs_epi16(_mm256_sign_epi8(wide_lhs0, wide_lhs0),
+                                                    _mm256_sign_epi8(wide_rhs0, wide_lhs0));
+        const auto products1 = _mm256_maddubs_epi16(_mm256_sign_epi8(wide_lhs1, wide_lhs1),
+                                                    _mm256_sign_epi8(wide_rhs1, wide_lhs1));
+        wide_res0 = _mm256_add_epi32(wide_res0, _mm256_madd_epi16(products0, ones));
+        wide_res1 = _mm256_add_epi32(wide_res1, _mm256_madd_epi16(products1, ones));
+    }
+
+    const auto wide_res = _mm256_add_epi32(wide_res0, wide_res1);
+    auto half = _mm_add_epi32(_mm256_castsi256_si128(wide_res), _mm256_extracti128_si256(wide_res, 1));
+    half = _mm_hadd_epi32(half, half);
+    half = _mm_hadd_epi32(half, half);
+    return _mm_cvtsi128_si32(half);
+}
+
+const yzw2v::num::detail::Kernels yzw2v::num::detail::AVX512_KERNELS = {
+    "avx512",
+    16,
+    Fill,
+    Zeroize,
+    Prefetch,
+    DivideVector,
+    MultiplyVector,
+    AddVector,
+    AddVector,
+    ScalarProduct,
+    ScalarProducts,
+    AddVectors,
+    ExchangeGradients,
+    &FP16_KERNELS,
+    &BF16_KERNELS,
+    ScalarProduct
+};
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cinttypes>
+
+/* Every `numeric_<instruction set>.cpp` is compiled with its own target flags and exports table of
+ * its kernels, `numeric.cpp` selects one of the tables at runtime. Implementations must not use
+ * inline functions from headers (e.g. from STL), otherwise linker may pick their instance compiled
+ * for a wider instruction set for the whole program.
+ */
+
+namespace yzw2v {
+    namespace num {
+        namespace detail {
+            // `num::INT8_ROW_ALIGNMENT`, public header is not included here, since names of its
+            // functions would hide names of kernels in initializers of the tables
+            static constexpr uint32_t INT8_ROW_ALIGNMENT = 64;
+
+            // Rows stored as 16-bit floats of one format, all arithmetic is done in float.
+            struct HalfKernels {
+                void (*widen)(const uint16_t* v, const uint32_t v_size, float* res);
+                void (*narrow)(const float* v, const uint32_t v_size, uint16_t* res);
+                // v += summand
+                void (*add_to_float)(float* v, const uint32_t v_size, const uint16_t* summand);
+                void (*add_float)(uint16_t* v, const uint32_t v_size, const float* summand);
+                float (*scalar_product)(const float* lhs, const uint32_t lhs_size,
+                                        const uint16_t* rhs);
+                void (*exchange_gradients)(float* errors, uint16_t* row, const uint32_t v_size,
+                                           const float* summand, const float multiple);
+            };
+
+            struct Kernels {
+                const char* name;
+                uint32_t vec_size;  // floats per SIMD register, rows must be padded to it
+
+                void (*fill)(float* v, const uint32_t v_size, const float value);
+                void (*zeroize)(float* v, const uint32_t v_size);
+                void (*prefetch)(const float* v);
+                void (*divide_vector)(float* v, const uint32_t v_size, const float divisor);
+                void (*multiply_vector)(float* v, const uint32_t v_size, const float multiple);
+                void (*add_vector)(float* v, const uint32_t v_size, const float* summand);
+                void (*add_vector_with_multiple)(float* v, const uint32_t v_size,
+                                                 const float* summand,
+                                                 const float summand_multiple);
+                float (*scalar_product)(const float* lhs, const uint32_t lhs_size,
+                                        const float* rhs);
+                void (*scalar_products)(const float* const* lhs, const uint32_t lhs_count,
+                                        const float* const* rhs, const uint32_t rhs_count,
+                                        const uint32_t v_size, float* res);
+                void (*add_vectors)(float* const* v, const uint32_t v_count,
+                                    const float* const* summands, const uint32_t summands_count,
+                                    const uint32_t v_size, const float* summands_multiples);
+                // errors += multiple * row, row += multiple * summand
+                void (*exchange_gradients)(float* errors, float* row, const uint32_t v_size,
+                                           const float* summand, const float multiple);
+
+                // pointers, so variants without conversion instructions can share portable ones
+                const HalfKernels* fp16;
+                const HalfKernels* bf16;
+
+                // values are in [-127, 127], rows are padded by zeros to `INT8_ROW_ALIGNMENT`
+                int32_t (*int8_scalar_product)(const int8_t* lhs, const uint32_t lhs_size,
+                                               const int8_t* rhs);
+            };
+
+            extern const Kernels SIMPLE_KERNELS;
+            extern const HalfKernels SIMPLE_FP16_KERNELS;
+            extern const HalfKernels SIMPLE_BF16_KERNELS;
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define YZ_NUM_X86_KERNELS
+            extern const Kernels SSE_KERNELS;
+            extern const Kernels AVX_KERNELS;
+            extern const Kernels AVX2_KERNELS;  // AVX2 + FMA + F16C
+            extern const Kernels AVX512_KERNELS;  // AVX-512F
+#endif
+        }
+    }
+}
@@ -1,47 +1,49 @@
-#include "numeric.h"
+#include "numeric_kernels.h"
 
-void yzw2v::num::Prefetch(const float* v) noexcept {
+#include <cstring>
+
+static void Prefetch(const float* v) {
     (void)v;
 }
 
-void yzw2v::num::Fill(float* v, const uint32_t v_size, const float value) noexcept {
+static void Fill(float* v, const uint32_t v_size, const float value) {
     for (auto i = uint32_t{}; i < v_size; ++i) {
         v[i] = value;
     }
 }
 
-void yzw2v::num::Zeroize(float* v, const uint32_t v_size) noexcept {
+static void Zeroize(float* v, const uint32_t v_size) {
     Fill(v, v_size, 0.0f);
 }
 
-void yzw2v::num::DivideVector(float* v, const uint32_t v_size, const float divisor) noexcept {
+static void DivideVector(float* v, const uint32_t v_size, const float divisor) {
     for (auto i = uint32_t{}; i < v_size; ++i) {
         v[i] /= divisor;
     }
 }
 
-void yzw2v::num::MultiplyVector(float* v, const uint32_t v_size, const float multiple) noexcept {
+static void MultiplyVector(float* v, const uint32_t v_size, const float multiple) {
     for (auto i = uint32_t{}; i < v_size; ++i) {
         v[i] *= multiple;
     }
 }
 
-void yzw2v::num::AddVector(float* v, const uint32_t v_size,
-                           const float* const summand) noexcept {
+static void AddVector(float* v, const uint32_t v_size,
+                      const float* const summand) {
     for (auto i = uint32_t{}; i < v_size; ++i) {
         v[i] += summand[i];
     }
 }
 
-void yzw2v::num::AddVector(float* v, const uint32_t v_size,
-                           const float* const summand, const float summand_multiple) noexcept {
+static void AddVector(float* v, const uint32_t v_size,
+                      const float* const summand, const float summand_multiple) {
     for (auto i = uint32_t{}; i < v_size; ++i) {
         v[i] += summand_multiple * summand[i];
     }
 }
 
-float yzw2v::num::ScalarProduct(const float* lhs, const uint32_t lhs_size,
-                                const float* rhs) noexcept {
+static float ScalarProduct(const float* lhs, const uint32_t lhs_size,
+                           const float* rhs) {
     auto res = float{};
     for (auto i = uint32_t{}; i < lhs_size; ++i) {
         res += lhs[i] * rhs[i];
@@ -49,3 +51,207 @@ float yzw2v::num::ScalarProduct(const float* lhs, const uint32_t lhs_size,
 
     return res;
 }
+
+static void ScalarProducts(const float* const* lhs, const uint32_t lhs_count,
+                           const float* const* rhs, const uint32_t rhs_count,
+                           const uint32_t v_size, float* res) {
+    for (auto i = uint32_t{}; i < lhs_count; ++i) {
+        for (auto j = uint32_t{}; j < rhs_count; ++j) {
+            res[i * rhs_count + j] = ScalarProduct(lhs[i], v_size, rhs[j]);
+        }
+    }
+}
+
+static void AddVectors(float* const* v, const uint32_t v_count,
+                       const float* const* summands, const uint32_t summands_count,
+                       const uint32_t v_size, const float* summands_multiples) {
+    for (auto i = uint32_t{}; i < v_count; ++i) {
+        const auto* const multiples = summands_multiples + i * summands_count;
+        for (auto k = uint32_t{}; k < v_size; ++k) {
+            auto value = v[i][k];
+            for (auto j = uint32_t{}; j < summands_count; ++j) {
+                value += multiples[j] * summands[j][k];
+            }
+
+            v[i][k] = value;
+        }
+    }
+}
+
+static void ExchangeGradients(float* const errors, float* const row, const uint32_t v_size,
+                              const float* const summand, const float multiple) {
+    for (auto i = uint32_t{}; i < v_size; ++i) {
+        errors[i] += multiple * row[i];
+        row[i] += multiple * summand[i];
+    }
+}
+
+static float FromBits(const uint32_t bits) {
+    auto res = float{};
+    std::memcpy(&res, &bits, sizeof(res));
+    return res;
+}
+
+static uint32_t ToBits(const float value) {
+    auto res = uint32_t{};
+    std::memcpy(&res, &value, sizeof(res));
+    return res;
+}
+
+/* Portable conversions, both round to nearest even and keep infinities and NaNs. FP16 ones handle
+ * subnormals with a float addition, which rounds the mantissa for us.
+ */
+namespace {
+    struct FP16 {
+        static float Load(const uint16_t value) {
+            static constexpr uint32_t SHIFTED_EXP = 0x7C00u << 13;
+            auto bits = static_cast<uint32_t>(value & 0x7FFFu) << 13;
+            const auto exp = bits & SHIFTED_EXP;
+            bits += (127u - 15u) << 23;
+            if (SHIFTED_EXP == exp) {
+                bits += (128u - 16u) << 23;  // infinity or NaN
+            } else if (!exp) {
+                bits += 1u << 23;  // zero or subnormal
+                bits = ToBits(FromBits(bits) - FromBits(113u << 23));
+            }
+
+            return FromBits(bits | static_cast<uint32_t>(value & 0x8000u) << 16);
+        }
+
+        static uint16_t Store(const float value) {
+            static constexpr uint32_t INFINITY_BITS = 255u << 23;
+            static constexpr uint32_t OVERFLOW_BITS = (127u + 16u) << 23;  // 65536
+            static constexpr uint32_t MIN_NORMAL_BITS = 113u << 23;        // 2^-14
+            static constexpr uint32_t SUBNORMAL_MAGIC_BITS = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+
+            auto bits = ToBits(value);
+            const auto sign = static_cast<uint16_t>((bits >> 16) & 0x8000u);
+            bits &= 0x7FFFFFFFu;
+
+            auto res = uint16_t{};
+            if (bits >= OVERFLOW_BITS) {
+                res = bits > INFINITY_BITS ? 0x7E00u : 0x7C00u;
+            } else if (bits < MIN_NORMAL_BITS) {
+                res = static_cast<uint16_t>(
+                    ToBits(FromBits(bits) + FromBits(SUBNORMAL_MAGIC_BITS)) - SUBNORMAL_MAGIC_BITS);
+            } else {
+                const auto mantissa_odd = (bits >> 13) & 1u;
+                bits += ((15u - 127u) << 23) + 0xFFFu + mantissa_odd;
+                res = static_cast<uint16_t>(bits >> 13);
+            }
+
+            return res | sign;
+        }
+    };
+
+    struct BF16 {
+        static float Load(const uint16_t value) {
+            return FromBits(static_cast<uint32_t>(value) << 16);
+        }
+
+        static uint16_t Store(const float value) {
+            const auto bits = ToBits(value);
+            if ((bits & 0x7FFFFFFFu) > 0x7F800000u) {
+                return static_cast<uint16_t>((bits >> 16) | 0x40u);  // quiet NaN
+            }
+
+            return static_cast<uint16_t>((bits + 0x7FFFu + ((bits >> 16) & 1u)) >> 16);
+        }
+    };
+}
+
+template <typename Format>
+static void Widen(const uint16_t* const v, const uint32_t v_size, float* const res) {
+    for (auto i = uint32_t{}; i < v_size; ++i) {
+        res[i] = Format::Load(v[i]);
+    }
+}
+
+template <typename Format>
+static void Narrow(const float* const v, const uint32_t v_size, uint16_t* const res) {
+    for (auto i = uint32_t{}; i < v_size; ++i) {
+        res[i] = Format::Store(v[i]);
+    }
+}
+
+template <typename Format>
+static void AddToFloat(float* const v, const uint32_t v_size, const uint16_t* const summand) {
+    for (auto i = uint32_t{}; i < v_size; ++i) {
+        v[i] += Format::Load(summand[i]);
+    }
+}
+
+template <typename Format>
+static void AddFloat(uint16_t* const v, const uint32_t v_size, const float* const summand) {
+    for (auto i = uint32_t{}; i < v_size; ++i) {
+        v[i] = Format::Store(Format::Load(v[i]) + summand[i]);
+    }
+}
+
+template <typename Format>
+static float ScalarProduct(const float* const lhs, const uint32_t lhs_size,
+                           const uint16_t* const rhs) {
+    auto res = float{};
+    for (auto i = uint32_t{}; i < lhs_size; ++i) {
+        res += lhs[i] * Format::Load(rhs[i]);
+    }
+
+    return res;
+}
+
+template <typename Format>
+static void ExchangeGradients(float* const errors, uint16_t* const row, const uint32_t v_size,
+                              const float* const summand, const float multiple) {
+    for (auto i = uint32_t{}; i < v_size; ++i) {
+        const auto value = Format::Load(row[i]);
+        errors[i] += multiple * value;
+        row[i] = Format::Store(value + multiple * summand[i]);
+    }
+}
+
+const yzw2v::num::detail::HalfKernels yzw2v::num::detail::SIMPLE_FP16_KERNELS = {
+    Widen<FP16>,
+    Narrow<FP16>,
+    AddToFloat<FP16>,
+    AddFloat<FP16>,
+    ScalarProduct<FP16>,
+    ExchangeGradients<FP16>
+};
+
+const yzw2v::num::detail::HalfKernels yzw2v::num::detail::SIMPLE_BF16_KERNELS = {
+    Widen<BF16>,
+    Narrow<BF16>,
+    AddToFloat<BF16>,
+    AddFloat<BF16>,
+    ScalarProduct<BF16>,
+    ExchangeGradients<BF16>
+};
+
+static int32_t ScalarProduct(const int8_t* const lhs, const uint32_t lhs_size,
+                             const int8_t* const rhs) {
+    auto res = int32_t{};
+    for (auto i = uint32_t{}; i < lhs_size; ++i) {
+        res += int32_t{lhs[i]} * rhs[i];
+    }
+
+    return res;
+}
+
+const yzw2v::num::detail::Kernels yzw2v::num::detail::SIMPLE_KERNELS = {
+    "simple",
+    1,
+    Fill,
+    Zeroize,
+    Prefetch,
+    DivideVector,
+    MultiplyVector,
+    AddVector,
+    AddVector,
+    ScalarProduct,
+    ScalarProducts,
+    AddVectors,
+    ExchangeGradients,
+    &SIMPLE_FP16_KERNELS,
+    &SIMPLE_BF16_KERNELS,
+    ScalarProduct
+};
@@ -1,4 +1,4 @@
-#include "numeric.h"
+#include "numeric_kernels.h"
 
 #include "assume.h"
 #include "assume_aligned.h"
@@ -6,58 +6,58 @@
 
 #include <smmintrin.h>
 
-void yzw2v::num::Prefetch(const float* v) noexcept {
-    v = YZ_ASSUME_ALIGNED(v, 128);
+static void Prefetch(const float* v) {
+    v = YZ_ASSUME_ALIGNED(v, 16);
     for (auto i = uint32_t{}; i < 4 * 4; ++i) {
         _mm_prefetch(v + i * 4, _MM_HINT_T0);
     }
 }
 
-void yzw2v::num::Fill(float* v, const uint32_t v_size, const float value) noexcept {
-    const auto v_size_rounded_up = mem::RoundSizeUpByVecSize(v_size);
-    v = YZ_ASSUME_ALIGNED(v, 128);
+static void Fill(float* v, const uint32_t v_size, const float value) {
+    const auto v_size_rounded_up = yzw2v::mem::RoundSizeUpByVecSize(v_size);
+    v = YZ_ASSUME_ALIGNED(v, 16);
     const auto wide_value = _mm_set1_ps(value);
     for (const auto* const v_end = v + v_size_rounded_up; v < v_end; v += 4) {
         _mm_store_ps(v, wide_value);
     }
 }
 
-void yzw2v::num::Zeroize(float* const v, const uint32_t v_size) noexcept {
+static void Zeroize(float* const v, const uint32_t v_size) {
     Fill(v, v_size, 0.0f);
 }
 
-void yzw2v::num::DivideVector(float* v, const uint32_t v_size, const float divisor) noexcept {
-    const auto v_size_rounded_up = mem::RoundSizeUpByVecSize(v_size);
-    v = YZ_ASSUME_ALIGNED(v, 128);
+static void DivideVector(float* v, const uint32_t v_size, const float divisor) {
+    const auto v_size_rounded_up = yzw2v::mem::RoundSizeUpByVecSize(v_size);
+    v = YZ_ASSUME_ALIGNED(v, 16);
     const auto wide_divisor = _mm_set1_ps(divisor);
     for (const auto* const v_end = v + v_size_rounded_up; v < v_end; v += 4) {
         _mm_store_ps(v, _mm_div_ps(_mm_load_ps(v), wide_divisor));
     }
 }
 
-void yzw2v::num::MultiplyVector(float* v, const uint32_t v_size, const float multiple) noexcept {
-    const auto v_size_rounded_up = mem::RoundSizeUpByVecSize(v_size);
-    v = YZ_ASSUME_ALIGNED(v, 128);
+static void MultiplyVector(float* v, const uint32_t v_size, const float multiple) {
+    const auto v_size_rounded_up = yzw2v::mem::RoundSizeUpByVecSize(v_size);
+    v = YZ_ASSUME_ALIGNED(v, 16);
     const auto wide_multiple = _mm_set1_ps(multiple);
     for (const auto* const v_end = v + v_size_rounded_up; v < v_end; v += 4) {
         _mm_store_ps(v, _mm_mul_ps(_mm_load_ps(v), wide_multiple));
     }
 }
 
-void yzw2v::num::AddVector(float* v, const uint32_t v_size, const float* summand) noexcept {
-    const auto v_size_rounded_up = mem::RoundSizeUpByVecSize(v_size);
-    v = YZ_ASSUME_ALIGNED(v, 128);
-    summand = YZ_ASSUME_ALIGNED(summand, 128);
+static void AddVector(float* v, const uint32_t v_size, const float* summand) {
+    const auto v_size_rounded_up = yzw2v::mem::RoundSizeUpByVecSize(v_size);
+    v = YZ_ASSUME_ALIGNED(v, 16);
+    summand = YZ_ASSUME_ALIGNED(summand, 16);
     for (const auto* const v_end = v + v_size_rounded_up; v < v_end; summand += 4, v += 4) {
         _mm_store_ps(v, _mm_add_ps(_mm_load_ps(v), _mm_load_ps(summand)));
     }
 }
 
-void yzw2v::num::AddVector(float* v, const uint32_t v_size,
-                           const float* summand, const float summand_multiple) noexcept {
-    const auto v_size_rounded_up = mem::RoundSizeUpByVecSize(v_size);
-    v = YZ_ASSUME_ALIGNED(v, 128);
-    summand = YZ_ASSUME_ALIGNED(summand, 128);
+static void AddVector(float* v, const uint32_t v_size,
+                      const float* summand, const float summand_multiple) {
+    const auto v_size_rounded_up = yzw2v::mem::RoundSizeUpByVecSize(v_size);
+    v = YZ_ASSUME_ALIGNED(v, 16);
+    summand = YZ_ASSUME_ALIGNED(summand, 16);
     const auto wide_summand_multiple = _mm_set1_ps(summand_multiple);
     for (const auto* const v_end = v + v_size_rounded_up; v < v_end; summand += 4, v += 4) {
         _mm_store_ps(v, _mm_add_ps(_mm_load_ps(v),
@@ -67,11 +67,11 @@ void yzw2v::num::AddVector(float* v, const uint32_t v_size,
     }
 }
 
-float yzw2v::num::ScalarProduct(const float* v, const uint32_t v_size,
-                                const float* rhs) noexcept {
-    const auto* const v_end_rounded_up = v + mem::RoundSizeUpByVecSize(v_size);
-    v = YZ_ASSUME_ALIGNED(v, 128);
-    rhs = YZ_ASSUME_ALIGNED(rhs, 128);
+static float ScalarProduct(const float* v, const uint32_t v_size,
+                           const float* rhs) {
+    const auto* const v_end_rounded_up = v + yzw2v::mem::RoundSizeUpByVecSize(v_size);
+    v = YZ_ASSUME_ALIGNED(v, 16);
+    rhs = YZ_ASSUME_ALIGNED(rhs, 16);
 
     __m128 wide_res[4] = {};
     for (const auto* const v_end = v + ((v_end_rounded_up - v) % 16); v < v_end; v += 4, rhs += 4) {
@@ -94,11 +94,11 @@ float yzw2v::num::ScalarProduct(const float* v, const uint32_t v_size,
 }
 
 #if 0
-float yzw2v::num::ScalarProduct(const float* v, const uint32_t v_size,
-                                const float* rhs) noexcept {
-    const auto* const v_end_rounded_up = v + mem::RoundSizeUpByVecSize(v_size);
-    v = YZ_ASSUME_ALIGNED(v, 128);
-    rhs = YZ_ASSUME_ALIGNED(rhs, 128);
+static float ScalarProduct(const float* v, const uint32_t v_size,
+                           const float* rhs) {
+    const auto* const v_end_rounded_up = v + yzw2v::mem::RoundSizeUpByVecSize(v_size);
+    v = YZ_ASSUME_ALIGNED(v, 16);
+    rhs = YZ_ASSUME_ALIGNED(rhs, 16);
 
     auto sum = _mm_setzero_ps();
     for (const auto* const v_end = v + ((v_end_rounded_up - v) % 16); v < v_end; v += 4, rhs += 4) {
@@ -116,3 +116,144 @@ float yzw2v::num::ScalarProduct(const float* v, const uint32_t v_size,
     return sum[0] + sum[1] + sum[2] + sum[3];
 }
 #endif
+
+/* Both matrix kernels go over columns in blocks, so the part of every row used by the block stays
+ * in L1 until all rows on the other side are done with it.
+ */
+static constexpr uint32_t COLUMNS_BLOCK_SIZE = 128;  // 512 bytes of each row
+
+static void ScalarProducts(const float* const* lhs, const uint32_t lhs_count,
+                           const float* const* rhs, const uint32_t rhs_count,
+                           const uint32_t v_size, float* res) {
+    const auto v_size_rounded_up = yzw2v::mem::RoundSizeUpByVecSize(v_size);
+    for (auto i = uint32_t{}; i < lhs_count * rhs_count; ++i) {
+        res[i] = 0.0f;
+    }
+
+    for (auto block_begin = uint32_t{}; block_begin < v_size_rounded_up; block_begin += COLUMNS_BLOCK_SIZE) {
+        const auto block_end = block_begin + COLUMNS_BLOCK_SIZE < v_size_rounded_up
+                               ? block_begin + COLUMNS_BLOCK_SIZE
+                               : v_size_rounded_up;
+        for (auto i = uint32_t{}; i < lhs_count; ++i) {
+            const auto* const l = lhs[i];
+            auto* const res_row = res + i * rhs_count;
+
+            // four rows of `rhs` at a time, so every chunk of `l` loaded into register is used
+            // four times
+            auto j = uint32_t{};
+            for (; j + 4 <= rhs_count; j += 4) {
+                const auto* const r0 = rhs[j];
+                const auto* const r1 = rhs[j + 1];
+                const auto* const r2 = rhs[j + 2];
+                const auto* const r3 = rhs[j + 3];
+
+                __m128 wide_res[4] = {};
+                for (auto k = block_begin; k < block_end; k += 4) {
+                    const auto wide_l = _mm_load_ps(l + k);
+                    wide_res[0] = _mm_add_ps(wide_res[0], _mm_mul_ps(wide_l, _mm_load_ps(r0 + k)));
+                    wide_res[1] = _mm_add_ps(wide_res[1], _mm_mul_ps(wide_l, _mm_load_ps(r1 + k)));
+                    wide_res[2] = _mm_add_ps(wide_res[2], _mm_mul_ps(wide_l, _mm_load_ps(r2 + k)));
+                    wide_res[3] = _mm_add_ps(wide_res[3], _mm_mul_ps(wide_l, _mm_load_ps(r3 + k)));
+                }
+
+                for (auto jj = uint32_t{}; jj < 4; ++jj) {
+                    res_row[j + jj] += wide_res[jj][0] + wide_res[jj][1]
+                                       + wide_res[jj][2] + wide_res[jj][3];
+                }
+            }
+
+            for (; j < rhs_count; ++j) {
+                const auto* const r = rhs[j];
+                auto wide_res = _mm_setzero_ps();
+                for (auto k = block_begin; k < block_end; k += 4) {
+                    wide_res = _mm_add_ps(wide_res, _mm_mul_ps(_mm_load_ps(l + k), _mm_load_ps(r + k)));
+                }
+
+                res_row[j] += wide_res[0] + wide_res[1] + wide_res[2] + wide_res[3];
+            }
+        }
+    }
+}
+
+static void AddVectors(float* const* v, const uint32_t v_count,
+                       const float* const* summands, const uint32_t summands_count,
+                       const uint32_t v_size, const float* summands_multiples) {
+    const auto v_size_rounded_up = yzw2v::mem::RoundSizeUpByVecSize(v_size);
+    for (auto block_begin = uint32_t{}; block_begin < v_size_rounded_up; block_begin += COLUMNS_BLOCK_SIZE) {
+        const auto block_end = block_begin + COLUMNS_BLOCK_SIZE < v_size_rounded_up
+                               ? block_begin + COLUMNS_BLOCK_SIZE
+                               : v_size_rounded_up;
+        for (auto i = uint32_t{}; i < v_count; ++i) {
+            auto* const row = v[i];
+            const auto* const multiples = summands_multiples + i * summands_count;
+
+            // each chunk of `row` is loaded and stored only once
+            for (auto k = block_begin; k < block_end; k += 4) {
+                auto wide_row = _mm_load_ps(row + k);
+                for (auto j = uint32_t{}; j < summands_count; ++j) {
+                    wide_row = _mm_add_ps(wide_row,
+                                          _mm_mul_ps(_mm_set1_ps(multiples[j]),
+                                                     _mm_load_ps(summands[j] + k)));
+                }
+
+                _mm_store_ps(row + k, wide_row);
+            }
+        }
+    }
+}
+
+static void ExchangeGradients(float* errors, float* row, const uint32_t v_size,
+                              const float* summand, const float multiple) {
+    const auto v_size_rounded_up = yzw2v::mem::RoundSizeUpByVecSize(v_size);
+    errors = YZ_ASSUME_ALIGNED(errors, 16);
+    row = YZ_ASSUME_ALIGNED(row, 16);
+    summand = YZ_ASSUME_ALIGNED(summand, 16);
+    const auto wide_multiple = _mm_set1_ps(multiple);
+    for (const auto* const row_end = row + v_size_rounded_up; row < row_end;
+         errors += 4, row += 4, summand += 4) {
+        const auto wide_row = _mm_load_ps(row);
+        _mm_store_ps(errors, _mm_add_ps(_mm_load_ps(errors), _mm_mul_ps(wide_multiple, wide_row)));
+        _mm_store_ps(row, _mm_add_ps(wide_row, _mm_mul_ps(wide_multiple, _mm_load_ps(summand))));
+    }
+}
+
+// SSE2 has no byte multiplication, so bytes are sign-extended to 16 bits for `pmaddwd`.
+static int32_t ScalarProduct(const int8_t* lhs, const uint32_t lhs_size, const int8_t* rhs) {
+    using yzw2v::num::detail::INT8_ROW_ALIGNMENT;
+    const auto* const lhs_end = lhs + (lhs_size + INT8_ROW_ALIGNMENT - 1) / INT8_ROW_ALIGNMENT
+                                      * INT8_ROW_ALIGNMENT;
+    auto wide_res = _mm_setzero_si128();
+    for (; lhs < lhs_end; lhs += 16, rhs += 16) {
+        const auto wide_lhs = _mm_load_si128(reinterpret_cast<const __m128i*>(lhs));
+        const auto wide_rhs = _mm_load_si128(reinterpret_cast<const __m128i*>(rhs));
+        const auto lhs_low = _mm_srai_epi16(_mm_unpacklo_epi8(wide_lhs, wide_lhs), 8);
+        const auto lhs_high = _mm_srai_epi16(_mm_unpackhi_epi8(wide_lhs, wide_lhs), 8);
+        const auto rhs_low = _mm_srai_epi16(_mm_unpacklo_epi8(wide_rhs, wide_rhs), 8);
+        const auto rhs_high = _mm_srai_epi16(_mm_unpackhi_epi8(wide_rhs, wide_rhs), 8);
+        wide_res = _mm_add_epi32(wide_res, _mm_madd_epi16(lhs_low, rhs_low));
+        wide_res = _mm_add_epi32(wide_res, _mm_madd_epi16(lhs_high, rhs_high));
+    }
+
+    wide_res = _mm_add_epi32(wide_res, _mm_shuffle_epi32(wide_res, _MM_SHUFFLE(1, 0, 3, 2)));
+    wide_res = _mm_add_epi32(wide_res, _mm_shuffle_epi32(wide_res, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtsi128_si32(wide_res);
+}
+
+const yzw2v::num::detail::Kernels yzw2v::num::detail::SSE_KERNELS = {
+    "sse",
+    4,
+    Fill,
+    Zeroize,
+    Prefetch,
+    DivideVector,
+    MultiplyVector,
+    AddVector,
+    AddVector,
+    ScalarProduct,
+    ScalarProducts,
+    AddVectors,
+    ExchangeGradients,
+    &SIMPLE_FP16_KERNELS,  // SSE has no instructions for half precision conversions
+    &SIMPLE_BF16_KERNELS,
+    ScalarProduct
+};
@@ -28,6 +28,11 @@ namespace yzw2v {
                 return state;
             }
 
+            // PRNG constructed from it continues the same sequence
+            uint64_t state() const noexcept {
+                return state_;
+            }
+
             uint64_t operator()() noexcept {
                 return state_ = next();
             }
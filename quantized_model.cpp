@@ -0,0 +1,272 @@
+#include "quantized_model.h"
+
+#include "io.h"
+#include "matrix.h"
+#include "mem.h"
+#include "numeric.h"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+#include <cmath>
+#include <cstring>
+
+static const char QUANTIZED_MODEL_MAGIC[] = {"YZW2V_INT8_MODEL"};
+static constexpr size_t QUANTIZED_MODEL_MAGIC_SIZE = sizeof(QUANTIZED_MODEL_MAGIC)
+                                                     / sizeof(QUANTIZED_MODEL_MAGIC[0]);
+
+// [QUANTIZED_MODEL_MAGIC, rows count, hash(rows count), columns count, hash(columns count)],
+// padded by zeros, so rows that follow are aligned in the mapping
+static constexpr size_t HEADER_SIZE = yzw2v::num::INT8_ROW_ALIGNMENT;
+static_assert(QUANTIZED_MODEL_MAGIC_SIZE + 4 * sizeof(uint32_t) <= HEADER_SIZE,
+              "header doesn't fit");
+
+static constexpr int32_t MAX_VALUE = 127;
+
+static uint32_t IntHash(const uint32_t value) noexcept {
+    // Knuth's Multiplicative Method
+    return value * uint32_t{2654435761};
+}
+
+uint32_t yzw2v::quant::RowSize(const uint32_t columns_count) noexcept {
+    return (columns_count + num::INT8_ROW_ALIGNMENT - 1) / num::INT8_ROW_ALIGNMENT
+           * num::INT8_ROW_ALIGNMENT;
+}
+
+yzw2v::quant::RowParams yzw2v::quant::QuantizeRow(const float* const v, const uint32_t v_size,
+                                                  int8_t* const res) noexcept {
+    std::memset(res, 0, RowSize(v_size));
+    if (!v_size) {
+        return {0.0f, 0.0f, 0, 0.0f};
+    }
+
+    const auto min_max = std::minmax_element(v, v + v_size);
+    const auto min = *min_max.first;
+    const auto max = *min_max.second;
+    auto params = RowParams{(max - min) / (2 * MAX_VALUE), min + (max - min) / 2, 0, 0.0f};
+    if (!(params.scale > 0.0f)) {
+        // all values are the same
+        params = {0.0f, min, 0, std::sqrt(static_cast<float>(v_size)) * std::abs(min)};
+        return params;
+    }
+
+    auto norm = double{};
+    for (auto i = uint32_t{}; i < v_size; ++i) {
+        const auto q = std::min(MAX_VALUE, std::max(-MAX_VALUE, static_cast<int32_t>(
+            std::lround((v[i] - params.offset) / params.scale))));
+        res[i] = static_cast<int8_t>(q);
+        params.sum += q;
+
+        const auto value = static_cast<double>(params.offset) + static_cast<double>(params.scale) * q;
+        norm += value * value;
+    }
+
+    params.norm = static_cast<float>(std::sqrt(norm));
+    return params;
+}
+
+float yzw2v::quant::ScalarProduct(const int8_t* const lhs, const RowParams& lhs_params,
+                                  const int8_t* const rhs, const RowParams& rhs_params,
+                                  const uint32_t v_size) noexcept {
+    const auto q_product = num::ScalarProduct(lhs, v_size, rhs);
+    const auto lhs_offset = static_cast<double>(lhs_params.offset);
+    const auto rhs_offset = static_cast<double>(rhs_params.offset);
+    const auto lhs_scale = static_cast<double>(lhs_params.scale);
+    const auto rhs_scale = static_cast<double>(rhs_params.scale);
+    return static_cast<float>(v_size * lhs_offset * rhs_offset
+                              + lhs_offset * rhs_scale * rhs_params.sum
+                              + rhs_offset * lhs_scale * lhs_params.sum
+                              + lhs_scale * rhs_scale * q_product);
+}
+
+static float Cosine(const float scalar_product, const yzw2v::quant::RowParams& lhs_params,
+                    const yzw2v::quant::RowParams& rhs_params) noexcept {
+    if (!(lhs_params.norm > 0.0f) || !(rhs_params.norm > 0.0f)) {
+        return 0.0f;
+    }
+
+    return scalar_product / (lhs_params.norm * rhs_params.norm);
+}
+
+void yzw2v::quant::WriteModel(const std::string& path, const vocab::Vocabulary& vocab,
+                              const num::Matrix& matrix) {
+    std::ofstream out{path, std::ios::binary};
+    if (!out) {
+        throw std::runtime_error{"failed to open file for write"};
+    }
+
+    static constexpr auto BUFFER_SIZE = size_t{1024} * 1024 * 128; // 128 Mb
+    io::BinaryBufferedWriteProxy proxy{out, BUFFER_SIZE};
+
+    const auto rows_count = matrix.rows_count();
+    const auto columns_count = matrix.columns_count();
+    {
+        char header[HEADER_SIZE] = {};
+        auto* cur = header;
+        std::memcpy(cur, QUANTIZED_MODEL_MAGIC, QUANTIZED_MODEL_MAGIC_SIZE);
+        cur += QUANTIZED_MODEL_MAGIC_SIZE;
+        for (const auto value : {rows_count, IntHash(rows_count),
+                                 columns_count, IntHash(columns_count)}) {
+            std::memcpy(cur, &value, sizeof(value));
+            cur += sizeof(value);
+        }
+
+        proxy.Write(header, HEADER_SIZE);
+    }
+
+    const auto row_size = RowSize(columns_count);
+    const auto row_holder = mem::AllocateFloatForSIMD(columns_count);
+    const std::unique_ptr<int8_t[]> quantized_row{new int8_t[row_size]};
+    auto params = std::vector<RowParams>(rows_count);
+    for (auto i = uint32_t{}; i < rows_count; ++i) {
+        matrix.CopyRow(i, row_holder.get());
+        params[i] = QuantizeRow(row_holder.get(), columns_count, quantized_row.get());
+        proxy.Write(quantized_row.get(), row_size);
+    }
+
+    proxy.Write(params.data(), sizeof(RowParams) * params.size());
+
+    // [length(token), token]
+    for (auto i = uint32_t{}; i < rows_count; ++i) {
+        const auto token = vocab.Token(i).token;
+        const auto length = token.length();
+        proxy.Write(&length, sizeof(length));
+        proxy.Write(token.cbegin(), length);
+    }
+}
+
+yzw2v::quant::Model::Model(const std::string& path)
+    : file_{new io::MappedFile{path, io::FileSize(path), 0, io::Access::RANDOM}}
+{
+    const auto* const data = file_->data();
+    const auto size = file_->size();
+    if (size < HEADER_SIZE) {
+        throw std::runtime_error{"quantized model is too small"};
+    }
+
+    if (std::strncmp(QUANTIZED_MODEL_MAGIC, data, QUANTIZED_MODEL_MAGIC_SIZE)) {
+        throw std::runtime_error{"magic doesn't match"};
+    }
+
+    uint32_t values[4] = {};
+    std::memcpy(values, data + QUANTIZED_MODEL_MAGIC_SIZE, sizeof(values));
+    if (IntHash(values[0]) != values[1]) {
+        throw std::runtime_error{"hash(rows_count) doesn't match"};
+    }
+
+    if (IntHash(values[2]) != values[3]) {
+        throw std::runtime_error{"hash(columns_count) doesn't match"};
+    }
+
+    rows_count_ = values[0];
+    columns_count_ = values[2];
+    row_size_ = RowSize(columns_count_);
+
+    const auto rows_end = HEADER_SIZE + static_cast<uint64_t>(rows_count_) * row_size_;
+    const auto params_end = rows_end + static_cast<uint64_t>(rows_count_) * sizeof(RowParams);
+    if (size < params_end) {
+        throw std::runtime_error{"quantized model is truncated"};
+    }
+
+    rows_ = reinterpret_cast<const int8_t*>(data + HEADER_SIZE);
+    params_ = reinterpret_cast<const RowParams*>(data + rows_end);
+
+    tokens_.reserve(rows_count_);
+    const auto* cur = data + params_end;
+    const auto* const end = data + size;
+    for (auto i = uint32_t{}; i < rows_count_; ++i) {
+        auto length = decltype(vocab::Token{}.length()){};
+        if (end - cur < static_cast<ptrdiff_t>(sizeof(length))) {
+            throw std::runtime_error{"quantized model is truncated"};
+        }
+
+        std::memcpy(&length, cur, sizeof(length));
+        cur += sizeof(length);
+        if (end - cur < length) {
+            throw std::runtime_error{"quantized model is truncated"};
+        }
+
+        tokens_.emplace_back(cur, length);
+        cur += length;
+    }
+
+    sorted_ids_.resize(rows_count_);
+    for (auto i = uint32_t{}; i < rows_count_; ++i) {
+        sorted_ids_[i] = i;
+    }
+
+    std::sort(sorted_ids_.begin(), sorted_ids_.end(), [this](const uint32_t lhs, const uint32_t rhs) {
+        return tokens_[lhs] < tokens_[rhs];
+    });
+}
+
+uint32_t yzw2v::quant::Model::rows_count() const noexcept {
+    return rows_count_;
+}
+
+uint32_t yzw2v::quant::Model::columns_count() const noexcept {
+    return columns_count_;
+}
+
+const int8_t* yzw2v::quant::Model::row(const uint32_t id) const noexcept {
+    return rows_ + static_cast<size_t>(row_size_) * id;
+}
+
+const yzw2v::quant::RowParams& yzw2v::quant::Model::params(const uint32_t id) const noexcept {
+    return params_[id];
+}
+
+const yzw2v::vocab::Token& yzw2v::quant::Model::Token(const uint32_t id) const noexcept {
+    return tokens_[id];
+}
+
+uint32_t yzw2v::quant::Model::ID(const vocab::Token& token) const noexcept {
+    const auto it = std::lower_bound(sorted_ids_.cbegin(), sorted_ids_.cend(), token,
+                                     [this](const uint32_t id, const vocab::Token& value) {
+        return tokens_[id] < value;
+    });
+    if (sorted_ids_.cend() == it || tokens_[*it] != token) {
+        return vocab::INVALID_TOKEN_ID;
+    }
+
+    return *it;
+}
+
+float yzw2v::quant::Model::Cosine(const uint32_t lhs_id, const uint32_t rhs_id) const noexcept {
+    const auto product = ScalarProduct(row(lhs_id), params(lhs_id), row(rhs_id), params(rhs_id),
+                                       columns_count_);
+    return ::Cosine(product, params(lhs_id), params(rhs_id));
+}
+
+std::vector<yzw2v::quant::Neighbour> yzw2v::quant::Model::Nearest(
+    const int8_t* const query, const RowParams& query_params, const uint32_t count,
+    const uint32_t except_id) const
+{
+    // min-heap of the best `count` rows so far
+    const auto more_similar = [](const Neighbour& lhs, const Neighbour& rhs) {
+        return lhs.similarity > rhs.similarity;
+    };
+
+    auto res = std::vector<Neighbour>{};
+    res.reserve(count + 1);
+    for (auto id = uint32_t{}; id < rows_count_ && count; ++id) {
+        if (except_id == id) {
+            continue;
+        }
+
+        const auto product = ScalarProduct(query, query_params, row(id), params(id), columns_count_);
+        const auto similarity = ::Cosine(product, query_params, params(id));
+        if (res.size() < count) {
+            res.push_back({id, similarity});
+            std::push_heap(res.begin(), res.end(), more_similar);
+        } else if (similarity > res.front().similarity) {
+            std::pop_heap(res.begin(), res.end(), more_similar);
+            res.back() = {id, similarity};
+            std::push_heap(res.begin(), res.end(), more_similar);
+        }
+    }
+
+    std::sort_heap(res.begin(), res.end(), more_similar);
+    return res;
+}
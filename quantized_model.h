@@ -0,0 +1,89 @@
+#pragma once
+
+#include "mapped_file.h"
+#include "vocabulary.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <cstdint>
+
+namespace yzw2v {
+    namespace num {
+        class Matrix;
+    }
+}
+
+namespace yzw2v {
+    namespace quant {
+        /* Row is stored as int8 values `q` with `x[i] ~ offset + scale * q[i]`, q in [-127, 127].
+         * `sum` and `norm` are precomputed for scalar products between rows, so they are done on
+         * int8 data directly:
+         *
+         * <x, y> = n * x.offset * y.offset + x.offset * y.scale * y.sum
+         *          + y.offset * x.scale * x.sum + x.scale * y.scale * <x.q, y.q>
+         */
+        struct RowParams {
+            float scale;
+            float offset;
+            int32_t sum;  // of `q`
+            float norm;   // of dequantized row
+        };
+
+        // Bytes of quantized row, it's padded by zeros to `num::INT8_ROW_ALIGNMENT`.
+        uint32_t RowSize(const uint32_t columns_count) noexcept;
+
+        // Min and max of `v` are mapped to -127 and 127, `res` must have `RowSize(v_size)` bytes.
+        RowParams QuantizeRow(const float* v, const uint32_t v_size, int8_t* res) noexcept;
+
+        float ScalarProduct(const int8_t* lhs, const RowParams& lhs_params,
+                            const int8_t* rhs, const RowParams& rhs_params,
+                            const uint32_t v_size) noexcept;
+
+        // Writes rows of `matrix` quantized, together with tokens of `vocab`.
+        void WriteModel(const std::string& path, const vocab::Vocabulary& vocab,
+                        const num::Matrix& matrix);
+
+        struct Neighbour {
+            uint32_t id;
+            float similarity;
+        };
+
+        /* Model written by `WriteModel`, the file is memory mapped and used as is: rows are
+         * aligned in the file, so they are never copied or expanded to floats.
+         */
+        class Model {
+        public:
+            explicit Model(const std::string& path);
+
+            uint32_t rows_count() const noexcept;
+            uint32_t columns_count() const noexcept;
+
+            const int8_t* row(const uint32_t id) const noexcept;
+            const RowParams& params(const uint32_t id) const noexcept;
+
+            const vocab::Token& Token(const uint32_t id) const noexcept;
+            // `vocab::INVALID_TOKEN_ID` if there is no such token
+            uint32_t ID(const vocab::Token& token) const noexcept;
+
+            float Cosine(const uint32_t lhs_id, const uint32_t rhs_id) const noexcept;
+
+            // `count` rows most similar to quantized vector `query` by cosine, the most similar
+            // first; row `except_id` is skipped.
+            std::vector<Neighbour> Nearest(const int8_t* query, const RowParams& query_params,
+                                           const uint32_t count,
+                                           const uint32_t except_id = vocab::INVALID_TOKEN_ID) const;
+
+        private:
+            std::unique_ptr<const io::MappedFile> file_;
+            uint32_t rows_count_;
+            uint32_t columns_count_;
+            uint32_t row_size_;
+            const int8_t* rows_;
+            const RowParams* params_;
+            std::vector<vocab::Token> tokens_;  // point into the mapping
+            std::vector<uint32_t> sorted_ids_;  // by token, for `ID`
+        };
+    }
+}
@@ -0,0 +1,410 @@
+#include "query.h"
+
+#include "io.h"
+#include "mapped_file.h"
+#include "numeric.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <future>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+
+#include <cmath>
+#include <cstring>
+
+// Block of queries and tile of rows are multiplied at once: with 100-300 columns both fit L2
+// together with the block of scores, so every row of a tile is read from memory once per block.
+static constexpr uint32_t QUERIES_BLOCK_SIZE = 32;
+static constexpr uint32_t ROWS_TILE_SIZE = 256;
+
+static uint32_t ParseHeaderValue(const char*& cur, const char* const end) {
+    for (; cur < end && (' ' == *cur || '\n' == *cur); ++cur);
+
+    const auto* const begin = cur;
+    auto value = uint64_t{};
+    for (; cur < end && *cur >= '0' && *cur <= '9'; ++cur) {
+        value = value * 10 + static_cast<uint64_t>(*cur - '0');
+        if (value > std::numeric_limits<uint32_t>::max()) {
+            throw std::runtime_error{"bad model header"};
+        }
+    }
+
+    if (begin == cur) {
+        throw std::runtime_error{"bad model header"};
+    }
+
+    return static_cast<uint32_t>(value);
+}
+
+yzw2v::query::Model::Model(const std::string& path, const bool normalize) {
+    const io::MappedFile file{path, io::FileSize(path), 0};
+    const auto* cur = file.data();
+    const auto* const end = cur + file.size();
+
+    const auto rows_count = ParseHeaderValue(cur, end);
+    const auto columns_count = ParseHeaderValue(cur, end);
+    if (!rows_count || !columns_count) {
+        throw std::runtime_error{"model is empty"};
+    }
+
+    // [token, ' ', float * columns_count, '\n'], the first token goes right after the header
+    vocab_.reset(new vocab::Vocabulary{rows_count});
+    matrix_.reset(new num::Matrix{rows_count, columns_count});
+    const auto row_bytes = sizeof(float) * columns_count;
+    for (auto i = uint32_t{}; i < rows_count; ++i) {
+        for (; cur < end && (' ' == *cur || '\n' == *cur); ++cur);
+
+        const auto* const token_end = std::find(cur, end, ' ');
+        if (end == token_end || cur == token_end
+            || static_cast<size_t>(token_end - cur) >= vocab::MAX_TOKEN_LENGTH) {
+            throw std::runtime_error{"bad token in model"};
+        }
+
+        if (vocab_->Add({cur, token_end}) != i) {
+            throw std::runtime_error{"duplicate token in model"};
+        }
+
+        cur = token_end + 1;
+        if (static_cast<size_t>(end - cur) < row_bytes) {
+            throw std::runtime_error{"model is truncated"};
+        }
+
+        auto* const row = matrix_->row(i);
+        std::memcpy(row, cur, row_bytes);
+        cur += row_bytes;
+        if (!normalize) {
+            continue;
+        }
+
+        const auto norm = std::sqrt(num::ScalarProduct(row, columns_count, row));
+        if (norm > 0.0f) {
+            num::DivideVector(row, columns_count, norm);
+        }
+    }
+}
+
+yzw2v::query::Model::Model(const vocab::Vocabulary& vocab, const num::Matrix& matrix)
+    : vocab_{new vocab::Vocabulary{std::max(vocab.size(), uint32_t{1})}}
+    , matrix_{new num::Matrix{matrix.rows_count(), matrix.columns_count()}}
+{
+    const auto columns_count = matrix.columns_count();
+    for (auto i = uint32_t{}; i < matrix.rows_count(); ++i) {
+        vocab_->Add(vocab.Token(i).token);
+
+        auto* const row = matrix_->row(i);
+        matrix.CopyRow(i, row);
+        const auto norm = std::sqrt(num::ScalarProduct(row, columns_count, row));
+        if (norm > 0.0f) {
+            num::DivideVector(row, columns_count, norm);
+        }
+    }
+}
+
+uint32_t yzw2v::query::Model::rows_count() const noexcept {
+    return matrix_->rows_count();
+}
+
+uint32_t yzw2v::query::Model::columns_count() const noexcept {
+    return matrix_->columns_count();
+}
+
+const yzw2v::vocab::Vocabulary& yzw2v::query::Model::vocab() const noexcept {
+    return *vocab_;
+}
+
+const yzw2v::num::Matrix& yzw2v::query::Model::matrix() const noexcept {
+    return *matrix_;
+}
+
+namespace {
+    // Min-heap of the best `count` neighbours so far, kept in place in the result.
+    class TopNeighbours {
+    public:
+        TopNeighbours(yzw2v::query::Neighbour* const res, const uint32_t count) noexcept
+            : res_{res}
+            , count_{count}
+            , size_{0}
+            , threshold_{count ? std::numeric_limits<float>::lowest()
+                               : std::numeric_limits<float>::max()} {
+        }
+
+        // Only neighbours more similar than that are accepted.
+        float threshold() const noexcept {
+            return threshold_;
+        }
+
+        void Push(const uint32_t id, const float similarity) noexcept {
+            if (size_ < count_) {
+                res_[size_++] = {id, similarity};
+                std::push_heap(res_, res_ + size_, MoreSimilar);
+            } else {
+                std::pop_heap(res_, res_ + size_, MoreSimilar);
+                res_[size_ - 1] = {id, similarity};
+                std::push_heap(res_, res_ + size_, MoreSimilar);
+            }
+
+            if (size_ == count_) {
+                threshold_ = res_->similarity;
+            }
+        }
+
+        // The most similar first, missing neighbours are marked by invalid id.
+        void Finish() noexcept {
+            std::sort_heap(res_, res_ + size_, MoreSimilar);
+            std::fill(res_ + size_, res_ + count_,
+                      yzw2v::query::Neighbour{yzw2v::vocab::INVALID_TOKEN_ID, 0.0f});
+        }
+
+    private:
+        static bool MoreSimilar(const yzw2v::query::Neighbour& lhs,
+                                const yzw2v::query::Neighbour& rhs) noexcept {
+            return lhs.similarity > rhs.similarity;
+        }
+
+        yzw2v::query::Neighbour* res_;
+        uint32_t count_;
+        uint32_t size_;
+        float threshold_;
+    };
+}
+
+// Neighbours among rows [rows_begin, rows_end) for a block of queries.
+static void ScanRows(const yzw2v::num::Matrix& matrix,
+                     const float* const* const queries, const uint32_t* const except_ids,
+                     const uint32_t queries_count, const uint32_t rows_begin,
+                     const uint32_t rows_end, const uint32_t count,
+                     yzw2v::query::Neighbour* const res, float* const scores) {
+    auto tops = std::vector<TopNeighbours>{};
+    tops.reserve(queries_count);
+    for (auto i = uint32_t{}; i < queries_count; ++i) {
+        tops.emplace_back(res + static_cast<size_t>(i) * count, count);
+    }
+
+    const float* rows[ROWS_TILE_SIZE];
+    for (auto tile_begin = rows_begin; tile_begin < rows_end; tile_begin += ROWS_TILE_SIZE) {
+        const auto tile_size = std::min(ROWS_TILE_SIZE, rows_end - tile_begin);
+        for (auto j = uint32_t{}; j < tile_size; ++j) {
+            rows[j] = matrix.row(tile_begin + j);
+        }
+
+        yzw2v::num::ScalarProducts(queries, queries_count, rows, tile_size,
+                                   matrix.columns_count(), scores);
+        for (auto i = uint32_t{}; i < queries_count; ++i) {
+            auto& top = tops[i];
+            const auto* const query_scores = scores + i * tile_size;
+            const auto except_id = except_ids ? except_ids[i] : yzw2v::vocab::INVALID_TOKEN_ID;
+            for (auto j = uint32_t{}; j < tile_size; ++j) {
+                if (query_scores[j] > top.threshold() && tile_begin + j != except_id) {
+                    top.Push(tile_begin + j, query_scores[j]);
+                }
+            }
+        }
+    }
+
+    for (auto&& top : tops) {
+        top.Finish();
+    }
+}
+
+static std::vector<yzw2v::query::Neighbour> Nearest(
+    const yzw2v::num::Matrix& matrix, const std::vector<const float*>& queries,
+    const uint32_t* const except_ids, const uint32_t count, const uint32_t threads_count)
+{
+    const auto queries_count = static_cast<uint32_t>(queries.size());
+    const auto rows_count = matrix.rows_count();
+    auto res = std::vector<yzw2v::query::Neighbour>(static_cast<size_t>(queries_count) * count);
+    if (!queries_count || !count) {
+        return res;
+    }
+
+    // With few queries (e.g. a single one) rows are split between threads too, then partial
+    // results of every part are merged.
+    const auto blocks_count = (queries_count + QUERIES_BLOCK_SIZE - 1) / QUERIES_BLOCK_SIZE;
+    const auto tiles_count = (rows_count + ROWS_TILE_SIZE - 1) / ROWS_TILE_SIZE;
+    const auto parts_count = std::max(uint32_t{1}, std::min(tiles_count,
+                                                            threads_count / blocks_count));
+    const auto tiles_per_part = (tiles_count + parts_count - 1) / parts_count;
+    auto partial = std::vector<yzw2v::query::Neighbour>{};
+    if (parts_count > 1) {
+        partial.resize(res.size() * parts_count);
+    }
+
+    std::atomic<uint32_t> next_item{0};
+    const auto items_count = blocks_count * parts_count;
+    const auto run = [&]{
+        auto scores = std::vector<float>(QUERIES_BLOCK_SIZE * ROWS_TILE_SIZE);
+        for (auto item = next_item++; item < items_count; item = next_item++) {
+            const auto block = item / parts_count;
+            const auto part = item % parts_count;
+            const auto block_begin = block * QUERIES_BLOCK_SIZE;
+            const auto block_size = std::min(QUERIES_BLOCK_SIZE, queries_count - block_begin);
+            const auto rows_begin = std::min(rows_count, part * tiles_per_part * ROWS_TILE_SIZE);
+            const auto rows_end = std::min(rows_count, rows_begin + tiles_per_part * ROWS_TILE_SIZE);
+            auto* const block_res = (parts_count > 1 ? partial.data() + part * res.size()
+                                                     : res.data())
+                                    + static_cast<size_t>(block_begin) * count;
+            ScanRows(matrix, queries.data() + block_begin,
+                     except_ids ? except_ids + block_begin : nullptr, block_size,
+                     rows_begin, rows_end, count, block_res, scores.data());
+        }
+    };
+
+    auto jobs = std::vector<std::future<void>>{};
+    for (auto i = uint32_t{1}; i < std::min(threads_count, items_count); ++i) {
+        jobs.emplace_back(std::async(std::launch::async, run));
+    }
+
+    run();
+    for (auto&& job : jobs) {
+        job.get();
+    }
+
+    if (parts_count > 1) {
+        for (auto i = uint32_t{}; i < queries_count; ++i) {
+            TopNeighbours top{res.data() + static_cast<size_t>(i) * count, count};
+            for (auto part = uint32_t{}; part < parts_count; ++part) {
+                const auto* const part_res = partial.data() + part * res.size()
+                                             + static_cast<size_t>(i) * count;
+                for (auto j = uint32_t{}; j < count; ++j) {
+                    if (yzw2v::vocab::INVALID_TOKEN_ID != part_res[j].id
+                        && part_res[j].similarity > top.threshold()) {
+                        top.Push(part_res[j].id, part_res[j].similarity);
+                    }
+                }
+            }
+
+            top.Finish();
+        }
+    }
+
+    return res;
+}
+
+std::vector<yzw2v::query::Neighbour> yzw2v::query::Nearest(
+    const num::Matrix& rows, const num::Matrix& queries, const uint32_t* const except_ids,
+    const uint32_t count, const uint32_t threads_count)
+{
+    if (queries.columns_count() != rows.columns_count()) {
+        throw std::runtime_error{"queries and model have different number of columns"};
+    }
+
+    auto query_rows = std::vector<const float*>(queries.rows_count());
+    for (auto i = uint32_t{}; i < queries.rows_count(); ++i) {
+        query_rows[i] = queries.row(i);
+    }
+
+    return ::Nearest(rows, query_rows, except_ids, count, threads_count);
+}
+
+std::vector<yzw2v::query::Neighbour> yzw2v::query::Nearest(
+    const Model& model, const num::Matrix& queries, const uint32_t* const except_ids,
+    const uint32_t count, const uint32_t threads_count)
+{
+    return Nearest(model.matrix(), queries, except_ids, count, threads_count);
+}
+
+std::vector<yzw2v::query::Neighbour> yzw2v::query::Nearest(
+    const Model& model, const std::vector<uint32_t>& ids, const uint32_t count,
+    const uint32_t threads_count)
+{
+    auto query_rows = std::vector<const float*>(ids.size());
+    for (auto i = size_t{}; i < ids.size(); ++i) {
+        query_rows[i] = model.matrix().row(ids[i]);
+    }
+
+    return ::Nearest(model.matrix(), query_rows, ids.data(), count, threads_count);
+}
+
+// `vocab::INVALID_TOKEN_ID` if line is not a word of `vocab`
+static uint32_t LineToID(const yzw2v::vocab::Vocabulary& vocab, std::string& line) noexcept {
+    if (!line.empty() && '\r' == line.back()) {
+        line.pop_back();
+    }
+
+    if (line.size() >= yzw2v::vocab::MAX_TOKEN_LENGTH) {
+        return yzw2v::vocab::INVALID_TOKEN_ID;
+    }
+
+    return vocab.ID({line.data(), line.data() + line.size()});
+}
+
+std::vector<uint32_t> yzw2v::query::ReadIDs(const Model& model, const std::string& path) {
+    std::ifstream in{path};
+    if (!in) {
+        throw std::runtime_error{"failed to open queries file"};
+    }
+
+    auto ids = std::vector<uint32_t>{};
+    for (auto line = std::string{}; std::getline(in, line);) {
+        const auto id = LineToID(model.vocab(), line);
+        if (vocab::INVALID_TOKEN_ID != id) {
+            ids.push_back(id);
+        }
+    }
+
+    return ids;
+}
+
+void yzw2v::query::AnswerQueries(const Model& model, const std::string& queries_path,
+                                 const std::string& output_path, const uint32_t count,
+                                 const uint32_t batch_size, const uint32_t threads_count,
+                                 const NearestFunction& nearest) {
+    std::ifstream in{queries_path};
+    if (!in) {
+        throw std::runtime_error{"failed to open queries file"};
+    }
+
+    std::ofstream out_file;
+    if ("-" != output_path) {
+        out_file.open(output_path, std::ios::binary);
+        if (!out_file) {
+            throw std::runtime_error{"failed to open file for write"};
+        }
+    }
+
+    auto& out = "-" != output_path ? out_file : std::cout;
+    const auto& vocab = model.vocab();
+    auto answered_count = uint64_t{};
+    auto missing_count = uint64_t{};
+    auto ids = std::vector<uint32_t>{};
+    const auto start_time = std::chrono::steady_clock::now();
+    for (auto line = std::string{}; in;) {
+        ids.clear();
+        while (ids.size() < batch_size && std::getline(in, line)) {
+            const auto id = LineToID(vocab, line);
+            if (vocab::INVALID_TOKEN_ID == id) {
+                ++missing_count;
+            } else {
+                ids.push_back(id);
+            }
+        }
+
+        const auto neighbours = nearest ? nearest(ids, count)
+                                        : Nearest(model, ids, count, threads_count);
+        for (auto i = size_t{}; i < ids.size(); ++i) {
+            const auto query = vocab.Token(ids[i]).token;
+            for (auto j = size_t{}; j < count; ++j) {
+                const auto& neighbour = neighbours[i * count + j];
+                if (vocab::INVALID_TOKEN_ID == neighbour.id) {
+                    break;
+                }
+
+                out << query << '\t' << vocab.Token(neighbour.id).token << '\t'
+                    << neighbour.similarity << '\n';
+            }
+        }
+
+        answered_count += ids.size();
+    }
+
+    out.flush();
+    const auto seconds = std::chrono::duration<double>(
+        std::chrono::steady_clock::now() - start_time).count();
+    std::clog << "Queries: " << answered_count << " answered, " << missing_count
+              << " not in model, " << static_cast<uint64_t>(answered_count / std::max(seconds, 1e-3))
+              << " queries/sec" << std::endl;
+}
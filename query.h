@@ -0,0 +1,84 @@
+#pragma once
+
+#include "matrix.h"
+#include "vocabulary.h"
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <cstdint>
+
+namespace yzw2v {
+    namespace query {
+        struct Neighbour {
+            uint32_t id;
+            float similarity;
+        };
+
+        /* Model in word2vec binary format (as written by `train::WriteModelBinary`). Rows are
+         * normalized on load, so cosine similarity is just a scalar product; `normalize` is false
+         * only to get vectors as they are, e.g. to continue training.
+         */
+        class Model {
+        public:
+            explicit Model(const std::string& path, const bool normalize = true);
+            // Normalized copy of trained `matrix`
+            Model(const vocab::Vocabulary& vocab, const num::Matrix& matrix);
+
+            uint32_t rows_count() const noexcept;
+            uint32_t columns_count() const noexcept;
+
+            const vocab::Vocabulary& vocab() const noexcept;
+            const num::Matrix& matrix() const noexcept;
+
+        private:
+            std::unique_ptr<vocab::Vocabulary> vocab_;
+            std::unique_ptr<num::Matrix> matrix_;
+        };
+
+        /* Top-`count` rows of `model` by cosine similarity for each row of `queries` (rows of
+         * `queries` must be normalized), the most similar first. Result has `count` neighbours
+         * for every query: `res[i * count + j]` is j-th neighbour of i-th query; if there are
+         * less candidates than `count` the rest have `vocab::INVALID_TOKEN_ID` as id.
+         *
+         * Row `except_ids[i]` is skipped for i-th query (e.g. query word itself), `except_ids`
+         * may be null.
+         *
+         * Queries are processed in blocks against tiles of rows, so a tile is loaded from
+         * memory once per block of queries. Blocks are spread over `threads_count` threads; when
+         * there are less blocks than threads rows are split between threads as well.
+         */
+        std::vector<Neighbour> Nearest(const Model& model, const num::Matrix& queries,
+                                       const uint32_t* except_ids, const uint32_t count,
+                                       const uint32_t threads_count);
+
+        // Same for any normalized `rows`, e.g. a part of model.
+        std::vector<Neighbour> Nearest(const num::Matrix& rows, const num::Matrix& queries,
+                                       const uint32_t* except_ids, const uint32_t count,
+                                       const uint32_t threads_count);
+
+        // Same with rows of `model` as queries, query row itself is skipped.
+        std::vector<Neighbour> Nearest(const Model& model, const std::vector<uint32_t>& ids,
+                                       const uint32_t count, const uint32_t threads_count);
+
+        // Ids of words of `path`, one word per line; words missing in `model` are skipped.
+        std::vector<uint32_t> ReadIDs(const Model& model, const std::string& path);
+
+        // Neighbours of rows `ids` of model in the layout of `Nearest`, `count` for every row.
+        using NearestFunction = std::function<std::vector<Neighbour>(
+            const std::vector<uint32_t>& ids, const uint32_t count)>;
+
+        /* Reads one query word per line from `queries_path` and writes
+         * "query<TAB>neighbour<TAB>similarity" lines to `output_path` ("-" for stdout). Words
+         * missing in `model` are skipped. Queries are read and answered in batches of
+         * `batch_size` words by `nearest`, exact `Nearest` with `threads_count` threads if it's
+         * not given.
+         */
+        void AnswerQueries(const Model& model, const std::string& queries_path,
+                           const std::string& output_path, const uint32_t count,
+                           const uint32_t batch_size, const uint32_t threads_count,
+                           const NearestFunction& nearest = {});
+    }
+}
@@ -1,63 +1,92 @@
 #include "token_reader.h"
 
-#include "vocabulary.h"
 #include "likely.h"
 
 #include <algorithm>
+#include <fstream>
+#include <functional>
+#include <stdexcept>
 
 #include <cstring>
 
-static const yzw2v::vocab::Token PARAGRAPH_TOKEN{"</s>"};
-static constexpr uint32_t BUF_SIZE = 1024 * 1024 * 32 - 1; // 32 Mb
-
 bool yzw2v::io::TokenReader::Done() const noexcept {
-    return !buf_cur_;
+    return done_;
+}
+
+uint64_t yzw2v::io::TokenReader::BytesRead() const noexcept {
+    return bytes_before_block_ + static_cast<uint64_t>(buf_cur_ - block_begin_);
+}
+
+yzw2v::vocab::Token
+yzw2v::io::TokenReader::CopyToBatchBuffer(const vocab::Token& token) noexcept {
+    std::memcpy(batch_buffer_, token.cbegin(), token.length());
+    const auto res = vocab::Token{batch_buffer_, token.length()};
+    batch_buffer_ += token.length();
+    return res;
+}
+
+void yzw2v::io::TokenReader::KeepBatchTokens() noexcept {
+    const auto less = std::less<const char*>{};
+    for (auto i = uint32_t{}; i < batch_size_; ++i) {
+        const auto* const begin = batch_tokens_[i].cbegin();
+        if (!less(begin, block_begin_) && less(begin, buf_end_)) {
+            batch_tokens_[i] = CopyToBatchBuffer(batch_tokens_[i]);
+        }
+    }
+}
+
+void yzw2v::io::TokenReader::LoadBlock() {
+    if (batch_size_ && !source_->KeepsBlocks()) {
+        // tokens of current batch are still in use, but block is going to be reused
+        KeepBatchTokens();
+    }
+
+    bytes_before_block_ += static_cast<uint64_t>(buf_end_ - block_begin_);
+
+    const auto block = source_->Next();
+    block_begin_ = block.begin;
+    buf_cur_ = block.begin;
+    buf_end_ = block.end;
+    done_ = block.begin == block.end;
+
+    // if token didn't end in the previous block it continues from the beginning of this one
+    token_begin_ = carry_size_ ? block_begin_ : nullptr;
 }
 
-void yzw2v::io::TokenReader::LoadToBuffer() {
-    const auto bytes_to_read = static_cast<uint32_t>(
-            std::min(bytes_left_,
-                     static_cast<uint64_t>(BUF_SIZE) - unprocessed_size_));
-    if (!input_.read(buf_.get() + unprocessed_size_, static_cast<std::streamsize>(bytes_to_read))) {
-        throw std::runtime_error("read failed");
+void yzw2v::io::TokenReader::CarryTokenBegin() {
+    const auto size = static_cast<uint32_t>(buf_end_ - token_begin_);
+    if (carry_size_ + size <= vocab::MAX_TOKEN_LENGTH) {
+        std::memcpy(carry_ + carry_size_, token_begin_, size);
     }
 
-    *(buf_.get() + unprocessed_size_ + bytes_to_read) = '\0';
-    buf_cur_ = buf_.get() - 1;  // -1 to compensate `++buf_cur_` in while-for loop
-    bytes_left_ -= bytes_to_read;
+    carry_size_ += size;
     token_begin_ = nullptr;
 }
 
 yzw2v::io::TokenReader::TokenReader(const std::string& path,
                                     const uint64_t bytes_to_read,
-                                    const uint64_t offset)
-    : return_paragraph_{true}  // first token we return must be a paragraph token
+                                    const uint64_t offset,
+                                    const ReadOptions& options)
+    : starts_paragraph_{0 == offset}
+    , return_paragraph_{starts_paragraph_}  // first token of the file is a paragraph token
+    , done_{false}
+    , block_begin_{nullptr}
+    , buf_cur_{nullptr}
+    , buf_end_{nullptr}
     , token_begin_{nullptr}
-    , unprocessed_size_{0}
-    , bytes_left_{bytes_to_read}
-    , buf_{new char[BUF_SIZE + 1]} // +1 for zero-terminator
-    , input_{path, std::ios::binary}
-    , bytes_to_read_from_input_file_{bytes_to_read}
-    , input_file_offset_{offset} {
-    if (!input_.seekg(static_cast<std::streamoff>(input_file_offset_))) {
-        throw std::runtime_error("seekg failed");
-    }
-
-    buf_cur_ = buf_.get() - 1; // -1 to compensate `++buf_cur_` in while-for loop
-    LoadToBuffer();
+    , bytes_before_block_{0}
+    , carry_size_{0}
+    , batch_tokens_{nullptr}
+    , batch_size_{0}
+    , batch_buffer_{nullptr}
+    , source_{MakeByteSource(path, bytes_to_read, offset, options)} {
+    LoadBlock();
 }
 
-void yzw2v::io::TokenReader::Restart() {
-    return_paragraph_ = true;
-    token_begin_ = nullptr;
-    unprocessed_size_ = 0;
-    bytes_left_ = bytes_to_read_from_input_file_;
-    if (!input_.seekg(static_cast<std::streamoff>(input_file_offset_))) {
-        throw std::runtime_error("seekg failed");
-    }
-
-    buf_cur_ = buf_.get() - 1;
-    LoadToBuffer();
+yzw2v::io::TokenReader::TokenReader(const std::string& path,
+                                    const uint64_t bytes_to_read,
+                                    const uint64_t offset)
+    : TokenReader{path, bytes_to_read, offset, ReadOptions{}} {
 }
 
 yzw2v::io::TokenReader::TokenReader(const std::string& path,
@@ -65,57 +94,165 @@ yzw2v::io::TokenReader::TokenReader(const std::string& path,
     : TokenReader{path, bytes_to_read, 0} {
 }
 
+void yzw2v::io::TokenReader::ClearState() noexcept {
+    return_paragraph_ = starts_paragraph_;
+    block_begin_ = nullptr;
+    buf_cur_ = nullptr;
+    buf_end_ = nullptr;
+    token_begin_ = nullptr;
+    bytes_before_block_ = 0;
+    carry_size_ = 0;
+}
+
+void yzw2v::io::TokenReader::Restart() {
+    ClearState();
+    source_->Restart();
+    LoadBlock();
+}
+
+void yzw2v::io::TokenReader::Reset(const uint64_t bytes_to_read, const uint64_t offset) {
+    starts_paragraph_ = 0 == offset;
+    ClearState();
+    source_->Reset(bytes_to_read, offset);
+    LoadBlock();
+}
+
+void yzw2v::io::TokenReader::Prefetch(const uint64_t bytes_to_read, const uint64_t offset) {
+    source_->Prefetch(bytes_to_read, offset);
+}
+
+yzw2v::vocab::Token yzw2v::io::TokenReader::Paragraph() {
+    return_paragraph_ = false;
+
+    // Paragraph token doesn't point into the block, so the next one may be loaded right away. This
+    // way `Done` is true right after '\n' at the end of input and there is no extra paragraph token
+    // at the end of every region.
+    if (buf_cur_ == buf_end_ && !token_begin_ && !done_) {
+        LoadBlock();
+    }
+
+    return vocab::PARAGRAPH_TOKEN;
+}
+
 yzw2v::vocab::Token yzw2v::io::TokenReader::Read() {
     if (return_paragraph_) {
-        return_paragraph_ = false;
-        return PARAGRAPH_TOKEN;
+        return Paragraph();
     }
 
     while (!Done()) {
-        for (++buf_cur_; *buf_cur_; ++buf_cur_) {
-            if (YZ_UNLIKELY(' ' == *buf_cur_ || '\t' == *buf_cur_ || '\n' == *buf_cur_)) {
-                if ('\n' == *buf_cur_) {
+        while (buf_cur_ < buf_end_) {
+            const auto* const cur = buf_cur_++;
+            if (YZ_UNLIKELY(' ' == *cur || '\t' == *cur || '\n' == *cur)) {
+                if ('\n' == *cur) {
                     return_paragraph_ = true;
                 }
 
                 if (YZ_LIKELY(!!token_begin_)) {
                     // previous symbol was last symbol of the token
-                    if (buf_cur_ - token_begin_ <= static_cast<std::ptrdiff_t>(yzw2v::vocab::MAX_TOKEN_LENGTH)) {
-                        const vocab::Token token{token_begin_, buf_cur_};
-                        token_begin_ = nullptr;
-                        return token;
-                    }
-
+                    const auto* const token_begin = token_begin_;
                     token_begin_ = nullptr;
+                    const auto size = static_cast<uint32_t>(cur - token_begin);
+                    if (YZ_LIKELY(!carry_size_)) {
+                        if (size <= vocab::MAX_TOKEN_LENGTH) {
+                            return vocab::Token{token_begin, cur};
+                        }
+                    } else {
+                        // token started in one of the previous blocks
+                        const auto carry_size = carry_size_;
+                        carry_size_ = 0;
+                        if (carry_size + size <= vocab::MAX_TOKEN_LENGTH) {
+                            std::memcpy(carry_ + carry_size, token_begin, size);
+                            return vocab::Token{carry_, carry_ + carry_size + size};
+                        }
+                    }
                 }
 
                 if (return_paragraph_) {
-                    return_paragraph_ = false;
-                    return PARAGRAPH_TOKEN;
+                    return Paragraph();
                 }
 
                 continue;
             }
 
             if (!token_begin_) {
-                token_begin_ = buf_cur_;
+                token_begin_ = cur;
             }
         }
 
         if (token_begin_) {
-            // token at the end of the buffer, we have to copy it to the begining of the buffer, so on
-            // the next iteration we could finish process this token
-            unprocessed_size_ = static_cast<uint32_t>(buf_cur_ - token_begin_);
-            std::memmove(buf_.get(), token_begin_, unprocessed_size_);
-            token_begin_ = nullptr;
+            // token at the end of the block, keep its beginning until we find its end
+            CarryTokenBegin();
+        }
+
+        LoadBlock();
+    }
+
+    return vocab::PARAGRAPH_TOKEN;
+}
+
+uint32_t yzw2v::io::TokenReader::Read(vocab::Token* const tokens, const uint32_t count,
+                                      char* const buffer) {
+    batch_tokens_ = tokens;
+    batch_size_ = 0;
+    batch_buffer_ = buffer;
+    while (batch_size_ < count && !Done()) {
+        auto token = Read();
+        if (token.cbegin() == carry_) {
+            // next token that spans two blocks goes to `carry_` as well
+            token = CopyToBatchBuffer(token);
+        }
+
+        tokens[batch_size_++] = token;
+    }
+
+    const auto res = batch_size_;
+    batch_size_ = 0;
+    return res;
+}
+
+std::vector<uint64_t> yzw2v::io::SplitTextIntoChunks(const std::string& path,
+                                                     const uint64_t file_size,
+                                                     const uint64_t chunk_size) {
+    std::ifstream input{path, std::ios::binary};
+    if (!input) {
+        throw std::runtime_error{"failed to open file"};
+    }
+
+    static constexpr uint32_t SCAN_BUFFER_SIZE = 64 * 1024;
+    char buf[SCAN_BUFFER_SIZE];
+
+    auto res = std::vector<uint64_t>{0};
+    for (auto boundary = chunk_size; boundary < file_size;) {
+        // move boundary forward to the next line
+        if (!input.seekg(static_cast<std::streamoff>(boundary - 1))) {
+            throw std::runtime_error{"seekg failed"};
+        }
+
+        auto found = false;
+        while (!found && boundary < file_size) {
+            const auto size = static_cast<uint32_t>(
+                std::min<uint64_t>(SCAN_BUFFER_SIZE, file_size - (boundary - 1)));
+            if (!input.read(buf, static_cast<std::streamsize>(size))) {
+                throw std::runtime_error{"read failed"};
+            }
+
+            const auto* const newline = static_cast<const char*>(std::memchr(buf, '\n', size));
+            if (newline) {
+                boundary += static_cast<uint64_t>(newline - buf);
+                found = true;
+            } else {
+                boundary += size;
+            }
         }
 
-        if (bytes_left_) {
-            LoadToBuffer();
-        } else {
-            buf_cur_ = nullptr;
+        if (boundary >= file_size) {
+            break;
         }
+
+        res.push_back(boundary);
+        boundary += chunk_size;
     }
 
-    return PARAGRAPH_TOKEN;
+    res.push_back(file_size);
+    return res;
 }
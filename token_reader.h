@@ -1,19 +1,32 @@
 #pragma once
 
-#include <fstream>
+#include "byte_source.h"
+#include "vocabulary.h"
+
 #include <string>
 #include <memory>
+#include <vector>
 
-namespace yzw2v {
-    namespace vocab {
-        class Token;
-    }
-}
+#include <cstdint>
 
 namespace yzw2v {
     namespace io {
+        /* Splits input into tokens by ' ', '\t' and '\n', '\n' also produces paragraph token.
+         * Returned token is valid until the next call to `Read`: it points either into the current
+         * block of `ByteSource` or, if it spans two blocks, into internal carry buffer.
+         *
+         * Beginning of the file also produces paragraph token. Region that starts elsewhere is
+         * expected to start right after '\n' (see `SplitTextIntoChunks`), its paragraph token
+         * was already produced by the region before it, so tokens of consecutive regions are
+         * exactly the tokens of the whole file.
+         */
         class TokenReader {
         public:
+            TokenReader(const std::string& path,
+                        const uint64_t bytes_to_read,
+                        const uint64_t offset,
+                        const ReadOptions& options);
+
             TokenReader(const std::string& path,
                         const uint64_t bytes_to_read,
                         const uint64_t offset);
@@ -24,21 +37,60 @@ namespace yzw2v {
             vocab::Token Read();
             bool Done() const noexcept;
 
+            /* Reads up to `count` tokens, less only at the end of input; they are valid together
+             * until the next call. Tokens that would be invalidated by reading further (the ones
+             * in carry buffer, or in a block given back to `ByteSource`) are copied to `buffer`
+             * of `count * vocab::MAX_TOKEN_LENGTH` bytes, others point into the block.
+             */
+            uint32_t Read(vocab::Token* const tokens, const uint32_t count, char* const buffer);
+
             void Restart();
 
+            // Continue with another region of the same file, as if it was a new reader.
+            void Reset(const uint64_t bytes_to_read, const uint64_t offset);
+
+            // Region the next `Reset` will be called with, see `ByteSource::Prefetch`.
+            void Prefetch(const uint64_t bytes_to_read, const uint64_t offset);
+
+            // Bytes of the input processed since last `Restart` or `Reset`
+            uint64_t BytesRead() const noexcept;
+
         private:
-            void LoadToBuffer();
+            void ClearState() noexcept;
+            vocab::Token Paragraph();
+            void LoadBlock();
+            void CarryTokenBegin();
+            vocab::Token CopyToBatchBuffer(const vocab::Token& token) noexcept;
+            void KeepBatchTokens() noexcept;
 
         private:
+            bool starts_paragraph_;  // region starts at the beginning of the file
             bool return_paragraph_;
-            char* buf_cur_;
+            bool done_;
+            const char* block_begin_;
+            const char* buf_cur_;  // next symbol to process
+            const char* buf_end_;
             const char* token_begin_;
-            uint32_t unprocessed_size_;
-            uint64_t bytes_left_;
-            std::unique_ptr<char[]> buf_;
-            std::ifstream input_;
-            uint64_t bytes_to_read_from_input_file_;
-            uint64_t input_file_offset_;
+            uint64_t bytes_before_block_;
+
+            // beginning of the token that started in one of the previous blocks
+            char carry_[vocab::MAX_TOKEN_LENGTH];
+            uint32_t carry_size_;  // may be greater than `MAX_TOKEN_LENGTH`, then token is skipped
+
+            // batch being read by `Read(tokens, count, buffer)`
+            vocab::Token* batch_tokens_;
+            uint32_t batch_size_;
+            char* batch_buffer_;  // where next copied token goes
+
+            const std::unique_ptr<ByteSource> source_;
         };
+
+        /* Boundaries of about `chunk_size` long parts of the text, each boundary except the first
+         * and the last one is right after '\n'. Result starts with 0 and ends with `file_size`,
+         * part `i` is [res[i], res[i + 1]). Line longer than `chunk_size` makes its part longer.
+         */
+        std::vector<uint64_t> SplitTextIntoChunks(const std::string& path,
+                                                  const uint64_t file_size,
+                                                  const uint64_t chunk_size);
     }
 }
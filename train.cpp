@@ -1,103 +1,193 @@
 #include "train.h"
+#include "train_checkpoint.h"
+#include "train_progress.h"
+#include "train_schedule.h"
 
 #include "huffman.h"
+#include "id_corpus.h"
 #include "io.h"
 #include "matrix.h"
 #include "mem.h"
+#include "numa.h"
 #include "numeric.h"
 #include "prng.h"
+#include "query.h"
 #include "token_reader.h"
 #include "unigram_distribution.h"
 #include "vocabulary.h"
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <future>
 #include <iomanip>
 #include <iostream>
 #include <mutex>
 #include <thread>
+#include <utility>
 #include <vector>
 #include <random>
 
 #include <cmath>
 #include <cstdio>
+#include <cstring>
 
 static constexpr uint64_t PER_THREAD_WORD_COUNT_TO_UPDATE_PARAMS = 10000;
-static constexpr size_t EXP_TABLE_SIZE = 1000;
-static constexpr uint32_t MAX_EXP = 6;
-static constexpr float MAX_EXP_FLT = static_cast<float>(MAX_EXP);
+static constexpr auto PARAMS_UPDATE_INTERVAL = std::chrono::milliseconds{100};
+
+// Text is read ahead by that many tokens, ids of a batch are looked up together, see
+// `vocab::Vocabulary::IDs`.
+static constexpr uint32_t TOKENS_BATCH_SIZE = 64;
+
+// Input is cut into about `CHUNKS_PER_THREAD * thread_count` chunks, but not smaller than
+// `MIN_*_CHUNK_SIZE`, so threads can balance the load without claiming chunks all the time.
+static constexpr uint32_t CHUNKS_PER_THREAD = 64;
+static constexpr uint64_t MIN_TEXT_CHUNK_SIZE = 1024 * 1024;  // 1 Mb
+static constexpr uint64_t MIN_ID_CORPUS_CHUNK_SIZE = MIN_TEXT_CHUNK_SIZE / sizeof(uint32_t);
+
+static std::unique_ptr<float, yzw2v::mem::detail::Deleter> GenerateExpTable(const uint32_t size) {
+    auto res = yzw2v::mem::AllocateFloatForSIMD(size);
+    float* const a = res.get();
+    for (auto i = uint32_t{}; i < size; ++i) {
+        a[i] = static_cast<float>(
+            std::exp((static_cast<double>(i) / size * 2 - 1) * yzw2v::num::MAX_EXP)
+        );
+        a[i] = a[i] / (a[i] + 1);
+    }
+
+    return res;
+}
 
 namespace {
+    /* Read-only for trainers, everything they modify lives in `ThreadProgress` or in the matrices.
+     * In NUMA mode there is one copy per node, built by a thread running on that node, so pages
+     * of the tables are local to the trainers of the node; matrices are shared.
+     */
     struct SharedData {
         const yzw2v::sampling::UnigramDistribution unigram_distribution;
 
+        const std::unique_ptr<float, yzw2v::mem::detail::Deleter> exp_table_holder;
         const float* const exp_table;
+
+        const std::unique_ptr<const yzw2v::huff::HuffmanTree> huffman_tree_holder;  // if copied
+        const yzw2v::huff::HuffmanTree& huffman_tree;
+
         yzw2v::num::Matrix* const syn0;
         yzw2v::num::Matrix* const syn1hs;
         yzw2v::num::Matrix* const syn1neg;
 
         const uint64_t text_words_count_;
-        uint64_t processed_words_count;
-        float alpha;
-        decltype(std::chrono::high_resolution_clock::now()) start_time;
 
-        SharedData(const float alpha_,
-                   yzw2v::num::Matrix* const syn0_,
+        SharedData(yzw2v::num::Matrix* const syn0_,
                    yzw2v::num::Matrix* const syn1hs_,
                    yzw2v::num::Matrix* const syn1neg_,
-                   const float* const exp_table_,
-                   const yzw2v::vocab::Vocabulary& vocab)
+                   const yzw2v::vocab::Vocabulary& vocab,
+                   const yzw2v::huff::HuffmanTree& huffman_tree_,
+                   const bool copy_huffman_tree)
             : unigram_distribution{vocab}
-            , exp_table{exp_table_}
+            , exp_table_holder{GenerateExpTable(yzw2v::num::EXP_TABLE_SIZE)}
+            , exp_table{exp_table_holder.get()}
+            , huffman_tree_holder{copy_huffman_tree ? new yzw2v::huff::HuffmanTree{vocab} : nullptr}
+            , huffman_tree{copy_huffman_tree ? *huffman_tree_holder : huffman_tree_}
             , syn0{syn0_}
             , syn1hs{syn1hs_}
             , syn1neg{syn1neg_}
             , text_words_count_{vocab.TextWordCount()}
-            , processed_words_count{}
-            , alpha{alpha_}
-            , start_time{std::chrono::high_resolution_clock::now()}
         {
         }
     };
 } // namespace
 
-static std::chrono::seconds GetTimePassed(const SharedData& data) noexcept {
-    return std::chrono::duration_cast<std::chrono::seconds>(
-        std::chrono::high_resolution_clock::now() - data.start_time
-    );
-}
-
-static void Report(const float alpha, const uint64_t words_processed_count,
-                   const uint64_t text_words_count, const uint32_t iterations_requested_for_model,
-                   const std::chrono::seconds seconds_passed) {
-    const auto progress = static_cast<double>(words_processed_count) // possible overflow
-                          / (text_words_count * iterations_requested_for_model)
-                          * 100;
-    const auto words_per_sec = static_cast<double>(words_processed_count)
-                               / (seconds_passed.count() + 1)
-                               / 1000;
+static float ComputeAlpha(const yzw2v::train::Params& params,
+                          const uint64_t processed_words_count,
+                          const uint64_t text_words_count) noexcept {
+    auto alpha = params.starting_alpha
+                 - (params.starting_alpha - params.final_alpha)
+                   * (static_cast<float>(processed_words_count)
+                      / (text_words_count * params.iterations_count + 1)
+                   );
+    const auto min_alpha = std::max(params.final_alpha, params.starting_alpha * 0.0001f);
+    if (alpha < min_alpha) {
+        alpha = min_alpha;
+    }
 
-    fprintf(stdout, "%c[trainer] progress=%.6lf%% alpha=%.6f words/sec=%.2lfK  ",
-           '\r', progress, static_cast<double>(alpha), words_per_sec);
+    return alpha;
 }
 
 namespace {
+    /* Minibatch kernels work with float rows, so rows of FP16 or BF16 matrix are widened into
+     * float rows here and narrowed back by `Commit` when the minibatch is done. A row used several
+     * times by a minibatch is staged once, so all its updates add up, as they do for rows of FP32
+     * matrix, which are used in place.
+     */
+    class StagedRows {
+    public:
+        StagedRows(const uint32_t capacity, const uint32_t vector_size)
+            : rows_{capacity, vector_size}
+            , matrix_{nullptr}
+        {
+            indices_.reserve(capacity);
+        }
+
+        float* Stage(yzw2v::num::Matrix& matrix, const uint32_t index) {
+            if (yzw2v::num::Precision::FP32 == matrix.precision()) {
+                return matrix.row(index);
+            }
+
+            assert(!matrix_ || &matrix == matrix_);
+            matrix_ = &matrix;
+            const auto it = std::find(indices_.cbegin(), indices_.cend(), index);
+            const auto position = static_cast<uint32_t>(it - indices_.cbegin());
+            if (indices_.cend() == it) {
+                assert(indices_.size() < rows_.rows_count());
+                indices_.push_back(index);
+                matrix.CopyRow(index, rows_.row(position));
+            }
+
+            return rows_.row(position);
+        }
+
+        void Commit() {
+            for (auto position = uint32_t{}; position < indices_.size(); ++position) {
+                yzw2v::num::Narrow(rows_.row(position), rows_.columns_count(),
+                                   matrix_->precision(), matrix_->half_row(indices_[position]));
+            }
+
+            indices_.clear();
+        }
+
+    private:
+        yzw2v::num::Matrix rows_;
+        std::vector<uint32_t> indices_;
+        yzw2v::num::Matrix* matrix_;
+    };
+
     class ModelTrainer {
     public:
-        ModelTrainer(const std::string& text_file_path,
-                     const uint64_t text_file_offset,
-                     const uint64_t bytes_to_read_from_text_file,
+        // `owner` is the index of the trainer in `scheduler`
+        ModelTrainer(const std::string& input_path,
+                     yzw2v::train::detail::ChunkScheduler& scheduler,
+                     const uint32_t owner,
                      const yzw2v::vocab::Vocabulary& vocab,
                      const yzw2v::huff::HuffmanTree& huffman_tree,
                      const yzw2v::train::Params& params,
-                     const uint32_t seed,
-                     SharedData& shared_data)
+                     const uint64_t seed,
+                     const SharedData& shared_data,
+                     yzw2v::train::detail::ThreadProgress& progress)
             : p_{params}
             , neu1_holder_{yzw2v::mem::AllocateFloatForSIMD(params.vector_size)}
             , neu1e_holder_{yzw2v::mem::AllocateFloatForSIMD(params.vector_size)}
             , negative_samples_holder_{new NegativeSample[params.negative_samples_count + 1]}
+            , context_errors_holder_{new yzw2v::num::Matrix{2 * params.window_size, params.vector_size}}
+            , batch_hidden_holder_{new yzw2v::num::Matrix{params.cbow_batch_size, params.vector_size}}
+            , batch_errors_holder_{new yzw2v::num::Matrix{params.cbow_batch_size, params.vector_size}}
+            , context_stage_{2 * params.window_size, params.vector_size}
+            , target_stage_{std::max(params.negative_samples_count + 1, huffman_tree.MaxCodeLength()),
+                            params.vector_size}
+            , batch_stage_{params.negative_samples_count + params.cbow_batch_size, params.vector_size}
             , shared_data_{shared_data}
+            , progress_{progress}
+            , alpha_{progress.alpha.load(std::memory_order_relaxed)}
             , neu1_{neu1_holder_.get()}
             , neu1e_{neu1e_holder_.get()}
             , negative_samples_{negative_samples_holder_.get()}
@@ -105,23 +195,89 @@ namespace {
             , huff_{huffman_tree}
             , prng_{seed}
             , sentence_position_{0}
+            , processed_words_count_{progress.processed_words_count.load(std::memory_order_relaxed)}
+            , processed_bytes_count_{progress.processed_bytes_count.load(std::memory_order_relaxed)}
             , prev_word_count_{0}
             , word_count_{0}
-            , token_reader_{text_file_path, bytes_to_read_from_text_file, text_file_offset}
+            , input_path_{input_path}
+            , read_tokens_(TOKENS_BATCH_SIZE)
+            , read_buffer_{new char[TOKENS_BATCH_SIZE * yzw2v::vocab::MAX_TOKEN_LENGTH]}
+            , read_ids_(TOKENS_BATCH_SIZE)
+            , read_position_{0}
+            , read_count_{0}
+            , scheduler_{scheduler}
+            , owner_{owner}
+            , has_chunk_{false}
             , iteration_{0}
+            , chunk_{}
+            , chunk_iteration_{0}
+            , has_next_chunk_{false}
+            , next_chunk_{}
+            , next_chunk_iteration_{0}
         {
             sentence_.reserve(params.max_sentence_length);
+
+            context_rows_.resize(2 * params.window_size);
+            context_errors_.resize(2 * params.window_size);
+            for (auto i = uint32_t{}; i < 2 * params.window_size; ++i) {
+                context_errors_[i] = context_errors_holder_->row(i);
+            }
+
+            const auto max_targets_count = std::max(params.negative_samples_count + 1,
+                                                    huffman_tree.MaxCodeLength());
+            batch_hidden_.resize(params.cbow_batch_size);
+            batch_errors_.resize(params.cbow_batch_size);
+            for (auto i = uint32_t{}; i < params.cbow_batch_size; ++i) {
+                batch_hidden_[i] = batch_hidden_holder_->row(i);
+                batch_errors_[i] = batch_errors_holder_->row(i);
+            }
+
+            batch_windows_.resize(params.cbow_batch_size);
+            batch_positive_rows_.resize(params.cbow_batch_size);
+            batch_positive_gradients_.resize(params.cbow_batch_size);
+            batch_negative_targets_.resize(params.negative_samples_count);
+            batch_negative_rows_.resize(params.negative_samples_count);
+            batch_gradients_.resize(params.cbow_batch_size * params.negative_samples_count);
+            batch_gradients_transposed_.resize(params.cbow_batch_size * params.negative_samples_count);
+
+            target_rows_.resize(max_targets_count);
+            target_labels_.resize(max_targets_count);
+            gradients_.resize(2 * params.window_size * max_targets_count);
+            gradients_transposed_.resize(2 * params.window_size * max_targets_count);
         }
 
         void TrainCBOW();
+        void TrainSkipGram();
 
     private:
-        void ReportAndUpdateAlpha();
+        void SyncProgress();
         void ReadSentence();
-        void CBOWPropagateInputToHidden(const uint32_t window_begin, const uint32_t window_end);
-        void CBOWPropagateHiddenToInput(const uint32_t window_begin, const uint32_t window_end);
-        void CBOWApplyHierarchicalSoftmax();
-        void CBOWApplyNegativeSampling();
+        void ReadSentenceFromChunk();
+        uint32_t ReadTokenID();
+        bool InputDone() const noexcept;
+        uint64_t InputBytesRead() const noexcept;
+        bool NextChunk();
+        bool ClaimChunk(yzw2v::train::detail::Chunk& chunk, uint32_t& chunk_iteration);
+        void ResetInput(const yzw2v::train::detail::Chunk& chunk);
+        void CBOWPropagateInputToHidden(const uint32_t window_begin, const uint32_t window_end,
+                                        float* const neu1);
+        void CBOWPropagateHiddenToInput(const uint32_t window_begin, const uint32_t window_end,
+                                        const float* const neu1e);
+        void CBOWApplyHierarchicalSoftmax(const float* const neu1, float* const neu1e);
+        void CBOWApplyNegativeSampling(const float* const neu1, float* const neu1e);
+
+        void CBOWTrainSentenceInBatches();
+        void CBOWApplyNegativeSamplingToBatch(const uint32_t batch_begin,
+                                              const uint32_t batch_size);
+
+        uint32_t SkipGramCollectContext(const uint32_t window_begin, const uint32_t window_end);
+        void SkipGramApplyHierarchicalSoftmax(const uint32_t context_count);
+        void SkipGramApplyNegativeSampling(const uint32_t context_count);
+        void SkipGramApplyTargets(const uint32_t context_count, const uint32_t targets_count,
+                                  const bool skip_saturated);
+        void SkipGramPropagateErrorsToInput(const uint32_t context_count);
+
+        uint32_t GenerateNegativeSamples();
 
         uint32_t WindowBegin(const uint32_t window_indent) const noexcept;
         uint32_t WindowEnd(const uint32_t window_indent) const noexcept;
@@ -136,8 +292,19 @@ namespace {
         const std::unique_ptr<float, yzw2v::mem::detail::Deleter> neu1_holder_;
         const std::unique_ptr<float, yzw2v::mem::detail::Deleter> neu1e_holder_;
         const std::unique_ptr<NegativeSample[]> negative_samples_holder_;
-
-        SharedData& shared_data_;
+        const std::unique_ptr<yzw2v::num::Matrix> context_errors_holder_;
+        const std::unique_ptr<yzw2v::num::Matrix> batch_hidden_holder_;
+        const std::unique_ptr<yzw2v::num::Matrix> batch_errors_holder_;
+
+        // float copies of half precision rows for skip-gram context, skip-gram targets and CBOW
+        // minibatch
+        StagedRows context_stage_;
+        StagedRows target_stage_;
+        StagedRows batch_stage_;
+
+        const SharedData& shared_data_;
+        yzw2v::train::detail::ThreadProgress& progress_;
+        float alpha_;  // snapshot of `progress_.alpha`
         float* const neu1_;
         float* const neu1e_;
         NegativeSample* const negative_samples_;
@@ -150,22 +317,67 @@ namespace {
         std::vector<uint32_t> sentence_;
         uint32_t sentence_position_;
 
+        // skip-gram minibatch: rows of `syn0` for context words of the window and rows of output
+        // layer they are trained against
+        std::vector<float*> context_rows_;
+        std::vector<float*> context_errors_;
+        std::vector<float*> target_rows_;
+        std::vector<float> target_labels_;
+        std::vector<float> gradients_;
+        std::vector<float> gradients_transposed_;
+
+        // CBOW minibatch: consecutive positions of the sentence sharing one set of negative samples
+        std::vector<float*> batch_hidden_;
+        std::vector<float*> batch_errors_;
+        std::vector<std::pair<uint32_t, uint32_t>> batch_windows_;
+        std::vector<float*> batch_positive_rows_;
+        std::vector<float> batch_positive_gradients_;
+        std::vector<uint32_t> batch_negative_targets_;
+        std::vector<float*> batch_negative_rows_;
+        std::vector<float> batch_gradients_;
+        std::vector<float> batch_gradients_transposed_;
+
+        uint64_t processed_words_count_;  // over all iterations
+        uint64_t processed_bytes_count_;  // over all finished chunks
         uint64_t prev_word_count_;
-        uint64_t word_count_;
-
-        yzw2v::io::TokenReader token_reader_;
-        uint32_t iteration_;
+        uint64_t word_count_;  // in current chunk
+
+        // at most one of them is set, reader is created for the first chunk and then reused
+        const std::string& input_path_;
+        std::unique_ptr<yzw2v::io::TokenReader> token_reader_;
+        std::unique_ptr<yzw2v::io::IDReader> id_reader_;
+
+        // ids of tokens read ahead from `token_reader_`, `read_position_` is the next one
+        std::vector<yzw2v::vocab::Token> read_tokens_;
+        const std::unique_ptr<char[]> read_buffer_;
+        std::vector<uint32_t> read_ids_;
+        uint32_t read_position_;
+        uint32_t read_count_;
+
+        yzw2v::train::detail::ChunkScheduler& scheduler_;
+        const uint32_t owner_;
+        bool has_chunk_;
+        uint32_t iteration_;  // `p_.iterations_count` when there is nothing left to train
+        yzw2v::train::detail::Chunk chunk_;
+        uint32_t chunk_iteration_;
+
+        // With async reading the next chunk is claimed in advance, so its first blocks are read
+        // while the end of the current one is being trained on.
+        bool has_next_chunk_;
+        yzw2v::train::detail::Chunk next_chunk_;
+        uint32_t next_chunk_iteration_;
     };
 }  // namespace
 
 void ModelTrainer::TrainCBOW() {
-    for (ReadSentence(); iteration_ < p_.iterations_count; ReadSentence()) {
+    // sentence is empty only when there is nothing left to train
+    for (ReadSentence(); !sentence_.empty(); ReadSentence()) {
         if (word_count_ - prev_word_count_ > PER_THREAD_WORD_COUNT_TO_UPDATE_PARAMS) {
-            ReportAndUpdateAlpha();
+            SyncProgress();
         }
 
-        if (sentence_.empty()) {
-            // can be empty only when iteration is over
+        if (p_.cbow_batch_size > 1) {
+            CBOWTrainSentenceInBatches();
             continue;
         }
 
@@ -177,41 +389,42 @@ void ModelTrainer::TrainCBOW() {
             yzw2v::num::Zeroize(neu1_, p_.vector_size);
             yzw2v::num::Zeroize(neu1e_, p_.vector_size);
 
-            CBOWPropagateInputToHidden(window_begin, window_end);
+            CBOWPropagateInputToHidden(window_begin, window_end, neu1_);
             if (p_.use_hierarchical_softmax) {
-                CBOWApplyHierarchicalSoftmax();
+                CBOWApplyHierarchicalSoftmax(neu1_, neu1e_);
             }
 
             if (p_.negative_samples_count) {
-                CBOWApplyNegativeSampling();
+                CBOWApplyNegativeSampling(neu1_, neu1e_);
             }
 
-            CBOWPropagateHiddenToInput(window_begin, window_end);
+            CBOWPropagateHiddenToInput(window_begin, window_end, neu1e_);
         }
     }
 }
 
-void ModelTrainer::ReportAndUpdateAlpha() {
-    shared_data_.processed_words_count += word_count_ - prev_word_count_;
+void ModelTrainer::SyncProgress() {
+    processed_words_count_ += word_count_ - prev_word_count_;
     prev_word_count_ = word_count_;
-    Report(shared_data_.alpha, shared_data_.processed_words_count, shared_data_.text_words_count_,
-            p_.iterations_count, GetTimePassed(shared_data_));
-
-    auto new_alpha = p_.starting_alpha
-                     * (1 - static_cast<float>(shared_data_.processed_words_count)
-                            / (shared_data_.text_words_count_ * p_.iterations_count + 1)
-                       );
-    if (new_alpha < p_.starting_alpha * 0.0001f) {
-        new_alpha = p_.starting_alpha * 0.0001f;
-    }
-
-    shared_data_.alpha = new_alpha;
+    progress_.processed_words_count.store(processed_words_count_, std::memory_order_relaxed);
+    progress_.processed_bytes_count.store(processed_bytes_count_ + InputBytesRead(),
+                                          std::memory_order_relaxed);
+    alpha_ = progress_.alpha.load(std::memory_order_relaxed);
 }
 
 void ModelTrainer::ReadSentence() {
     sentence_.clear();
-    while (!token_reader_.Done()) {
-        const auto token_id = vocab_.ID(token_reader_.Read());
+    sentence_position_ = 0;
+
+    // sentences never span chunks, every chunk ends with a paragraph
+    while (sentence_.empty() && (!InputDone() || NextChunk())) {
+        ReadSentenceFromChunk();
+    }
+}
+
+void ModelTrainer::ReadSentenceFromChunk() {
+    while (!InputDone()) {
+        const auto token_id = ReadTokenID();
         if (yzw2v::vocab::INVALID_TOKEN_ID == token_id) {
             continue;
         }
@@ -242,119 +455,399 @@ void ModelTrainer::ReadSentence() {
             break;
         }
     }
+}
 
-    sentence_position_ = 0;
+bool ModelTrainer::NextChunk() {
+    SyncProgress();
+    processed_bytes_count_ += InputBytesRead();
+    if (has_chunk_) {
+        // counters go first, so checkpoint never has a chunk completed but not counted
+        progress_.committed_words_count.store(processed_words_count_, std::memory_order_relaxed);
+        progress_.committed_bytes_count.store(processed_bytes_count_, std::memory_order_relaxed);
+        progress_.committed_prng_state.store(prng_.state(), std::memory_order_relaxed);
+        scheduler_.Complete(chunk_iteration_, chunk_.index);
+    }
+
+    word_count_ = 0;
+    prev_word_count_ = 0;
+    has_chunk_ = false;
+
+    if (has_next_chunk_) {
+        chunk_ = next_chunk_;
+        chunk_iteration_ = next_chunk_iteration_;
+        has_next_chunk_ = false;
+    } else if (!ClaimChunk(chunk_, chunk_iteration_)) {
+        return false;
+    }
+
+    ResetInput(chunk_);
+    if (!p_.input_is_id_corpus && yzw2v::io::ReadMode::ASYNC == p_.read_options.mode
+        && ClaimChunk(next_chunk_, next_chunk_iteration_)) {
+        has_next_chunk_ = true;
+        token_reader_->Prefetch(next_chunk_.size, next_chunk_.offset);
+    }
+
+    return true;
+}
+
+bool ModelTrainer::ClaimChunk(yzw2v::train::detail::Chunk& chunk, uint32_t& chunk_iteration) {
+    for (; iteration_ < p_.iterations_count; ++iteration_) {
+        progress_.iteration.store(iteration_, std::memory_order_relaxed);
+        if (scheduler_.Claim(owner_, iteration_, chunk)) {
+            chunk_iteration = iteration_;
+            return true;
+        }
+    }
+
+    progress_.iteration.store(iteration_, std::memory_order_relaxed);
+    return false;
+}
+
+uint32_t ModelTrainer::ReadTokenID() {
+    if (id_reader_) {
+        return id_reader_->Read();
+    }
+
+    if (read_position_ == read_count_) {
+        read_count_ = token_reader_->Read(read_tokens_.data(), TOKENS_BATCH_SIZE,
+                                          read_buffer_.get());
+        vocab_.IDs(read_tokens_.data(), read_count_, read_ids_.data());
+        read_position_ = 0;
+    }
+
+    return read_ids_[read_position_++];
+}
+
+bool ModelTrainer::InputDone() const noexcept {
+    if (!has_chunk_) {
+        return true;
+    }
+
+    return id_reader_ ? id_reader_->Done()
+                      : read_position_ == read_count_ && token_reader_->Done();
+}
 
-    if (token_reader_.Done()) {
-        shared_data_.processed_words_count += word_count_ - prev_word_count_;
-        ++iteration_;
+uint64_t ModelTrainer::InputBytesRead() const noexcept {
+    if (!has_chunk_) {
+        return 0;
+    }
 
-        word_count_ = 0;
-        prev_word_count_ = 0;
-        sentence_.clear();
-        sentence_position_ = 0;
-        token_reader_.Restart();
+    return id_reader_ ? id_reader_->BytesRead() : token_reader_->BytesRead();
+}
+
+void ModelTrainer::ResetInput(const yzw2v::train::detail::Chunk& chunk) {
+    has_chunk_ = true;
+    read_position_ = 0;
+    read_count_ = 0;
+    if (p_.input_is_id_corpus) {
+        if (id_reader_) {
+            id_reader_->Reset(chunk.size, chunk.offset);
+        } else {
+            id_reader_.reset(new yzw2v::io::IDReader{input_path_, chunk.size, chunk.offset});
+        }
+    } else if (token_reader_) {
+        token_reader_->Reset(chunk.size, chunk.offset);
+    } else {
+        token_reader_.reset(new yzw2v::io::TokenReader{input_path_, chunk.size, chunk.offset,
+                                                       p_.read_options});
     }
 }
 
 void ModelTrainer::CBOWPropagateInputToHidden(const uint32_t window_begin,
-                                              const uint32_t window_end)
+                                              const uint32_t window_end,
+                                              float* const neu1)
 {
     assert(window_begin < window_end);
+    const auto& syn0 = *shared_data_.syn0;
     for (auto index = window_begin; index < window_end; ++index) {
         if (sentence_position_ == index) {
             continue;
         }
 
-        yzw2v::num::AddVector(neu1_, p_.vector_size, shared_data_.syn0->row(sentence_[index]));
+        if (yzw2v::num::Precision::FP32 == syn0.precision()) {
+            yzw2v::num::AddVector(neu1, p_.vector_size, syn0.row(sentence_[index]));
+        } else {
+            yzw2v::num::AddVector(neu1, p_.vector_size, syn0.half_row(sentence_[index]),
+                                  syn0.precision());
+        }
     }
 
-    yzw2v::num::MultiplyVector(neu1_, p_.vector_size, 1.0f / (window_end - window_begin));
+    yzw2v::num::MultiplyVector(neu1, p_.vector_size, 1.0f / (window_end - window_begin));
 }
 
-void ModelTrainer::CBOWApplyHierarchicalSoftmax() {
+void ModelTrainer::CBOWApplyHierarchicalSoftmax(const float* const neu1, float* const neu1e) {
     const auto token = huff_.Tokens()[sentence_[sentence_position_]];
     for (auto index = uint32_t{}; index < token.length; ++index) {
-        auto* const syn1hs_row = shared_data_.syn1hs->row(token.point[index]);
-        auto f = yzw2v::num::ScalarProduct(neu1_, p_.vector_size, syn1hs_row);
+        yzw2v::num::HierarchicalSoftmaxUpdate(neu1, neu1e,
+                                              shared_data_.syn1hs->row(token.point[index]),
+                                              p_.vector_size, 1.0f - token.code[index],
+                                              alpha_, shared_data_.exp_table);
+    }
+}
 
-        if (f <= -MAX_EXP_FLT || f >= MAX_EXP_FLT) {
+uint32_t ModelTrainer::GenerateNegativeSamples() {
+    const auto cur_token = sentence_[sentence_position_];
+    negative_samples_[0] = {cur_token, 1.0f};
+    auto res = uint32_t{1};
+    for (auto i = uint32_t{}; i < p_.negative_samples_count; ++i) {
+        const auto target = shared_data_.unigram_distribution(prng_);
+        if (cur_token == target) {
             continue;
-        } else {
-            const auto exp_index = static_cast<uint32_t>(
-                (f + MAX_EXP_FLT) * (EXP_TABLE_SIZE / MAX_EXP / 2)
-            );
-            f = shared_data_.exp_table[exp_index];
         }
 
-        const auto g = (1.0f - token.code[index] - f) * shared_data_.alpha;
-        yzw2v::num::AddVector(neu1e_, p_.vector_size, syn1hs_row, g);
-        yzw2v::num::AddVector(syn1hs_row, p_.vector_size, neu1e_, g);
+        negative_samples_[res++] = {target, 0.0f};
     }
+
+    return res;
 }
 
-void ModelTrainer::CBOWApplyNegativeSampling() {
-    const auto negative_samples_count = [this]{
-        const auto cur_token = sentence_[sentence_position_];
-        negative_samples_[0] = {cur_token, 1.0f};
-        auto res = uint32_t{1};
-        for (auto i = uint32_t{}; i < p_.negative_samples_count; ++i) {
-            const auto target = shared_data_.unigram_distribution(prng_);
-            if (cur_token == target) {
-                continue;
+void ModelTrainer::CBOWApplyNegativeSampling(const float* const neu1, float* const neu1e) {
+    const auto negative_samples_count = GenerateNegativeSamples();
+
+    auto& syn1neg = *shared_data_.syn1neg;
+    const auto is_fp32 = yzw2v::num::Precision::FP32 == syn1neg.precision();
+    const auto* const negative_samples_end = negative_samples_ + negative_samples_count;
+    for (const auto* sample = negative_samples_; sample < negative_samples_end; ++sample) {
+        const auto* const next_sample = sample + 1;
+        if (next_sample < negative_samples_end) {
+            if (next_sample->target != sample->target) {
+                if (is_fp32) {
+                    yzw2v::num::Prefetch(syn1neg.row(next_sample->target));
+                } else {
+                    yzw2v::num::Prefetch(syn1neg.half_row(next_sample->target));
+                }
             }
+        }
 
-            negative_samples_[res++] = {target, 0.0f};
+        if (is_fp32) {
+            yzw2v::num::NegativeSamplingUpdate(neu1, neu1e, syn1neg.row(sample->target),
+                                               p_.vector_size, sample->label, alpha_,
+                                               shared_data_.exp_table);
+        } else {
+            yzw2v::num::NegativeSamplingUpdate(neu1, neu1e, syn1neg.half_row(sample->target),
+                                               syn1neg.precision(), p_.vector_size,
+                                               sample->label, alpha_, shared_data_.exp_table);
         }
+    }
+}
 
-        return res;
-    }();
+void ModelTrainer::CBOWTrainSentenceInBatches() {
+    const auto sentence_size = static_cast<uint32_t>(sentence_.size());
+    for (auto batch_begin = uint32_t{}; batch_begin < sentence_size; batch_begin += p_.cbow_batch_size) {
+        const auto batch_size = std::min(p_.cbow_batch_size, sentence_size - batch_begin);
+        for (auto i = uint32_t{}; i < batch_size; ++i) {
+            sentence_position_ = batch_begin + i;
+            const auto window_indent = static_cast<uint32_t>(prng_() % p_.window_size);
+            batch_windows_[i] = {WindowBegin(window_indent), WindowEnd(window_indent)};
 
+            yzw2v::num::Zeroize(batch_hidden_[i], p_.vector_size);
+            yzw2v::num::Zeroize(batch_errors_[i], p_.vector_size);
+            CBOWPropagateInputToHidden(batch_windows_[i].first, batch_windows_[i].second,
+                                       batch_hidden_[i]);
+        }
 
-    const auto* const negative_samples_end = negative_samples_ + negative_samples_count;
-    for (const auto* sample = negative_samples_; sample < negative_samples_end; ++sample) {
-        auto* const syn1neg_row = shared_data_.syn1neg->row(sample->target);
-        const auto f = yzw2v::num::ScalarProduct(neu1_, p_.vector_size, syn1neg_row);
-
-        auto g = float{};
-        if (f > MAX_EXP_FLT) {
-            g = sample->label - 1.0f;
-        } else if (f < -MAX_EXP_FLT) {
-            g = sample->label - 0.0f;
-        } else {
-            const auto exp_index = static_cast<uint32_t>(
-                    (f + MAX_EXP_FLT) * (EXP_TABLE_SIZE / MAX_EXP / 2)
-                    );
-            g = sample->label - shared_data_.exp_table[exp_index];
+        if (p_.use_hierarchical_softmax) {
+            for (auto i = uint32_t{}; i < batch_size; ++i) {
+                sentence_position_ = batch_begin + i;
+                CBOWApplyHierarchicalSoftmax(batch_hidden_[i], batch_errors_[i]);
+            }
         }
 
-        g *= shared_data_.alpha;
+        if (p_.negative_samples_count) {
+            CBOWApplyNegativeSamplingToBatch(batch_begin, batch_size);
+        }
 
-        const auto* const next_sample = sample + 1;
-        if (next_sample < negative_samples_end) {
-            if (next_sample->target != sample->target) {
-                yzw2v::num::Prefetch(shared_data_.syn1neg->row(next_sample->target));
-            }
+        for (auto i = uint32_t{}; i < batch_size; ++i) {
+            sentence_position_ = batch_begin + i;
+            CBOWPropagateHiddenToInput(batch_windows_[i].first, batch_windows_[i].second,
+                                       batch_errors_[i]);
+        }
+    }
+}
+
+void ModelTrainer::CBOWApplyNegativeSamplingToBatch(const uint32_t batch_begin,
+                                                    const uint32_t batch_size)
+{
+    const auto negatives_count = p_.negative_samples_count;
+    for (auto i = uint32_t{}; i < negatives_count; ++i) {
+        batch_negative_targets_[i] = shared_data_.unigram_distribution(prng_);
+        batch_negative_rows_[i] = batch_stage_.Stage(*shared_data_.syn1neg,
+                                                     batch_negative_targets_[i]);
+    }
+
+    for (auto i = uint32_t{}; i < batch_size; ++i) {
+        batch_positive_rows_[i] = batch_stage_.Stage(*shared_data_.syn1neg,
+                                                     sentence_[batch_begin + i]);
+        const auto f = yzw2v::num::ScalarProduct(
+            batch_hidden_[i], p_.vector_size, batch_positive_rows_[i]);
+        batch_positive_gradients_[i] = alpha_
+            * yzw2v::num::NegativeSamplingGradient(f, 1.0f, shared_data_.exp_table);
+    }
+
+    yzw2v::num::ScalarProducts(batch_hidden_.data(), batch_size,
+                               batch_negative_rows_.data(), negatives_count,
+                               p_.vector_size, batch_gradients_.data());
+    for (auto i = uint32_t{}; i < batch_size; ++i) {
+        const auto cur_token = sentence_[batch_begin + i];
+        for (auto j = uint32_t{}; j < negatives_count; ++j) {
+            const auto f = batch_gradients_[i * negatives_count + j];
+            const auto g = cur_token == batch_negative_targets_[j]
+                ? 0.0f  // the same as dropping this negative sample for this position
+                : alpha_ * yzw2v::num::NegativeSamplingGradient(f, 0.0f, shared_data_.exp_table);
+            batch_gradients_[i * negatives_count + j] = g;
+            batch_gradients_transposed_[j * batch_size + i] = g;
         }
+    }
 
-        yzw2v::num::AddVector(neu1e_, p_.vector_size, syn1neg_row, g);
-        yzw2v::num::AddVector(syn1neg_row, p_.vector_size, neu1_, g);
+    // errors must be computed before output layer is updated
+    yzw2v::num::AddVectors(batch_errors_.data(), batch_size,
+                           batch_negative_rows_.data(), negatives_count,
+                           p_.vector_size, batch_gradients_.data());
+    for (auto i = uint32_t{}; i < batch_size; ++i) {
+        yzw2v::num::AddVector(batch_errors_[i], p_.vector_size, batch_positive_rows_[i],
+                              batch_positive_gradients_[i]);
     }
+
+    yzw2v::num::AddVectors(batch_negative_rows_.data(), negatives_count,
+                           batch_hidden_.data(), batch_size,
+                           p_.vector_size, batch_gradients_transposed_.data());
+    for (auto i = uint32_t{}; i < batch_size; ++i) {
+        yzw2v::num::AddVector(batch_positive_rows_[i], p_.vector_size, batch_hidden_[i],
+                              batch_positive_gradients_[i]);
+    }
+
+    batch_stage_.Commit();
 }
 
 void ModelTrainer::CBOWPropagateHiddenToInput(const uint32_t window_begin,
-                                              const uint32_t window_end)
+                                              const uint32_t window_end,
+                                              const float* const neu1e)
 {
     assert(window_begin < window_end);
+    auto& syn0 = *shared_data_.syn0;
     for (auto index = window_begin; index < window_end; ++index) {
         if (sentence_position_ == index) {
             continue;
         }
 
-        yzw2v::num::AddVector(shared_data_.syn0->row(sentence_[index]), p_.vector_size, neu1e_);
+        if (yzw2v::num::Precision::FP32 == syn0.precision()) {
+            yzw2v::num::AddVector(syn0.row(sentence_[index]), p_.vector_size, neu1e);
+        } else {
+            yzw2v::num::AddVector(syn0.half_row(sentence_[index]), syn0.precision(),
+                                  p_.vector_size, neu1e);
+        }
     }
 }
 
+void ModelTrainer::TrainSkipGram() {
+    // sentence is empty only when there is nothing left to train
+    for (ReadSentence(); !sentence_.empty(); ReadSentence()) {
+        if (word_count_ - prev_word_count_ > PER_THREAD_WORD_COUNT_TO_UPDATE_PARAMS) {
+            SyncProgress();
+        }
+
+        for (sentence_position_ = 0; sentence_position_ < sentence_.size(); ++sentence_position_) {
+            const auto window_indent = static_cast<uint32_t>(prng_() % p_.window_size);
+            const auto window_begin = WindowBegin(window_indent);
+            const auto window_end = WindowEnd(window_indent);
+
+            const auto context_count = SkipGramCollectContext(window_begin, window_end);
+            if (!context_count) {
+                continue;
+            }
+
+            if (p_.use_hierarchical_softmax) {
+                SkipGramApplyHierarchicalSoftmax(context_count);
+            }
+
+            if (p_.negative_samples_count) {
+                SkipGramApplyNegativeSampling(context_count);
+            }
+
+            SkipGramPropagateErrorsToInput(context_count);
+        }
+    }
+}
+
+uint32_t ModelTrainer::SkipGramCollectContext(const uint32_t window_begin,
+                                              const uint32_t window_end)
+{
+    auto context_count = uint32_t{};
+    for (auto index = window_begin; index < window_end; ++index) {
+        if (sentence_position_ == index) {
+            continue;
+        }
+
+        context_rows_[context_count] = context_stage_.Stage(*shared_data_.syn0, sentence_[index]);
+        yzw2v::num::Zeroize(context_errors_[context_count], p_.vector_size);
+        ++context_count;
+    }
+
+    return context_count;
+}
+
+void ModelTrainer::SkipGramApplyHierarchicalSoftmax(const uint32_t context_count) {
+    const auto token = huff_.Tokens()[sentence_[sentence_position_]];
+    for (auto index = uint32_t{}; index < token.length; ++index) {
+        target_rows_[index] = shared_data_.syn1hs->row(token.point[index]);
+        target_labels_[index] = 1.0f - token.code[index];
+    }
+
+    SkipGramApplyTargets(context_count, token.length, true);
+}
+
+void ModelTrainer::SkipGramApplyNegativeSampling(const uint32_t context_count) {
+    const auto negative_samples_count = GenerateNegativeSamples();
+    for (auto index = uint32_t{}; index < negative_samples_count; ++index) {
+        target_rows_[index] = target_stage_.Stage(*shared_data_.syn1neg,
+                                                  negative_samples_[index].target);
+        target_labels_[index] = negative_samples_[index].label;
+    }
+
+    SkipGramApplyTargets(context_count, negative_samples_count, false);
+    target_stage_.Commit();
+}
+
+void ModelTrainer::SkipGramApplyTargets(const uint32_t context_count,
+                                        const uint32_t targets_count,
+                                        const bool skip_saturated)
+{
+    // All context words are trained against the same targets, so instead of doing
+    // `context_count * targets_count` scalar products and pairs of vector additions one by one we
+    // do three small matrix products while all rows are still in L1.
+    yzw2v::num::ScalarProducts(context_rows_.data(), context_count,
+                               target_rows_.data(), targets_count,
+                               p_.vector_size, gradients_.data());
+
+    for (auto i = uint32_t{}; i < context_count; ++i) {
+        for (auto j = uint32_t{}; j < targets_count; ++j) {
+            const auto f = gradients_[i * targets_count + j];
+            const auto label = target_labels_[j];
+            const auto g = alpha_ * (skip_saturated
+                ? yzw2v::num::HierarchicalSoftmaxGradient(f, label, shared_data_.exp_table)
+                : yzw2v::num::NegativeSamplingGradient(f, label, shared_data_.exp_table));
+            gradients_[i * targets_count + j] = g;
+            gradients_transposed_[j * context_count + i] = g;
+        }
+    }
+
+    // errors must be computed before output layer is updated
+    yzw2v::num::AddVectors(context_errors_.data(), context_count,
+                           target_rows_.data(), targets_count,
+                           p_.vector_size, gradients_.data());
+    yzw2v::num::AddVectors(target_rows_.data(), targets_count,
+                           context_rows_.data(), context_count,
+                           p_.vector_size, gradients_transposed_.data());
+}
+
+void ModelTrainer::SkipGramPropagateErrorsToInput(const uint32_t context_count) {
+    for (auto i = uint32_t{}; i < context_count; ++i) {
+        yzw2v::num::AddVector(context_rows_[i], p_.vector_size, context_errors_[i]);
+    }
+
+    context_stage_.Commit();
+}
+
 uint32_t ModelTrainer::WindowBegin(const uint32_t window_indent) const noexcept {
     if (sentence_position_ + window_indent < p_.window_size) {
         return uint32_t{};
@@ -371,90 +864,410 @@ uint32_t ModelTrainer::WindowEnd(const uint32_t window_indent) const noexcept {
     return sentence_position_ + p_.window_size - window_indent + 1;
 }
 
-static void InitializeMatrix(yzw2v::num::Matrix& matrix, yzw2v::sampling::PRNG& prng) noexcept {
+// Half precision matrix gets the same values as FP32 one, rounded.
+static void InitializeMatrix(yzw2v::num::Matrix& matrix, yzw2v::sampling::PRNG& prng) {
+    const auto is_fp32 = yzw2v::num::Precision::FP32 == matrix.precision();
+    const auto buffer = yzw2v::mem::AllocateFloatForSIMD(matrix.columns_count());
     for (auto i = uint32_t{}; i < matrix.rows_count(); ++i) {
-        auto* const row = matrix.row(i);
+        auto* const row = is_fp32 ? matrix.row(i) : buffer.get();
         for (auto j = uint32_t{}; j < matrix.columns_count(); ++j) {
             row[j] = static_cast<float>((prng.real_0_inc_1_inc() - 0.5) / matrix.columns_count());
         }
+
+        if (!is_fp32) {
+            yzw2v::num::Narrow(row, matrix.columns_count(), matrix.precision(), matrix.half_row(i));
+        }
     }
 }
 
-static std::unique_ptr<float[]> GenerateExpTable(const uint32_t size) {
-    std::unique_ptr<float[]> res{new float[size]};
-    float* const a = res.get();
-    for (auto i = uint32_t{}; i < size; ++i) {
-        a[i] = static_cast<float>(std::exp((static_cast<double>(i) / size * 2 - 1) * MAX_EXP));
-        a[i] = a[i] / (a[i] + 1);
+// Rows of words that are in the model at `path` are replaced with rows of the model.
+static void WarmStart(yzw2v::num::Matrix& matrix, const yzw2v::vocab::Vocabulary& vocab,
+                      const std::string& path, const char* const name) {
+    const yzw2v::query::Model model{path, false};
+    if (model.columns_count() != matrix.columns_count()) {
+        throw std::runtime_error{"vector size of model doesn't match: " + path};
     }
 
-    return res;
+    auto found_count = uint32_t{};
+    for (auto i = uint32_t{}; i < matrix.rows_count(); ++i) {
+        const auto id = model.vocab().ID(vocab.Token(i).token);
+        if (yzw2v::vocab::INVALID_TOKEN_ID == id) {
+            continue;
+        }
+
+        const auto* const row = model.matrix().row(id);
+        if (yzw2v::num::Precision::FP32 == matrix.precision()) {
+            std::memcpy(matrix.row(i), row, sizeof(float) * matrix.columns_count());
+        } else {
+            yzw2v::num::Narrow(row, matrix.columns_count(), matrix.precision(),
+                               matrix.half_row(i));
+        }
+
+        ++found_count;
+    }
+
+    std::clog << "Warm start: " << name << " has " << found_count << " of " << matrix.rows_count()
+              << " words from " << path << std::endl;
 }
 
 static void Zeroize(yzw2v::num::Matrix& matrix) noexcept {
+    if (yzw2v::num::Precision::FP32 != matrix.precision()) {
+        // zero bits are zero in any format
+        std::memset(matrix.data(), 0, matrix.bytes_count());
+        return;
+    }
+
     for (uint32_t i = uint32_t{}; i < matrix.rows_count(); ++i) {
         yzw2v::num::Zeroize(matrix.row(i), matrix.columns_count());
     }
 }
 
-yzw2v::train::Model yzw2v::train::TrainCBOWModel(const std::string& path,
-                                                 const vocab::Vocabulary& vocab,
-                                                 const huff::HuffmanTree& huffman_tree,
-                                                 const Params& params,
-                                                 const uint32_t thread_count) {
-    const auto syn1hs_holder = [&params, &vocab]() -> std::unique_ptr<num::Matrix> {
+// Matrices and tables are already touched at this point, so their pages are in place.
+static void ReportHugePages() {
+    static constexpr uint64_t MB = 1024 * 1024;
+    const auto stats = yzw2v::mem::GetHugePagesStats();
+    std::clog << "Huge pages: " << (stats.explicit_bytes + stats.transparent_bytes) / MB
+              << " Mb of " << stats.large_bytes / MB << " Mb in large allocations (explicit "
+              << stats.explicit_bytes / MB << " Mb, transparent " << stats.transparent_bytes / MB
+              << " Mb)" << std::endl;
+}
+
+// Trainer `i` runs on node `i % nodes.size()`, trainers of one node get different CPUs of it.
+static std::vector<uint32_t> AssignTrainersToCPUs(const std::vector<yzw2v::numa::Node>& nodes,
+                                                  const uint32_t thread_count) {
+    auto res = std::vector<uint32_t>(thread_count);
+    for (auto job_index = uint32_t{}; job_index < thread_count; ++job_index) {
+        const auto& cpus = nodes[job_index % nodes.size()].cpus;
+        res[job_index] = cpus[(job_index / nodes.size()) % cpus.size()];
+    }
+
+    return res;
+}
+
+static std::vector<uint32_t> NodeIDs(const std::vector<yzw2v::numa::Node>& nodes) {
+    auto res = std::vector<uint32_t>{};
+    for (const auto& node : nodes) {
+        res.push_back(node.id);
+    }
+
+    return res;
+}
+
+static void ReportNodes(const std::vector<yzw2v::numa::Node>& nodes) {
+    std::clog << "NUMA: " << nodes.size() << " node(s):";
+    for (const auto& node : nodes) {
+        std::clog << " node " << node.id << " (cpus " << yzw2v::numa::FormatList(node.cpus) << ")";
+    }
+
+    std::clog << std::endl;
+}
+
+// Rows are accessed at random by all trainers, so matrix pages are spread evenly over nodes.
+static void InterleaveMatrices(const std::vector<yzw2v::num::Matrix*>& matrices,
+                               const std::vector<yzw2v::numa::Node>& nodes) {
+    if (nodes.size() < 2) {
+        std::clog << "NUMA: single node, matrices stay where they are" << std::endl;
+        return;
+    }
+
+    auto size = size_t{};
+    auto ok = true;
+    for (auto* const matrix : matrices) {
+        if (!matrix) {
+            continue;
+        }
+
+        const auto matrix_size = matrix->bytes_count();
+        ok = yzw2v::numa::InterleaveMemory(matrix->data(), matrix_size, nodes) && ok;
+        size += matrix_size;
+    }
+
+    std::clog << "NUMA: " << (ok ? "" : "failed to ") << "interleave matrices ("
+              << size / (1024 * 1024) << " Mb) over nodes "
+              << yzw2v::numa::FormatList(NodeIDs(nodes)) << std::endl;
+}
+
+static void ReportTrainersPlacement(const std::vector<yzw2v::numa::Node>& nodes,
+                                    const std::vector<uint32_t>& trainer_cpus,
+                                    const bool huffman_tree_is_copied) {
+    std::clog << "NUMA: unigram table, exp table" << (huffman_tree_is_copied ? ", Huffman tree" : "")
+              << " replicated on nodes " << yzw2v::numa::FormatList(NodeIDs(nodes)) << std::endl;
+    std::clog << "NUMA: trainer -> cpu (node):";
+    for (auto job_index = size_t{}; job_index < trainer_cpus.size(); ++job_index) {
+        std::clog << " " << job_index << "->" << trainer_cpus[job_index]
+                  << " (" << nodes[job_index % nodes.size()].id << ")";
+    }
+
+    std::clog << std::endl;
+}
+
+static yzw2v::train::Model TrainModel(const std::string& path,
+                                      const yzw2v::vocab::Vocabulary& vocab,
+                                      const yzw2v::huff::HuffmanTree& huffman_tree,
+                                      const yzw2v::train::Params& params,
+                                      const uint32_t thread_count,
+                                      void (ModelTrainer::* train)()) {
+    const auto syn1hs_holder = [&params, &vocab]() -> std::unique_ptr<yzw2v::num::Matrix> {
         if (params.use_hierarchical_softmax) {
-            std::unique_ptr<num::Matrix> res{new num::Matrix{vocab.size(), params.vector_size}};
+            std::unique_ptr<yzw2v::num::Matrix> res{new yzw2v::num::Matrix{vocab.size(), params.vector_size}};
             Zeroize(*res);
             return res;
         }
 
         return nullptr;
     }();
-    const auto syn1neg_holder = [&params, &vocab]() -> std::unique_ptr<num::Matrix> {
+    auto syn1neg_holder = [&params, &vocab]() -> std::unique_ptr<yzw2v::num::Matrix> {
         if (params.negative_samples_count > 0) {
-            std::unique_ptr<num::Matrix> res{new num::Matrix{vocab.size(), params.vector_size}};
+            std::unique_ptr<yzw2v::num::Matrix> res{new yzw2v::num::Matrix{
+                vocab.size(), params.vector_size, params.syn1neg_precision
+            }};
             Zeroize(*res);
             return res;
         }
 
         return nullptr;
     }();
-    const auto exp_table_holder = std::unique_ptr<const float[]>(GenerateExpTable(EXP_TABLE_SIZE));
 
-    auto res = Model{
+    auto res = yzw2v::train::Model{
         vocab.size(), params.vector_size,
-        std::unique_ptr<num::Matrix>{new num::Matrix{vocab.size(), params.vector_size}}
+        std::unique_ptr<yzw2v::num::Matrix>{new yzw2v::num::Matrix{
+            vocab.size(), params.vector_size, params.syn0_precision
+        }},
+        nullptr
     };
-    yzw2v::sampling::PRNG prng{params.prng_seed};
-    InitializeMatrix(*res.matrix_holder, prng);
-
-    const auto file_size = io::FileSize(path);
-    const auto bytes_per_thread = file_size / thread_count;
-    const auto bytes_per_thread_remainder = file_size % thread_count;
-    SharedData shared_data{params.starting_alpha,
-                           res.matrix_holder.get(), syn1hs_holder.get(), syn1neg_holder.get(),
-                           exp_table_holder.get(), vocab};
-    auto jobs = std::vector<std::future<void>>{};
-    auto job_index = uint32_t{};
-    for (auto offset = uint64_t{}; offset < file_size; offset += bytes_per_thread, ++job_index) {
-        auto bytes_per_this_thread = bytes_per_thread;
-        if (offset + bytes_per_thread + bytes_per_thread_remainder == file_size) {
-            bytes_per_this_thread += bytes_per_thread_remainder;
+
+    // in bytes for text and in ids for id corpus
+    const auto input_size = params.input_is_id_corpus
+                            ? yzw2v::io::IDCorpusSize(path, vocab)
+                            : yzw2v::io::FileSize(path);
+
+    // chunks of checkpoint are used as they are, so it doesn't matter how many threads made it
+    auto checkpoint = yzw2v::train::detail::Checkpoint{};
+    const auto resumed = params.resume && !params.checkpoint_path.empty()
+                         && yzw2v::train::detail::ReadCheckpoint(
+                                params.checkpoint_path, params, input_size, checkpoint,
+                                *res.matrix_holder, syn1hs_holder.get(), syn1neg_holder.get());
+    if (!resumed) {
+        yzw2v::sampling::PRNG prng{params.prng_seed};
+        InitializeMatrix(*res.matrix_holder, prng);
+        if (!params.init_model_path.empty()) {
+            WarmStart(*res.matrix_holder, vocab, params.init_model_path, "syn0");
+        }
+
+        if (!params.init_output_layer_path.empty()) {
+            if (!syn1neg_holder) {
+                throw std::runtime_error{"output layer is loaded only for negative sampling"};
+            }
+
+            WarmStart(*syn1neg_holder, vocab, params.init_output_layer_path, "syn1neg");
+        }
+
+        const auto chunk_size = std::max(
+            input_size / (static_cast<uint64_t>(thread_count) * CHUNKS_PER_THREAD),
+            params.input_is_id_corpus ? MIN_ID_CORPUS_CHUNK_SIZE : MIN_TEXT_CHUNK_SIZE);
+        checkpoint.boundaries = params.input_is_id_corpus
+            ? yzw2v::io::SplitIDCorpusIntoChunks(path, input_size, chunk_size)
+            : yzw2v::io::SplitTextIntoChunks(path, input_size, chunk_size);
+    }
+
+    yzw2v::train::detail::ChunkScheduler scheduler{
+        checkpoint.boundaries, thread_count, params.iterations_count, checkpoint.completed
+    };
+
+    // without NUMA mode everything is where the main thread has put it
+    const auto nodes = params.numa_aware
+                       ? yzw2v::numa::DetectNodes()
+                       : std::vector<yzw2v::numa::Node>{{0, {}}};
+    if (params.numa_aware) {
+        ReportNodes(nodes);
+        InterleaveMatrices({res.matrix_holder.get(), syn1hs_holder.get(), syn1neg_holder.get()},
+                           nodes);
+    }
+
+    const auto node_shared_data = [&]{
+        auto node_jobs = std::vector<std::future<std::unique_ptr<SharedData>>>{};
+        for (const auto& node : nodes) {
+            node_jobs.emplace_back(std::async(std::launch::async, [&]{
+                // pages of the tables are placed on the node that touches them first
+                if (params.numa_aware) {
+                    yzw2v::numa::PinCurrentThread(node.cpus);
+                }
+
+                return std::unique_ptr<SharedData>{new SharedData{
+                    res.matrix_holder.get(), syn1hs_holder.get(), syn1neg_holder.get(), vocab,
+                    huffman_tree, params.numa_aware && params.use_hierarchical_softmax
+                }};
+            }));
+        }
+
+        auto data = std::vector<std::unique_ptr<SharedData>>{};
+        for (auto&& job : node_jobs) {
+            data.push_back(job.get());
+        }
+
+        return data;
+    }();
+    const auto& shared_data = *node_shared_data.front();
+
+    const auto trainer_cpus = params.numa_aware
+                              ? AssignTrainersToCPUs(nodes, thread_count)
+                              : std::vector<uint32_t>{};
+    if (params.numa_aware) {
+        ReportTrainersPlacement(nodes, trainer_cpus, params.use_hierarchical_softmax);
+    }
+
+    std::clog << "Precision: syn0 " << yzw2v::num::PrecisionName(params.syn0_precision);
+    if (syn1neg_holder) {
+        std::clog << ", syn1neg " << yzw2v::num::PrecisionName(params.syn1neg_precision);
+    }
+
+    std::clog << std::endl;
+    ReportHugePages();
+
+    std::atomic<uint32_t> pinning_failures_count{0};
+    /* Trainer `i` continues the PRNG sequence of trainer `i` of checkpoint, trainers without one
+     * are seeded with their index as usual; counters of threads of checkpoint beyond
+     * `thread_count` go to the first one.
+     */
+    auto resumed_threads = std::vector<yzw2v::train::detail::ThreadCheckpoint>(thread_count);
+    for (auto job_index = uint32_t{}; job_index < thread_count; ++job_index) {
+        resumed_threads[job_index].prng_state = job_index;
+    }
+
+    auto resumed_words_count = uint64_t{};
+    for (auto i = size_t{}; i < checkpoint.threads.size(); ++i) {
+        auto& thread = resumed_threads[i < thread_count ? i : 0];
+        thread.words_count += checkpoint.threads[i].words_count;
+        thread.bytes_count += checkpoint.threads[i].bytes_count;
+        if (i < thread_count) {
+            thread.prng_state = checkpoint.threads[i].prng_state;
         }
 
+        resumed_words_count += checkpoint.threads[i].words_count;
+    }
+
+    const auto starting_alpha = ComputeAlpha(params, resumed_words_count, vocab.TextWordCount());
+    auto progress = std::vector<yzw2v::train::detail::ThreadProgress>(thread_count);
+    for (auto job_index = uint32_t{}; job_index < thread_count; ++job_index) {
+        const auto& thread = resumed_threads[job_index];
+        auto& thread_progress = progress[job_index];
+        thread_progress.processed_words_count.store(thread.words_count, std::memory_order_relaxed);
+        thread_progress.processed_bytes_count.store(thread.bytes_count, std::memory_order_relaxed);
+        thread_progress.iteration.store(0, std::memory_order_relaxed);
+        thread_progress.alpha.store(resumed ? starting_alpha : params.starting_alpha,
+                                    std::memory_order_relaxed);
+        thread_progress.committed_words_count.store(thread.words_count, std::memory_order_relaxed);
+        thread_progress.committed_bytes_count.store(thread.bytes_count, std::memory_order_relaxed);
+        thread_progress.committed_prng_state.store(thread.prng_state, std::memory_order_relaxed);
+    }
+
+    if (resumed) {
+        const auto completed = scheduler.CompletedChunks();
+        std::clog << "Checkpoint: resumed from " << params.checkpoint_path << ", "
+                  << std::count(completed.cbegin(), completed.cend(), uint8_t{1}) << " of "
+                  << completed.size() << " chunks are done" << std::endl;
+    }
+
+    yzw2v::train::detail::ProgressReporter reporter{params, vocab.TextWordCount(), progress};
+    std::unique_ptr<yzw2v::train::detail::Checkpointer> checkpointer;
+    if (!params.checkpoint_path.empty()) {
+        checkpointer.reset(new yzw2v::train::detail::Checkpointer{params, [&]{
+            const auto start_time = std::chrono::steady_clock::now();
+            auto state = yzw2v::train::detail::Checkpoint{};
+            state.boundaries = scheduler.boundaries();
+            state.completed = scheduler.CompletedChunks();
+            for (const auto& thread_progress : progress) {
+                state.threads.push_back({
+                    thread_progress.committed_words_count.load(std::memory_order_relaxed),
+                    thread_progress.committed_bytes_count.load(std::memory_order_relaxed),
+                    thread_progress.committed_prng_state.load(std::memory_order_relaxed)
+                });
+            }
+
+            yzw2v::train::detail::WriteCheckpoint(params.checkpoint_path, params, input_size,
+                                                  state, *res.matrix_holder, syn1hs_holder.get(),
+                                                  syn1neg_holder.get());
+            std::clog << "Checkpoint: " << std::count(state.completed.cbegin(),
+                                                      state.completed.cend(), uint8_t{1})
+                      << " of " << state.completed.size() << " chunks saved to "
+                      << params.checkpoint_path << " in " << std::fixed << std::setprecision(2)
+                      << std::chrono::duration<double>(
+                             std::chrono::steady_clock::now() - start_time).count()
+                      << " seconds" << std::endl;
+        }});
+    }
+
+    auto jobs = std::vector<std::future<void>>{};
+    for (auto job_index = uint32_t{}; job_index < thread_count; ++job_index) {
+        auto& thread_progress = progress[job_index];
         jobs.emplace_back(std::async(std::launch::async,
-            [&path, &vocab, &huffman_tree, &params, &shared_data, offset, bytes_per_this_thread,
-             job_index]{
-                ModelTrainer trainer{path, offset, bytes_per_this_thread,
-                                     vocab, huffman_tree, params, job_index, shared_data};
-                trainer.TrainCBOW();
+            [&path, &scheduler, &vocab, &params, &nodes, &node_shared_data, &thread_progress,
+             &trainer_cpus, &pinning_failures_count, job_index, train]{
+                // pinned before trainer allocates its buffers, so they are local too
+                if (params.numa_aware
+                    && !yzw2v::numa::PinCurrentThread({trainer_cpus[job_index]})) {
+                    ++pinning_failures_count;
+                }
+
+                const auto& node_data = *node_shared_data[job_index % nodes.size()];
+                const auto seed = thread_progress.committed_prng_state.load(
+                    std::memory_order_relaxed);
+                ModelTrainer trainer{path, scheduler, job_index,
+                                     vocab, node_data.huffman_tree, params, seed, node_data,
+                                     thread_progress};
+                (trainer.*train)();
         }));
     }
 
+    // the only place where learning rate is computed
+    const auto update_alpha = [&params, &shared_data, &progress]{
+        auto processed_words_count = uint64_t{};
+        for (const auto& thread_progress : progress) {
+            processed_words_count +=
+                thread_progress.processed_words_count.load(std::memory_order_relaxed);
+        }
+
+        const auto alpha = ComputeAlpha(params, processed_words_count,
+                                        shared_data.text_words_count_);
+        for (auto&& thread_progress : progress) {
+            thread_progress.alpha.store(alpha, std::memory_order_relaxed);
+        }
+    };
+
     for (auto&& job : jobs) {
-        job.wait();
+        while (std::future_status::ready != job.wait_for(PARAMS_UPDATE_INTERVAL)) {
+            update_alpha();
+        }
     }
 
+    update_alpha();
+    if (checkpointer) {
+        checkpointer->Stop();
+    }
+
+    reporter.Stop();
+    if (pinning_failures_count) {
+        std::clog << "NUMA: failed to pin " << pinning_failures_count << " trainer thread(s)"
+                  << std::endl;
+    }
+
+    res.output_layer_holder = std::move(syn1neg_holder);
     return res;
 }
+
+yzw2v::train::Model yzw2v::train::TrainCBOWModel(const std::string& path,
+                                                 const vocab::Vocabulary& vocab,
+                                                 const huff::HuffmanTree& huffman_tree,
+                                                 const Params& params,
+                                                 const uint32_t thread_count) {
+    return TrainModel(path, vocab, huffman_tree, params, thread_count, &ModelTrainer::TrainCBOW);
+}
+
+yzw2v::train::Model yzw2v::train::TrainSkipGramModel(const std::string& path,
+                                                     const vocab::Vocabulary& vocab,
+                                                     const huff::HuffmanTree& huffman_tree,
+                                                     const Params& params,
+                                                     const uint32_t thread_count) {
+    return TrainModel(path, vocab, huffman_tree, params, thread_count,
+                      &ModelTrainer::TrainSkipGram);
+}
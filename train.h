@@ -1,5 +1,6 @@
 #pragma once
 
+#include "byte_source.h"
 #include "mem.h"
 #include "matrix.h"
 
@@ -22,6 +23,7 @@ namespace yzw2v {
     namespace train {
         static constexpr uint32_t DEFAULT_ITERATIONS_COUNT = 5;
         static constexpr float DEFAULT_STARTING_ALPHA = 0.05f;
+        static constexpr float DEFAULT_FINAL_ALPHA = 0.0f;
         static constexpr uint32_t DEFAULT_MAX_SENTENCE_LENGTH = 1000;
         static constexpr float DEFAULT_MIN_TOKEN_FREQ_THRESHOLD = 1e-3f;
         static constexpr uint32_t DEFAULT_NEGATIVE_SAMPLES_COUNT = 5;
@@ -29,10 +31,23 @@ namespace yzw2v {
         static constexpr uint32_t DEFAULT_VECTOR_SIZE = 100;
         static constexpr uint32_t DEFAULT_WINDOW_SIZE = 5;
         static constexpr uint32_t DEFAULT_PRNG_SEED = 1;
+        static constexpr uint32_t DEFAULT_CBOW_BATCH_SIZE = 1;
+        static constexpr uint32_t DEFAULT_METRICS_INTERVAL_MS = 1000;
+        static constexpr uint32_t DEFAULT_CHECKPOINT_INTERVAL_SEC = 1800;
+
+        enum class MetricsFormat {
+            JSON,  // one JSON object per line
+            TSV    // header line, then one line per record
+        };
 
         struct Params {
             uint32_t iterations_count = DEFAULT_ITERATIONS_COUNT;
             float starting_alpha = DEFAULT_STARTING_ALPHA;
+
+            // Alpha goes down linearly from `starting_alpha` to `final_alpha` over all iterations,
+            // but never below `starting_alpha * 0.0001`.
+            float final_alpha = DEFAULT_FINAL_ALPHA;
+
             uint32_t max_sentence_length = DEFAULT_MAX_SENTENCE_LENGTH;
             float min_token_freq_threshold = DEFAULT_MIN_TOKEN_FREQ_THRESHOLD;
             uint32_t negative_samples_count = DEFAULT_NEGATIVE_SAMPLES_COUNT;
@@ -40,12 +55,59 @@ namespace yzw2v {
             uint32_t vector_size = DEFAULT_VECTOR_SIZE;
             uint32_t window_size = DEFAULT_WINDOW_SIZE;
             uint32_t prng_seed = DEFAULT_PRNG_SEED;
+
+            // Number of consecutive sentence positions that share one set of negative samples in
+            // CBOW, so hidden vectors of the whole batch are trained against `syn1neg` rows while
+            // these rows are in L1. 1 means that every position draws its own negative samples.
+            uint32_t cbow_batch_size = DEFAULT_CBOW_BATCH_SIZE;
+
+            // Storage of input vectors and of the output layer of negative sampling. FP16 and BF16
+            // halve memory and bandwidth at the cost of precision of small updates; output layer
+            // of hierarchical softmax is always FP32.
+            num::Precision syn0_precision = num::Precision::FP32;
+            num::Precision syn1neg_precision = num::Precision::FP32;
+
+            // Warm start: input vectors and output layer of negative sampling are taken from models
+            // written by `WriteModelBinary` and `WriteOutputLayerBinary` instead of being random and
+            // zero. Rows are matched by token, so vocabulary may differ from the one of the models;
+            // rows of new words are initialized as usual.
+            std::string init_model_path;
+            std::string init_output_layer_path;
+
+            // Training file is an id corpus made by `io::ConvertToIDCorpus` with the same
+            // vocabulary, not a text.
+            bool input_is_id_corpus = false;
+
+            // How text is read by each trainer thread
+            io::ReadOptions read_options;
+
+            // Pin trainer threads to CPUs spread over NUMA nodes, build a copy of read-only tables
+            // on every node and interleave pages of the matrices over nodes. Placement is
+            // reported to stderr.
+            bool numa_aware = false;
+
+            // Training progress is sampled by a separate thread every `metrics_interval_ms`. If
+            // `metrics_path` is empty it is printed as a human readable line to stdout, otherwise
+            // records in `metrics_format` are written to `metrics_path` ("-" for stdout).
+            std::string metrics_path;
+            MetricsFormat metrics_format = MetricsFormat::JSON;
+            uint32_t metrics_interval_ms = DEFAULT_METRICS_INTERVAL_MS;
+
+            // If `checkpoint_path` is not empty the matrices and the state of training are saved
+            // there every `checkpoint_interval_sec` by a separate thread, trainers don't wait for
+            // it. With `resume` training continues from that checkpoint if there is one.
+            std::string checkpoint_path;
+            uint32_t checkpoint_interval_sec = DEFAULT_CHECKPOINT_INTERVAL_SEC;
+            bool resume = false;
         };
 
         struct Model {
             uint32_t vocabulary_size;
             uint32_t vector_size;
             std::unique_ptr<num::Matrix> matrix_holder;
+
+            // syn1neg, null without negative sampling
+            std::unique_ptr<num::Matrix> output_layer_holder;
         };
 
         void WriteModelTXT(const std::string& path,
@@ -54,9 +116,25 @@ namespace yzw2v {
         void WriteModelBinary(const std::string& path,
                               const vocab::Vocabulary& vocab, const Model& model);
 
+        // Output layer of negative sampling in the format of `WriteModelBinary`, one row per token,
+        // to continue training later (see `Params::init_output_layer_path`).
+        void WriteOutputLayerBinary(const std::string& path,
+                                    const vocab::Vocabulary& vocab, const Model& model);
+
+        // About 4 times smaller, see `quant::Model` for format and reader.
+        void WriteModelInt8(const std::string& path,
+                            const vocab::Vocabulary& vocab, const Model& model);
+
         Model TrainCBOWModel(const std::string& path,
                               const vocab::Vocabulary& vocab,
                               const huff::HuffmanTree& huffman_tree,
                               const Params& params, const uint32_t thread_count);
+
+        // Context words of a window are trained as a batch against one shared set of negative
+        // samples (or the Huffman path of the central word), see `num::ScalarProducts`.
+        Model TrainSkipGramModel(const std::string& path,
+                                 const vocab::Vocabulary& vocab,
+                                 const huff::HuffmanTree& huffman_tree,
+                                 const Params& params, const uint32_t thread_count);
     }  // namespace train
 }  // namespace yzw2v
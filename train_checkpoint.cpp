@@ -0,0 +1,229 @@
+#include "train_checkpoint.h"
+
+#include "matrix.h"
+
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+#include <cstdio>
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+static const char CHECKPOINT_MAGIC[] = {"YZW2V_CHECKPOINT"};
+static constexpr size_t CHECKPOINT_MAGIC_SIZE = sizeof(CHECKPOINT_MAGIC)
+                                                / sizeof(CHECKPOINT_MAGIC[0]);
+
+/* [CHECKPOINT_MAGIC, (value, hash(value)) * HEADER_VALUES_COUNT, chunk boundaries, completed
+ * chunks flags, threads, syn0, syn1hs if used, syn1neg if used, CHECKPOINT_MAGIC]; header values
+ * are the ones below, all uint64.
+ */
+enum HeaderValue : uint32_t {
+    ROWS_COUNT,
+    COLUMNS_COUNT,
+    SYN0_PRECISION,
+    HAS_SYN1HS,
+    SYN1NEG_PRECISION,  // + 1, 0 if there is no syn1neg
+    ITERATIONS_COUNT,
+    INPUT_IS_ID_CORPUS,
+    INPUT_SIZE,
+    CHUNKS_COUNT,  // the rest doesn't have to match training parameters
+    THREADS_COUNT,
+    HEADER_VALUES_COUNT
+};
+
+static uint64_t IntHash(const uint64_t value) noexcept {
+    // Knuth's Multiplicative Method
+    return value * uint64_t{11400714819323198485ull};
+}
+
+static void MakeHeader(const yzw2v::train::Params& params, const uint64_t input_size,
+                       const yzw2v::num::Matrix& syn0, const yzw2v::num::Matrix* const syn1hs,
+                       const yzw2v::num::Matrix* const syn1neg, uint64_t* const header) noexcept {
+    header[ROWS_COUNT] = syn0.rows_count();
+    header[COLUMNS_COUNT] = syn0.columns_count();
+    header[SYN0_PRECISION] = static_cast<uint64_t>(syn0.precision());
+    header[HAS_SYN1HS] = nullptr != syn1hs;
+    header[SYN1NEG_PRECISION] = syn1neg ? static_cast<uint64_t>(syn1neg->precision()) + 1 : 0;
+    header[ITERATIONS_COUNT] = params.iterations_count;
+    header[INPUT_IS_ID_CORPUS] = params.input_is_id_corpus;
+    header[INPUT_SIZE] = input_size;
+}
+
+static void Write(FILE* const out, const void* const data, const size_t size) {
+    if (size && fwrite(data, 1, size, out) != size) {
+        throw std::runtime_error{"failed to write checkpoint"};
+    }
+}
+
+static void Read(std::istream& in, void* const data, const size_t size) {
+    if (!in.read(static_cast<char*>(data), static_cast<std::streamsize>(size))) {
+        throw std::runtime_error{"checkpoint is truncated"};
+    }
+}
+
+// Durability of the data, not only of the process' view of it.
+static void Sync(FILE* const out) {
+    if (fflush(out)) {
+        throw std::runtime_error{"failed to write checkpoint"};
+    }
+
+#if defined(_WIN32)
+    const auto failed = _commit(_fileno(out));
+#else
+    const auto failed = fsync(fileno(out));
+#endif
+    if (failed) {
+        throw std::runtime_error{"failed to sync checkpoint"};
+    }
+}
+
+void yzw2v::train::detail::WriteCheckpoint(const std::string& path, const Params& params,
+                                           const uint64_t input_size,
+                                           const Checkpoint& checkpoint,
+                                           const num::Matrix& syn0, const num::Matrix* const syn1hs,
+                                           const num::Matrix* const syn1neg) {
+    const auto tmp_path = path + ".tmp";
+    auto* const out = fopen(tmp_path.c_str(), "wb");
+    if (!out) {
+        throw std::runtime_error{"failed to open checkpoint file for write"};
+    }
+
+    try {
+        uint64_t header[HEADER_VALUES_COUNT] = {};
+        MakeHeader(params, input_size, syn0, syn1hs, syn1neg, header);
+        header[CHUNKS_COUNT] = checkpoint.boundaries.size() - 1;
+        header[THREADS_COUNT] = checkpoint.threads.size();
+
+        Write(out, CHECKPOINT_MAGIC, CHECKPOINT_MAGIC_SIZE);
+        for (const auto value : header) {
+            const uint64_t pair[] = {value, IntHash(value)};
+            Write(out, pair, sizeof(pair));
+        }
+
+        Write(out, checkpoint.boundaries.data(), sizeof(uint64_t) * checkpoint.boundaries.size());
+        Write(out, checkpoint.completed.data(), checkpoint.completed.size());
+        Write(out, checkpoint.threads.data(), sizeof(ThreadCheckpoint) * checkpoint.threads.size());
+        for (const auto* const matrix : {&syn0, syn1hs, syn1neg}) {
+            if (matrix) {
+                Write(out, matrix->data(), matrix->bytes_count());
+            }
+        }
+
+        Write(out, CHECKPOINT_MAGIC, CHECKPOINT_MAGIC_SIZE);
+        Sync(out);
+    } catch (...) {
+        fclose(out);
+        std::remove(tmp_path.c_str());
+        throw;
+    }
+
+    fclose(out);
+#if defined(_WIN32)
+    // rename doesn't replace existing file on Windows
+    std::remove(path.c_str());
+#endif
+    if (std::rename(tmp_path.c_str(), path.c_str())) {
+        throw std::runtime_error{"failed to rename checkpoint"};
+    }
+}
+
+bool yzw2v::train::detail::ReadCheckpoint(const std::string& path, const Params& params,
+                                          const uint64_t input_size, Checkpoint& checkpoint,
+                                          num::Matrix& syn0, num::Matrix* const syn1hs,
+                                          num::Matrix* const syn1neg) {
+    std::ifstream in{path, std::ios::binary};
+    if (!in) {
+        return false;
+    }
+
+    char magic[CHECKPOINT_MAGIC_SIZE] = {};
+    Read(in, magic, CHECKPOINT_MAGIC_SIZE);
+    if (std::string{magic, CHECKPOINT_MAGIC_SIZE}
+        != std::string{CHECKPOINT_MAGIC, CHECKPOINT_MAGIC_SIZE}) {
+        throw std::runtime_error{"magic doesn't match"};
+    }
+
+    uint64_t expected[HEADER_VALUES_COUNT] = {};
+    MakeHeader(params, input_size, syn0, syn1hs, syn1neg, expected);
+    uint64_t header[HEADER_VALUES_COUNT] = {};
+    for (auto i = uint32_t{}; i < HEADER_VALUES_COUNT; ++i) {
+        uint64_t pair[2] = {};
+        Read(in, pair, sizeof(pair));
+        if (IntHash(pair[0]) != pair[1]) {
+            throw std::runtime_error{"checkpoint header hash doesn't match"};
+        }
+
+        header[i] = pair[0];
+        if (i < CHUNKS_COUNT && expected[i] != header[i]) {
+            throw std::runtime_error{"checkpoint was made for other training parameters or input"};
+        }
+    }
+
+    checkpoint.boundaries.resize(header[CHUNKS_COUNT] + 1);
+    checkpoint.completed.resize(header[CHUNKS_COUNT] * header[ITERATIONS_COUNT]);
+    checkpoint.threads.resize(header[THREADS_COUNT]);
+    Read(in, checkpoint.boundaries.data(), sizeof(uint64_t) * checkpoint.boundaries.size());
+    Read(in, checkpoint.completed.data(), checkpoint.completed.size());
+    Read(in, checkpoint.threads.data(), sizeof(ThreadCheckpoint) * checkpoint.threads.size());
+    for (auto* const matrix : {&syn0, syn1hs, syn1neg}) {
+        if (matrix) {
+            Read(in, matrix->data(), matrix->bytes_count());
+        }
+    }
+
+    Read(in, magic, CHECKPOINT_MAGIC_SIZE);
+    if (std::string{magic, CHECKPOINT_MAGIC_SIZE}
+        != std::string{CHECKPOINT_MAGIC, CHECKPOINT_MAGIC_SIZE}) {
+        throw std::runtime_error{"checkpoint is incomplete"};
+    }
+
+    if (checkpoint.boundaries.back() != input_size) {
+        throw std::runtime_error{"checkpoint chunks don't cover the input"};
+    }
+
+    return true;
+}
+
+yzw2v::train::detail::Checkpointer::Checkpointer(const Params& params,
+                                                 std::function<void()> write)
+    : interval_{params.checkpoint_interval_sec}
+    , write_{std::move(write)}
+    , stop_{false}
+{
+    thread_ = std::thread{[this]{ Run(); }};
+}
+
+yzw2v::train::detail::Checkpointer::~Checkpointer() {
+    Stop();
+}
+
+void yzw2v::train::detail::Checkpointer::Stop() {
+    if (!thread_.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        stop_ = true;
+    }
+
+    stop_requested_.notify_one();
+    thread_.join();
+}
+
+void yzw2v::train::detail::Checkpointer::Run() {
+    std::unique_lock<std::mutex> lock{mutex_};
+    while (!stop_requested_.wait_for(lock, interval_, [this]{ return stop_; })) {
+        // training goes on anyway, the next attempt may succeed
+        try {
+            write_();
+        } catch (const std::exception& e) {
+            std::clog << "Checkpoint: " << e.what() << std::endl;
+        }
+    }
+}
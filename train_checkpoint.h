@@ -0,0 +1,75 @@
+#pragma once
+
+#include "train.h"
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <cstdint>
+
+namespace yzw2v {
+    namespace train {
+        namespace detail {
+            struct ThreadCheckpoint {
+                uint64_t words_count;
+                uint64_t bytes_count;
+                uint64_t prng_state;
+            };
+
+            /* State of training at chunk granularity: chunks that were completed and counters of
+             * trainers as of their last completed chunk. Chunks in progress are trained again
+             * after resume, updates they've made before the checkpoint stay in the matrices, just
+             * as concurrent updates of other trainers do.
+             */
+            struct Checkpoint {
+                std::vector<uint64_t> boundaries;  // of chunks
+                std::vector<uint8_t> completed;    // `epoch * chunks count + chunk`
+                std::vector<ThreadCheckpoint> threads;
+            };
+
+            /* Matrices are copied to the file right from memory while trainers keep updating
+             * them, so a row may have some of the updates made during the copy. Checkpoint is
+             * written to a temporary file which is synced and renamed to `path`, so `path` is
+             * always the last complete checkpoint.
+             *
+             * `syn1hs` and `syn1neg` may be null if they are not used.
+             */
+            void WriteCheckpoint(const std::string& path, const Params& params,
+                                 const uint64_t input_size, const Checkpoint& checkpoint,
+                                 const num::Matrix& syn0, const num::Matrix* syn1hs,
+                                 const num::Matrix* syn1neg);
+
+            // false if there is no checkpoint at `path`; throws if it was made by training with
+            // other parameters or input
+            bool ReadCheckpoint(const std::string& path, const Params& params,
+                                const uint64_t input_size, Checkpoint& checkpoint,
+                                num::Matrix& syn0, num::Matrix* syn1hs, num::Matrix* syn1neg);
+
+            // Calls `write` in its own thread every `params.checkpoint_interval_sec`.
+            class Checkpointer {
+            public:
+                Checkpointer(const Params& params, std::function<void()> write);
+                ~Checkpointer();
+
+                void Stop();
+
+            private:
+                void Run();
+
+            private:
+                const std::chrono::seconds interval_;
+                const std::function<void()> write_;
+
+                std::mutex mutex_;
+                std::condition_variable stop_requested_;
+                bool stop_;
+                std::thread thread_;
+            };
+        }
+    }
+}
@@ -0,0 +1,189 @@
+#include "train_progress.h"
+
+#include <stdexcept>
+
+yzw2v::train::detail::ProgressReporter::ProgressReporter(const Params& params,
+                                                        const uint64_t text_words_count,
+                                                        const std::vector<ThreadProgress>& progress)
+    : p_{params}
+    , text_words_count_{text_words_count}
+    , progress_{progress}
+    , output_{stdout}
+    , owns_output_{false}
+    , start_time_{Clock::now()}
+    , start_words_count_{0}
+    , prev_sample_time_{start_time_}
+    , prev_words_counts_(progress.size())
+    , words_per_sec_(progress.size())
+    , stop_{false}
+{
+    for (auto i = size_t{}; i < progress_.size(); ++i) {
+        prev_words_counts_[i] = progress_[i].processed_words_count.load(std::memory_order_relaxed);
+        start_words_count_ += prev_words_counts_[i];
+    }
+
+    if (!p_.metrics_path.empty() && "-" != p_.metrics_path) {
+        output_ = fopen(p_.metrics_path.c_str(), "w");
+        if (!output_) {
+            throw std::runtime_error{"failed to open metrics file: " + p_.metrics_path};
+        }
+
+        owns_output_ = true;
+    }
+
+    if (!p_.metrics_path.empty() && MetricsFormat::TSV == p_.metrics_format) {
+        fprintf(output_, "seconds\tprogress\tepoch\talpha\twords\tbytes\twords_per_sec\teta");
+        for (auto i = size_t{}; i < progress_.size(); ++i) {
+            fprintf(output_,
+                    "\tthread%zu_words\tthread%zu_epoch\tthread%zu_bytes\tthread%zu_words_per_sec",
+                    i, i, i, i);
+        }
+
+        fprintf(output_, "\n");
+    }
+
+    thread_ = std::thread{[this]{ Run(); }};
+}
+
+yzw2v::train::detail::ProgressReporter::~ProgressReporter() {
+    Stop();
+    if (owns_output_) {
+        fclose(output_);
+    }
+}
+
+void yzw2v::train::detail::ProgressReporter::Stop() {
+    if (!thread_.joinable()) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock{mutex_};
+        stop_ = true;
+    }
+
+    stop_requested_.notify_one();
+    thread_.join();
+    Sample();
+    if (p_.metrics_path.empty()) {
+        fprintf(output_, "\n");
+    }
+
+    fflush(output_);
+}
+
+void yzw2v::train::detail::ProgressReporter::Run() {
+    const auto interval = std::chrono::milliseconds{p_.metrics_interval_ms};
+    std::unique_lock<std::mutex> lock{mutex_};
+    while (!stop_requested_.wait_for(lock, interval, [this]{ return stop_; })) {
+        Sample();
+    }
+}
+
+void yzw2v::train::detail::ProgressReporter::Sample() {
+    const auto now = Clock::now();
+    const auto seconds_passed = std::chrono::duration<double>(now - start_time_).count();
+    const auto seconds_since_prev_sample =
+        std::chrono::duration<double>(now - prev_sample_time_).count();
+    prev_sample_time_ = now;
+
+    auto words_count = uint64_t{};
+    auto bytes_count = uint64_t{};
+    for (auto i = size_t{}; i < progress_.size(); ++i) {
+        const auto thread_words_count =
+            progress_[i].processed_words_count.load(std::memory_order_relaxed);
+        words_per_sec_[i] = seconds_since_prev_sample > 0
+                            ? (thread_words_count - prev_words_counts_[i])
+                              / seconds_since_prev_sample
+                            : 0.0;
+        prev_words_counts_[i] = thread_words_count;
+        words_count += thread_words_count;
+        bytes_count += progress_[i].processed_bytes_count.load(std::memory_order_relaxed);
+    }
+
+    if (p_.metrics_path.empty()) {
+        WriteLine(seconds_passed, words_count);
+        return;
+    }
+
+    // average speed since the start, speed for the last interval is too noisy for ETA
+    const auto words_per_sec = seconds_passed > 0
+                               ? (words_count - start_words_count_) / seconds_passed
+                               : 0.0;
+    const auto words_total = static_cast<double>(text_words_count_) * p_.iterations_count;
+    const auto seconds_left = words_per_sec > 0 && words_total > words_count
+                              ? (words_total - words_count) / words_per_sec
+                              : 0.0;
+    if (MetricsFormat::JSON == p_.metrics_format) {
+        WriteJSON(seconds_passed, words_count, bytes_count, words_per_sec, seconds_left);
+    } else {
+        WriteTSV(seconds_passed, words_count, bytes_count, words_per_sec, seconds_left);
+    }
+
+    fflush(output_);
+}
+
+void yzw2v::train::detail::ProgressReporter::WriteLine(const double seconds_passed,
+                                                       const uint64_t words_count) {
+    const auto progress = static_cast<double>(words_count)
+                          / (text_words_count_ * p_.iterations_count)
+                          * 100;
+    const auto words_per_sec = (words_count - start_words_count_) / (seconds_passed + 1) / 1000;
+    fprintf(output_, "%c[trainer] progress=%.6lf%% alpha=%.6f words/sec=%.2lfK  ",
+            '\r', progress, static_cast<double>(progress_[0].alpha.load(std::memory_order_relaxed)),
+            words_per_sec);
+    fflush(output_);
+}
+
+void yzw2v::train::detail::ProgressReporter::WriteJSON(const double seconds_passed,
+                                                       const uint64_t words_count,
+                                                       const uint64_t bytes_count,
+                                                       const double words_per_sec,
+                                                       const double seconds_left) {
+    const auto epoch = static_cast<double>(words_count) / text_words_count_;
+    fprintf(output_,
+            "{\"seconds\": %.3lf, \"progress\": %.6lf, \"epoch\": %.6lf, \"alpha\": %.6f, "
+            "\"words\": %llu, \"bytes\": %llu, \"words_per_sec\": %.1lf, \"eta\": %.1lf, "
+            "\"threads\": [",
+            seconds_passed, epoch / p_.iterations_count, epoch,
+            static_cast<double>(progress_[0].alpha.load(std::memory_order_relaxed)),
+            static_cast<unsigned long long>(words_count),
+            static_cast<unsigned long long>(bytes_count),
+            words_per_sec, seconds_left);
+    for (auto i = size_t{}; i < progress_.size(); ++i) {
+        fprintf(output_,
+                "%s{\"words\": %llu, \"epoch\": %u, \"bytes\": %llu, \"words_per_sec\": %.1lf}",
+                i ? ", " : "",
+                static_cast<unsigned long long>(prev_words_counts_[i]),
+                progress_[i].iteration.load(std::memory_order_relaxed),
+                static_cast<unsigned long long>(
+                    progress_[i].processed_bytes_count.load(std::memory_order_relaxed)),
+                words_per_sec_[i]);
+    }
+
+    fprintf(output_, "]}\n");
+}
+
+void yzw2v::train::detail::ProgressReporter::WriteTSV(const double seconds_passed,
+                                                      const uint64_t words_count,
+                                                      const uint64_t bytes_count,
+                                                      const double words_per_sec,
+                                                      const double seconds_left) {
+    const auto epoch = static_cast<double>(words_count) / text_words_count_;
+    fprintf(output_, "%.3lf\t%.6lf\t%.6lf\t%.6f\t%llu\t%llu\t%.1lf\t%.1lf",
+            seconds_passed, epoch / p_.iterations_count, epoch,
+            static_cast<double>(progress_[0].alpha.load(std::memory_order_relaxed)),
+            static_cast<unsigned long long>(words_count),
+            static_cast<unsigned long long>(bytes_count),
+            words_per_sec, seconds_left);
+    for (auto i = size_t{}; i < progress_.size(); ++i) {
+        fprintf(output_, "\t%llu\t%u\t%llu\t%.1lf",
+                static_cast<unsigned long long>(prev_words_counts_[i]),
+                progress_[i].iteration.load(std::memory_order_relaxed),
+                static_cast<unsigned long long>(
+                    progress_[i].processed_bytes_count.load(std::memory_order_relaxed)),
+                words_per_sec_[i]);
+    }
+
+    fprintf(output_, "\n");
+}
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "train.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <cstdint>
+#include <cstdio>
+
+namespace yzw2v {
+    namespace train {
+        namespace detail {
+            static constexpr size_t CACHE_LINE_SIZE = 64;
+
+            /* Each trainer publishes its counters into its own slot and reads learning rate from
+             * it, main thread sums up the counts and writes new learning rate into every slot.
+             * Slots are padded on both sides, so trainers never write into the same cache line
+             * (alignment of `new` before C++17 is not enough for `alignas(CACHE_LINE_SIZE)`).
+             */
+            struct ThreadProgress {
+                char padding_before[CACHE_LINE_SIZE];
+                std::atomic<uint64_t> processed_words_count;  // over all iterations
+                std::atomic<uint64_t> processed_bytes_count;  // over all iterations
+                std::atomic<uint32_t> iteration;
+                std::atomic<float> alpha;
+
+                // as of the end of the last finished chunk, for checkpoints
+                std::atomic<uint64_t> committed_words_count;
+                std::atomic<uint64_t> committed_bytes_count;
+                std::atomic<uint64_t> committed_prng_state;
+                char padding_after[CACHE_LINE_SIZE];
+            };
+
+            /* Samples `ThreadProgress` slots in its own thread every `params.metrics_interval_ms`
+             * and writes the records as described in `Params`, so trainers don't do any I/O. Last
+             * record is written by `Stop`.
+             */
+            class ProgressReporter {
+            public:
+                ProgressReporter(const Params& params, const uint64_t text_words_count,
+                                 const std::vector<ThreadProgress>& progress);
+                ~ProgressReporter();
+
+                void Stop();
+
+            private:
+                void Run();
+                void Sample();
+                void WriteLine(const double seconds_passed, const uint64_t words_count);
+                void WriteJSON(const double seconds_passed, const uint64_t words_count,
+                               const uint64_t bytes_count, const double words_per_sec,
+                               const double seconds_left);
+                void WriteTSV(const double seconds_passed, const uint64_t words_count,
+                              const uint64_t bytes_count, const double words_per_sec,
+                              const double seconds_left);
+
+            private:
+                using Clock = std::chrono::steady_clock;
+
+                const Params& p_;
+                const uint64_t text_words_count_;
+                const std::vector<ThreadProgress>& progress_;
+
+                FILE* output_;
+                bool owns_output_;
+
+                const Clock::time_point start_time_;
+                uint64_t start_words_count_;  // not zero when training is resumed
+                Clock::time_point prev_sample_time_;
+                std::vector<uint64_t> prev_words_counts_;
+                std::vector<double> words_per_sec_;  // per thread, since previous sample
+
+                std::mutex mutex_;
+                std::condition_variable stop_requested_;
+                bool stop_;
+                std::thread thread_;
+            };
+        }
+    }
+}
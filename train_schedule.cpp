@@ -0,0 +1,90 @@
+#include "train_schedule.h"
+
+yzw2v::train::detail::ChunkScheduler::ChunkScheduler(const std::vector<uint64_t>& boundaries,
+                                                     const uint32_t owners_count,
+                                                     const uint32_t epochs_count,
+                                                     const std::vector<uint8_t>& completed)
+    : boundaries_{boundaries}
+    , owners_count_{owners_count}
+    , ranges_(owners_count + 1)
+    , counters_(static_cast<size_t>(epochs_count) * owners_count)
+    , completed_(static_cast<size_t>(epochs_count) * (boundaries.size() - 1))
+{
+    const auto chunks_count = ChunksCount();
+    for (auto owner = uint32_t{}; owner <= owners_count; ++owner) {
+        ranges_[owner] = static_cast<uint32_t>(
+            static_cast<uint64_t>(chunks_count) * owner / owners_count);
+    }
+
+    for (auto&& counter : counters_) {
+        counter.claimed.store(0, std::memory_order_relaxed);
+    }
+
+    for (auto i = size_t{}; i < completed_.size(); ++i) {
+        completed_[i].store(i < completed.size() && completed[i], std::memory_order_relaxed);
+    }
+}
+
+const std::vector<uint64_t>& yzw2v::train::detail::ChunkScheduler::boundaries() const noexcept {
+    return boundaries_;
+}
+
+void yzw2v::train::detail::ChunkScheduler::Complete(const uint32_t epoch,
+                                                    const uint32_t chunk_index) noexcept {
+    completed_[static_cast<size_t>(epoch) * ChunksCount() + chunk_index].store(
+        1, std::memory_order_release);
+}
+
+std::vector<uint8_t> yzw2v::train::detail::ChunkScheduler::CompletedChunks() const {
+    auto res = std::vector<uint8_t>(completed_.size());
+    for (auto i = size_t{}; i < completed_.size(); ++i) {
+        res[i] = completed_[i].load(std::memory_order_acquire);
+    }
+
+    return res;
+}
+
+uint32_t yzw2v::train::detail::ChunkScheduler::ChunksCount() const noexcept {
+    return static_cast<uint32_t>(boundaries_.size() - 1);
+}
+
+bool yzw2v::train::detail::ChunkScheduler::ClaimFrom(const uint32_t owner, const uint32_t epoch,
+                                                     Chunk& chunk) noexcept {
+    auto& claimed = counters_[static_cast<size_t>(epoch) * owners_count_ + owner].claimed;
+    const auto range_size = ranges_[owner + 1] - ranges_[owner];
+
+    const auto* const completed = completed_.data() + static_cast<size_t>(epoch) * ChunksCount();
+    for (;;) {
+        // don't touch the cache line of exhausted range with writes
+        if (claimed.load(std::memory_order_relaxed) >= range_size) {
+            return false;
+        }
+
+        const auto index = claimed.fetch_add(1, std::memory_order_relaxed);
+        if (index >= range_size) {
+            return false;
+        }
+
+        const auto chunk_index = ranges_[owner] + index;
+        if (completed[chunk_index].load(std::memory_order_relaxed)) {
+            continue;
+        }
+
+        chunk.offset = boundaries_[chunk_index];
+        chunk.size = boundaries_[chunk_index + 1] - boundaries_[chunk_index];
+        chunk.index = chunk_index;
+        return true;
+    }
+}
+
+bool yzw2v::train::detail::ChunkScheduler::Claim(const uint32_t owner, const uint32_t epoch,
+                                                 Chunk& chunk) noexcept {
+    // own range first, then steal from the next owners
+    for (auto i = uint32_t{}; i < owners_count_; ++i) {
+        if (ClaimFrom((owner + i) % owners_count_, epoch, chunk)) {
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "train_progress.h"
+
+#include <atomic>
+#include <vector>
+
+#include <cstdint>
+
+namespace yzw2v {
+    namespace train {
+        namespace detail {
+            // Part of the input, in bytes for text and in ids for id corpus
+            struct Chunk {
+                uint64_t offset;
+                uint64_t size;
+                uint32_t index;
+            };
+
+            /* Hands out every chunk exactly once per epoch. Chunks of an epoch are split between
+             * owners into contiguous ranges, each with its own counter of claimed chunks; owner
+             * takes chunks from its range in order and when the range is over it steals from the
+             * ranges of others. Claiming is a single `fetch_add`, so nobody ever waits for a lock
+             * and a slow thread only delays the chunk it is working on.
+             *
+             * Epochs are independent: a thread that has found no chunks left in its epoch moves
+             * on to the next one while others may still finish their last chunks, but every epoch
+             * still covers the whole input exactly once.
+             *
+             * Owner reports every chunk it has finished with `Complete`. Chunks already completed
+             * before the start (e.g. by the run a checkpoint was made of) are never handed out.
+             */
+            class ChunkScheduler {
+            public:
+                // `boundaries` as returned by `io::SplitTextIntoChunks`
+                // `completed` is empty or has a flag for `epoch * ChunksCount() + chunk index`
+                ChunkScheduler(const std::vector<uint64_t>& boundaries,
+                               const uint32_t owners_count, const uint32_t epochs_count,
+                               const std::vector<uint8_t>& completed = {});
+
+                // false if all chunks of `epoch` are already claimed
+                bool Claim(const uint32_t owner, const uint32_t epoch, Chunk& chunk) noexcept;
+
+                void Complete(const uint32_t epoch, const uint32_t chunk_index) noexcept;
+
+                // Flags of completed chunks in the same layout as in constructor.
+                std::vector<uint8_t> CompletedChunks() const;
+
+                uint32_t ChunksCount() const noexcept;
+                const std::vector<uint64_t>& boundaries() const noexcept;
+
+            private:
+                bool ClaimFrom(const uint32_t owner, const uint32_t epoch,
+                               Chunk& chunk) noexcept;
+
+            private:
+                struct Counter {
+                    char padding_before[CACHE_LINE_SIZE];
+                    std::atomic<uint32_t> claimed;  // may overshoot the range, it's fine
+                    char padding_after[CACHE_LINE_SIZE];
+                };
+
+                const std::vector<uint64_t> boundaries_;
+                const uint32_t owners_count_;
+                std::vector<uint32_t> ranges_;  // range of owner `i` is [ranges_[i], ranges_[i + 1])
+                std::vector<Counter> counters_;  // `epoch * owners_count_ + owner`
+                std::vector<std::atomic<uint8_t>> completed_;
+            };
+        }
+    }
+}
@@ -11,7 +11,7 @@ static constexpr uint32_t UNIGRAM_TABLE_SIZE = 100000000;
 yzw2v::sampling::UnigramDistribution::UnigramDistribution(const vocab::Vocabulary& vocab)
     : size_{UNIGRAM_TABLE_SIZE}
     , vocab_size_{vocab.size()}
-    , table_holder_{new uint32_t[UNIGRAM_TABLE_SIZE]}
+    , table_holder_{mem::AllocateUInt32(UNIGRAM_TABLE_SIZE)}
 {
     table_ = table_holder_.get();
 
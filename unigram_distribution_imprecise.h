@@ -1,5 +1,7 @@
 #pragma once
 
+#include "mem.h"
+
 #include <memory>
 
 namespace yzw2v {
@@ -27,7 +29,7 @@ namespace yzw2v {
             uint32_t size_;
             uint32_t* table_;
             uint32_t vocab_size_;
-            std::unique_ptr<uint32_t[]> table_holder_;
+            std::unique_ptr<uint32_t, mem::detail::Deleter> table_holder_;
         };
     }  // namespace sampling
 }  // namespace yzw2v
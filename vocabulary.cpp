@@ -1,8 +1,11 @@
 #include "vocabulary.h"
+#include "crc32c.h"
 #include "likely.h"
+#include "prefetch.h"
 
 #include <algorithm>
 #include <limits>
+#include <stdexcept>
 
 #include <cassert>
 #include <cstring>
@@ -38,20 +41,31 @@ bool yzw2v::vocab::Token::operator!=(const Token& other) const noexcept {
     return 0 != std::strncmp(begin_, other.begin_, length_);
 }
 
+// Lexicographic, token that is a prefix of the other one goes first; bytes past the end of the
+// shorter token are never looked at, so order doesn't depend on what follows it in memory.
+static int Compare(const yzw2v::vocab::Token& lhs, const yzw2v::vocab::Token& rhs) noexcept {
+    if (const auto res = std::memcmp(lhs.cbegin(), rhs.cbegin(),
+                                     std::min(lhs.length(), rhs.length()))) {
+        return res;
+    }
+
+    return static_cast<int>(lhs.length()) - static_cast<int>(rhs.length());
+}
+
 bool yzw2v::vocab::Token::operator<(const Token& other) const noexcept {
-    return std::strncmp(begin_, other.begin_, std::max(length_, other.length_)) < 0;
+    return Compare(*this, other) < 0;
 }
 
 bool yzw2v::vocab::Token::operator<=(const Token& other) const noexcept {
-    return std::strncmp(begin_, other.begin_, std::max(length_, other.length_)) <= 0;
+    return Compare(*this, other) <= 0;
 }
 
 bool yzw2v::vocab::Token::operator>(const Token& other) const noexcept {
-    return std::strncmp(begin_, other.begin_, std::max(length_, other.length_)) > 0;
+    return Compare(*this, other) > 0;
 }
 
 bool yzw2v::vocab::Token::operator>=(const Token& other) const noexcept {
-    return std::strncmp(begin_, other.begin_, std::max(length_, other.length_)) >= 0;
+    return Compare(*this, other) >= 0;
 }
 
 const char* yzw2v::vocab::Token::cbegin() const noexcept {
@@ -79,62 +93,83 @@ yzw2v::vocab::TokenInfo::TokenInfo(const Token& token_, const uint32_t count_) n
     , count{count_} {
 }
 
-static constexpr size_t BLOCK_SIZE = 1024 * 1024 * 8; // 8 Mb
+// Batch lookups have that many slots in flight, about as many as CPU can wait for at once.
+static constexpr uint32_t LOOKUP_GROUP_SIZE = 16;
+
+// Table is never smaller, so small vocabularies don't double it over and over.
+static constexpr uint32_t MIN_HASH_TABLE_SIZE = 1024;
+
+// Slots of the old table moved to the new one on every insertion. New table of 2N slots gets 0.7N
+// tokens when it is made and N / 8 more before all N old slots are moved, so it is still far from
+// full when the old one goes away.
+static constexpr uint32_t SLOTS_TO_MOVE_PER_INSERT = 8;
+
+// smallest table that is at most 70% full with `tokens_count` tokens
+static size_t HashTableSize(const size_t tokens_count) noexcept {
+    auto res = size_t{MIN_HASH_TABLE_SIZE};
+    while (tokens_count * 10 > res * 7) {
+        res *= 2;
+    }
+
+    return res;
+}
+
+constexpr size_t yzw2v::vocab::Vocabulary::SLOT_PREFIX_SIZE;
 
 yzw2v::vocab::Vocabulary::Vocabulary(const uint32_t max_number_of_tokens)
     : max_number_of_tokens_{max_number_of_tokens}
-    , hash_table_size_{max_number_of_tokens * 10 / 7}
-    , pool_(BLOCK_SIZE)
-    , hash_(hash_table_size_, INVALID_TOKEN_ID) {
-    tokens_.reserve(max_number_of_tokens_);
-}
-
-static uint32_t Hash(const yzw2v::vocab::Token& token) {
-    // let's trust guys from MSR http://stackoverflow.com/a/107657/2513489
-    // perf doesn't show any real difference, but we have to be different from word2vec
-    // implementation :)
-    static constexpr uint32_t BASE = 101;
-
-    auto hash = uint32_t{};
-    const auto* p = token.cbegin();
-    const auto* const p_end = token.cend();
-
-#if 1
-    static constexpr uint32_t BASE_P[] = {
-        1,
-        BASE,
-        BASE * BASE,
-        BASE * BASE * BASE,
-        BASE * BASE * BASE * BASE
-    };
-    for (const auto* const p_this_end = p_end - 3; p < p_this_end; p += 4) {
-        hash = hash * BASE_P[4]
-               + BASE_P[3] * static_cast<uint8_t>(p[0])
-               + BASE_P[2] * static_cast<uint8_t>(p[1])
-               + BASE_P[1] * static_cast<uint8_t>(p[2])
-               + BASE_P[0] * static_cast<uint8_t>(p[3]);
+    , hash_(MIN_HASH_TABLE_SIZE, Slot{INVALID_TOKEN_ID, 0, 0, {}})
+    , old_hash_position_{0} {
+}
+
+static uint32_t Hash(const yzw2v::vocab::Token& token) noexcept {
+    return yzw2v::crc::CRC32C(token.cbegin(), token.length());
+}
+
+yzw2v::vocab::Vocabulary::Slot yzw2v::vocab::Vocabulary::MakeSlot(
+    const uint32_t id, const uint32_t hash, const class Token& token
+) noexcept {
+    auto res = Slot{id, hash, token.length(), {}};
+    std::memcpy(res.prefix, token.cbegin(), std::min<size_t>(token.length(), SLOT_PREFIX_SIZE));
+    return res;
+}
+
+uint32_t yzw2v::vocab::Vocabulary::Position(const uint32_t hash,
+                                            const size_t table_size) noexcept {
+    // multiply-shift instead of modulo, high bits of CRC are as good as low ones
+    return static_cast<uint32_t>((uint64_t{hash} * table_size) >> 32);
+}
+
+yzw2v::vocab::Token yzw2v::vocab::Vocabulary::MakeToken(const Entry& entry) const noexcept {
+    return {chars_.data() + entry.offset, entry.length};
+}
+
+bool yzw2v::vocab::Vocabulary::Matches(const Slot& slot, const uint32_t hash,
+                                       const class Token& token) const noexcept {
+    if (YZ_LIKELY(slot.hash != hash || slot.length != token.length())) {
+        return false;
     }
-#endif
 
-    for (; p < p_end; ++p) {
-        hash = hash * BASE + static_cast<uint8_t>(*p);
+    if (token.length() <= SLOT_PREFIX_SIZE) {
+        return 0 == std::memcmp(slot.prefix, token.cbegin(), token.length());
     }
 
-    return hash;
+    return 0 == std::memcmp(slot.prefix, token.cbegin(), SLOT_PREFIX_SIZE)
+           && MakeToken(tokens_[slot.id]) == token;
 }
 
 uint32_t yzw2v::vocab::Vocabulary::size() const noexcept {
     return static_cast<uint32_t>(tokens_.size());
 }
 
-float yzw2v::vocab::Vocabulary::LoadFactor() const noexcept {
-    return static_cast<float>(static_cast<double>(tokens_.size()) / hash_table_size_);
+uint32_t yzw2v::vocab::Vocabulary::max_size() const noexcept {
+    return max_number_of_tokens_;
 }
 
 uint64_t yzw2v::vocab::Vocabulary::TextWordCount() const noexcept {
     auto count = uint64_t{};
-    for (const auto& token : tokens_) {
-        count += token.count;
+    for (const auto& entry : tokens_) {
+        count += entry.count;
     }
 
     return count;
@@ -148,85 +183,163 @@ bool yzw2v::vocab::Vocabulary::Has(const uint32_t id) const noexcept {
     return INVALID_TOKEN_ID != id && id < tokens_.size();
 }
 
-const yzw2v::vocab::TokenInfo& yzw2v::vocab::Vocabulary::Token(const uint32_t id) const noexcept {
-    return tokens_[id];
+yzw2v::vocab::TokenInfo yzw2v::vocab::Vocabulary::Token(const uint32_t id) const noexcept {
+    return {MakeToken(tokens_[id]), tokens_[id].count};
 }
 
 uint32_t yzw2v::vocab::Vocabulary::Count(const uint32_t id) const noexcept {
     return tokens_[id].count;
 }
 
-uint32_t yzw2v::vocab::Vocabulary::ID(const yzw2v::vocab::Token& token) const noexcept {
-    auto hash = Hash(token) % hash_table_size_;
-    while (INVALID_TOKEN_ID != hash_[hash]) {
-        if (token == tokens_[hash_[hash]].token) {
-            return hash_[hash];
+uint32_t yzw2v::vocab::Vocabulary::Probe(const std::vector<Slot>& table, const uint32_t hash,
+                                         const class Token& token) const noexcept {
+    const auto table_size = static_cast<uint32_t>(table.size());
+    auto position = Position(hash, table_size);
+    for (; INVALID_TOKEN_ID != table[position].id; ) {
+        if (Matches(table[position], hash, token)) {
+            break;
         }
 
-        hash = (hash + 1) % hash_table_size_;
+        if (YZ_UNLIKELY(++position == table_size)) {
+            position = 0;
+        }
     }
 
-    return INVALID_TOKEN_ID;
+    return position;
 }
 
-yzw2v::vocab::Vocabulary::const_iterator yzw2v::vocab::Vocabulary::cbegin() noexcept {
-    return tokens_.cbegin();
-}
+const yzw2v::vocab::Vocabulary::Slot& yzw2v::vocab::Vocabulary::Find(
+    const uint32_t hash, const class Token& token
+) const noexcept {
+    const auto& slot = hash_[Probe(hash_, hash, token)];
+    if (YZ_LIKELY(INVALID_TOKEN_ID != slot.id || old_hash_.empty())) {
+        return slot;
+    }
 
-yzw2v::vocab::Vocabulary::const_iterator yzw2v::vocab::Vocabulary::cend() noexcept {
-    return tokens_.cend();
+    return old_hash_[Probe(old_hash_, hash, token)];
 }
 
-yzw2v::vocab::Vocabulary::const_reverse_iterator yzw2v::vocab::Vocabulary::crbegin() noexcept {
-    return tokens_.crbegin();
+uint32_t yzw2v::vocab::Vocabulary::ID(const yzw2v::vocab::Token& token) const noexcept {
+    return Find(Hash(token), token).id;
 }
 
-yzw2v::vocab::Vocabulary::const_reverse_iterator yzw2v::vocab::Vocabulary::crend() noexcept {
-    return tokens_.crend();
+void yzw2v::vocab::Vocabulary::IDs(const class Token* const tokens, const uint32_t tokens_count,
+                                   uint32_t* const ids) const noexcept {
+    uint32_t hashes[LOOKUP_GROUP_SIZE];
+    for (auto begin = uint32_t{}; begin < tokens_count; begin += LOOKUP_GROUP_SIZE) {
+        const auto size = std::min(LOOKUP_GROUP_SIZE, tokens_count - begin);
+        for (auto i = uint32_t{}; i < size; ++i) {
+            hashes[i] = Hash(tokens[begin + i]);
+            YZ_PREFETCH_READ(hash_.data() + Position(hashes[i], hash_.size()), 3);
+        }
+
+        for (auto i = uint32_t{}; i < size; ++i) {
+            ids[begin + i] = Find(hashes[i], tokens[begin + i]).id;
+        }
+    }
 }
 
-static yzw2v::vocab::Token
-Copy(const yzw2v::vocab::Token& token, yzw2v::mem::Pool& pool) noexcept {
-    auto* const begin = pool.Get<char>(token.length());
-    const auto res = ::yzw2v::vocab::Token{begin, token.length()};
-    std::memmove(begin, token.cbegin(), token.length());
+yzw2v::vocab::Vocabulary::Entry yzw2v::vocab::Vocabulary::Copy(const class Token& token,
+                                                               const uint32_t count,
+                                                               std::vector<char>& chars) {
+    if (chars.size() + token.length() > std::numeric_limits<uint32_t>::max()) {
+        throw std::runtime_error{"vocabulary tokens take more than 4 Gb"};
+    }
 
+    const auto res = Entry{static_cast<uint32_t>(chars.size()), count, token.length()};
+    chars.insert(chars.end(), token.cbegin(), token.cend());
     return res;
 }
 
-uint32_t yzw2v::vocab::Vocabulary::Add(const class Token& token) {
-    auto hash = Hash(token);
-    if (YZ_UNLIKELY(hash >= hash_table_size_)) {
-        hash %= hash_table_size_;
+uint32_t yzw2v::vocab::Vocabulary::Insert(const uint32_t hash, const class Token& token,
+                                          const uint32_t count) {
+    auto& slot = hash_[Probe(hash_, hash, token)];
+    if (INVALID_TOKEN_ID != slot.id) {
+        tokens_[slot.id].count += count;
+        return slot.id;
     }
 
-    while (INVALID_TOKEN_ID != hash_[hash]) {
-        if (token == tokens_[hash_[hash]].token) {
-            ++tokens_[hash_[hash]].count;
-            return hash_[hash];
-        }
-
-        if (YZ_UNLIKELY(++hash > hash_table_size_)) {
-            hash %= hash_table_size_;
+    if (!old_hash_.empty()) {
+        const auto id = old_hash_[Probe(old_hash_, hash, token)].id;
+        if (INVALID_TOKEN_ID != id) {
+            tokens_[id].count += count;
+            return id;
         }
     }
 
     const auto index = static_cast<uint32_t>(tokens_.size());
-    hash_[hash] = index;
-    tokens_.emplace_back(Copy(token, pool_), 1);
+    tokens_.push_back(Copy(token, count, chars_));
+    slot = MakeSlot(index, hash, token);
+
+    if (!old_hash_.empty()) {
+        MoveOldSlots();
+    } else if (tokens_.size() * 10 > hash_.size() * 7) {
+        Grow();
+    }
 
     return index;
 }
 
-void yzw2v::vocab::Vocabulary::Sort() noexcept {
-    const auto cmp_less = [](const TokenInfo& lhs, const TokenInfo& rhs) noexcept -> bool {
+uint32_t yzw2v::vocab::Vocabulary::Add(const class Token& token, const uint32_t count) {
+    return Insert(Hash(token), token, count);
+}
+
+void yzw2v::vocab::Vocabulary::AddAll(const class Token* const tokens,
+                                      const uint32_t tokens_count) {
+    uint32_t hashes[LOOKUP_GROUP_SIZE];
+    for (auto begin = uint32_t{}; begin < tokens_count; begin += LOOKUP_GROUP_SIZE) {
+        const auto size = std::min(LOOKUP_GROUP_SIZE, tokens_count - begin);
+        for (auto i = uint32_t{}; i < size; ++i) {
+            hashes[i] = Hash(tokens[begin + i]);
+            YZ_PREFETCH_WRITE(hash_.data() + Position(hashes[i], hash_.size()), 3);
+        }
+
+        // one by one, so ids go in order of tokens as with `Add`
+        for (auto i = uint32_t{}; i < size; ++i) {
+            Insert(hashes[i], tokens[begin + i], 1);
+        }
+    }
+}
+
+void yzw2v::vocab::Vocabulary::Place(const Slot& slot) noexcept {
+    const auto table_size = static_cast<uint32_t>(hash_.size());
+    auto position = Position(slot.hash, table_size);
+    for (; INVALID_TOKEN_ID != hash_[position].id;
+         position = position + 1 == table_size ? 0 : position + 1);
+    hash_[position] = slot;
+}
+
+void yzw2v::vocab::Vocabulary::Grow() {
+    old_hash_ = std::move(hash_);
+    hash_ = std::vector<Slot>(old_hash_.size() * 2, Slot{INVALID_TOKEN_ID, 0, 0, {}});
+    old_hash_position_ = 0;
+    MoveOldSlots();
+}
+
+void yzw2v::vocab::Vocabulary::MoveOldSlots() noexcept {
+    const auto end = std::min(old_hash_position_ + SLOTS_TO_MOVE_PER_INSERT,
+                              static_cast<uint32_t>(old_hash_.size()));
+    for (; old_hash_position_ < end; ++old_hash_position_) {
+        const auto& slot = old_hash_[old_hash_position_];
+        if (INVALID_TOKEN_ID != slot.id) {
+            Place(slot);
+        }
+    }
+
+    if (old_hash_position_ == old_hash_.size()) {
+        old_hash_ = std::vector<Slot>{};
+    }
+}
+
+void yzw2v::vocab::Vocabulary::Sort() {
+    const auto cmp_less = [this](const Entry& lhs, const Entry& rhs) noexcept -> bool {
         if (lhs.count > rhs.count) {
             return true;
         } else if (lhs.count < rhs.count) {
             return false;
         }
 
-        return lhs.token < rhs.token;
+        return MakeToken(lhs) < MakeToken(rhs);
     };
 
     if (tokens_.size() >= 1) {
@@ -234,10 +347,30 @@ void yzw2v::vocab::Vocabulary::Sort() noexcept {
         std::sort(tokens_.begin() + 1, tokens_.end(), std::cref(cmp_less));
     }
 
-    hash_.assign(hash_.size(), INVALID_TOKEN_ID);
-    for (auto it = tokens_.cbegin(); tokens_.cend() != it; ++it) {
-        auto hash = Hash(it->token) % hash_table_size_;
-        for (; INVALID_TOKEN_ID != hash_[hash]; hash = (hash + 1) % hash_table_size_);
-        hash_[hash] = static_cast<uint32_t>(it - tokens_.cbegin());
+    RebuildHash();
+}
+
+void yzw2v::vocab::Vocabulary::RemoveInfrequent(const uint32_t min_token_freq) {
+    // survivors are copied to new storage, memory of removed tokens goes away with the old one
+    auto chars = std::vector<char>{};
+    auto size = size_t{};
+    for (const auto& entry : tokens_) {
+        if (entry.count >= min_token_freq) {
+            tokens_[size++] = Copy(MakeToken(entry), entry.count, chars);
+        }
+    }
+
+    tokens_.resize(size);
+    tokens_.shrink_to_fit();
+    chars_ = std::move(chars);
+    RebuildHash();
+}
+
+void yzw2v::vocab::Vocabulary::RebuildHash() {
+    old_hash_ = std::vector<Slot>{};
+    hash_ = std::vector<Slot>(HashTableSize(tokens_.size()), Slot{INVALID_TOKEN_ID, 0, 0, {}});
+    for (auto id = uint32_t{}; id < tokens_.size(); ++id) {
+        const auto token = MakeToken(tokens_[id]);
+        Place(MakeSlot(id, Hash(token), token));
     }
 }
@@ -1,10 +1,9 @@
 #pragma once
 
-#include "pool.h"
+#include "byte_source.h"
 
 #include <iosfwd>
 #include <limits>
-#include <list>
 #include <memory>
 #include <vector>
 
@@ -63,40 +62,102 @@ namespace yzw2v {
             TokenInfo& operator=(TokenInfo&& other) noexcept = default;
         };
 
+        /* Hash table grows with the number of tokens, so memory follows the real size of
+         * vocabulary; `max_number_of_tokens` is only the limit collection keeps it under (see
+         * `CollectIntoVocabulary`).
+         */
         class Vocabulary {
         public:
-            using const_iterator = std::vector<TokenInfo>::const_iterator;
-            using const_reverse_iterator = std::vector<TokenInfo>::const_reverse_iterator;
-
             explicit Vocabulary(const uint32_t max_number_of_tokens);
 
-            uint32_t Add(const Token& token);
+            // `count` occurrences of `token`
+            uint32_t Add(const Token& token, const uint32_t count = 1);
 
             bool Has(const Token& token) const noexcept;
             uint32_t ID(const Token& token) const noexcept;
 
+            /* Same as `Add` and `ID` for every token of a batch, in order. Tokens are hashed and
+             * their slots are prefetched by groups before they are looked up, so lookups of a
+             * group wait for memory at the same time instead of one after another.
+             */
+            void AddAll(const Token* const tokens, const uint32_t tokens_count);
+            void IDs(const Token* const tokens, const uint32_t tokens_count,
+                     uint32_t* const ids) const noexcept;
+
             bool Has(const uint32_t id) const noexcept;
-            const TokenInfo& Token(const uint32_t id) const noexcept;
+            // Token points into vocabulary and is valid until vocabulary is changed.
+            TokenInfo Token(const uint32_t id) const noexcept;
             uint32_t Count(const uint32_t id) const noexcept;
 
             uint32_t size() const noexcept;
-            float LoadFactor() const noexcept;
+            uint32_t max_size() const noexcept;
             uint64_t TextWordCount() const noexcept;
 
-            void Sort() noexcept;
+            void Sort();
 
-            const_iterator cbegin() noexcept;
-            const_iterator cend() noexcept;
+            // Removes tokens seen less than `min_token_freq` times, the rest keep their order.
+            // Memory of removed tokens is freed.
+            void RemoveInfrequent(const uint32_t min_token_freq);
 
-            const_reverse_iterator crbegin() noexcept;
-            const_reverse_iterator crend() noexcept;
+        private:
+            static constexpr size_t SLOT_PREFIX_SIZE = 7;
+
+            /* Slot of open addressing hash table. Hash and length of token are in the slot, so are
+             * its first bytes (the whole token if it's short), so probing compares tokens without
+             * touching `tokens_` and the pool; 4 slots share a cache line.
+             */
+            struct Slot {
+                uint32_t id;  // `INVALID_TOKEN_ID` if slot is empty
+                uint32_t hash;
+                uint8_t length;
+                char prefix[SLOT_PREFIX_SIZE];  // zero padded
+            };
+            static_assert(16 == sizeof(Slot), "slot must be 16 bytes");
+
+            // Characters of token are in `chars_` at `offset`.
+            struct Entry {
+                uint32_t offset;
+                uint32_t count;
+                uint8_t length;
+            };
+            static_assert(12 == sizeof(Entry), "entry must be 12 bytes");
+
+            static Slot MakeSlot(const uint32_t id, const uint32_t hash,
+                                 const class Token& token) noexcept;
+
+            // where probing for `hash` starts in a table of `table_size` slots
+            static uint32_t Position(const uint32_t hash, const size_t table_size) noexcept;
+            class Token MakeToken(const Entry& entry) const noexcept;
+            bool Matches(const Slot& slot, const uint32_t hash,
+                         const class Token& token) const noexcept;
+            // slot of `token` in `table` or empty slot where it goes
+            uint32_t Probe(const std::vector<Slot>& table, const uint32_t hash,
+                           const class Token& token) const noexcept;
+            // slot of `token` in `hash_` or in `old_hash_` if it wasn't moved yet
+            const Slot& Find(const uint32_t hash, const class Token& token) const noexcept;
+            uint32_t Insert(const uint32_t hash, const class Token& token, const uint32_t count);
+            static Entry Copy(const class Token& token, const uint32_t count,
+                              std::vector<char>& chars);
+            // puts slot of token that isn't in `hash_` yet into first empty slot after its position
+            void Place(const Slot& slot) noexcept;
+            void Grow();
+            void MoveOldSlots() noexcept;
+            void RebuildHash();
 
         private:
             uint32_t max_number_of_tokens_;
-            uint32_t hash_table_size_;
-            mem::Pool pool_;
-            std::vector<uint32_t> hash_;
-            std::vector<TokenInfo> tokens_;
+
+            /* Table is doubled when it gets 70% full. Slots of the previous table are moved to
+             * the new one a few at a time on every insertion, so there is no pause to rehash the
+             * whole table. Until they all are moved `old_hash_` is still searched; it isn't
+             * changed meanwhile, slots before `old_hash_position_` are already in `hash_`.
+             */
+            std::vector<Slot> hash_;
+            std::vector<Slot> old_hash_;
+            uint32_t old_hash_position_;
+
+            std::vector<char> chars_;
+            std::vector<Entry> tokens_;
 
         public:
             static void WriteTSVWithFilter(const Vocabulary& vocab, const std::string& path,
@@ -108,10 +169,23 @@ namespace yzw2v {
                                              Vocabulary& vocab);
         };
 
+        /* With several threads every thread counts tokens of its own slice of the text (slices
+         * are cut at line ends) into a shard of `max_number_of_tokens / threads_count` tokens.
+         * Shard that gets full is added to `vocab` and cleared, so memory is about that of two
+         * vocabularies whatever the number of threads. Shards never remove tokens, only `vocab`
+         * does when it gets more than `max_number_of_tokens`, as with one thread.
+         *
+         * Result is the same as with one thread when the text has at most `max_number_of_tokens`
+         * distinct tokens. Otherwise infrequent tokens are removed early, and which ones depends
+         * on what was counted so far, i.e. on the order threads read the text in.
+         */
         void CollectIntoVocabulary(const std::string& path, const uint32_t min_token_freq,
-                                   Vocabulary& vocab);
+                                   const io::ReadOptions& read_options, Vocabulary& vocab,
+                                   const uint32_t threads_count = 1);
         Vocabulary CollectVocabulary(const std::string& path, const uint32_t min_token_freq,
-                                     const uint32_t max_number_of_tokens);
+                                     const uint32_t max_number_of_tokens,
+                                     const io::ReadOptions& read_options,
+                                     const uint32_t threads_count = 1);
 
         void WriteTSV(const Vocabulary& vocab, const std::string& path);
         void WriteTSVWithFilter(const Vocabulary& vocab, const std::string& path,